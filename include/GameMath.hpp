@@ -22,18 +22,31 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #ifndef GAMEMATH_HPP_INCLUDED
 #define GAMEMATH_HPP_INCLUDED
 
+#include "GameMath/Affine3.hpp"
 #include "GameMath/Alignment.hpp"
 #include "GameMath/BoundingBox.hpp"
+#include "GameMath/Bvh.hpp"
+#include "GameMath/Compression.hpp"
+#include "GameMath/DualQuaternion.hpp"
 #include "GameMath/Frustum.hpp"
+#include "GameMath/LooseOctree.hpp"
 #include "GameMath/Mat3.hpp"
 #include "GameMath/Mat4.hpp"
 #include "GameMath/Math.hpp"
 #include "GameMath/Plane.hpp"
 #include "GameMath/Platform.hpp"
 #include "GameMath/Quaternion.hpp"
+#include "GameMath/Ray.hpp"
+#include "GameMath/Simd.hpp"
+#include "GameMath/Skeleton.hpp"
+#include "GameMath/Skinning.hpp"
+#include "GameMath/SpatialHashGrid.hpp"
+#include "GameMath/SweepAndPrune.hpp"
+#include "GameMath/ThreadPool.hpp"
 #include "GameMath/Types.hpp"
 #include "GameMath/Vec2.hpp"
 #include "GameMath/Vec3.hpp"
+#include "GameMath/Vec3Stream.hpp"
 #include "GameMath/Vec4.hpp"
 
 #endif
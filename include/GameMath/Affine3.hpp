@@ -0,0 +1,189 @@
+/*
+Copyright (C) 2011, Mathias Gottschlag
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef GAMEMATH_AFFINE3_HPP_INCLUDED
+#define GAMEMATH_AFFINE3_HPP_INCLUDED
+
+#include "Mat3.hpp"
+#include "Mat4.hpp"
+#include "Simd.hpp"
+
+namespace math
+{
+	/**
+	 * Compact affine transformation, stored as a 3x3 linear part and a
+	 * translation (12 values instead of the 16 of a Mat4). The implicit
+	 * last row is always (0, 0, 0, 1), so composition and inversion need
+	 * considerably fewer operations than the general Mat4 versions.
+	 */
+	template<typename T> class Affine3
+	{
+	public:
+		Affine3()
+		{
+		}
+		Affine3(const Mat3<T> &linear, const Vec3<T> &translation)
+			: linear(linear), translation(translation)
+		{
+		}
+		/**
+		 * Creates an affine transformation from the upper 3x4 part of a
+		 * matrix. The last row of the matrix is ignored.
+		 */
+		explicit Affine3(const Mat4<T> &m)
+			: linear(m(0, 0), m(0, 1), m(0, 2),
+			         m(1, 0), m(1, 1), m(1, 2),
+			         m(2, 0), m(2, 1), m(2, 2)),
+			translation(m(0, 3), m(1, 3), m(2, 3))
+		{
+		}
+		static Affine3<T> Identity()
+		{
+			return Affine3<T>(Mat3<T>::Identity(), Vec3<T>(0, 0, 0));
+		}
+		static Affine3<T> TransMat(const Vec3<T> &v)
+		{
+			return Affine3<T>(Mat3<T>::Identity(), v);
+		}
+		static Affine3<T> ScaleMat(const Vec3<T> &v)
+		{
+			return Affine3<T>(Mat3<T>(v.x, 0, 0,
+			                          0, v.y, 0,
+			                          0, 0, v.z),
+			                  Vec3<T>(0, 0, 0));
+		}
+
+		Mat4<T> toMatrix() const
+		{
+			Mat4<T> m(linear);
+			m(0, 3) = translation.x;
+			m(1, 3) = translation.y;
+			m(2, 3) = translation.z;
+			return m;
+		}
+
+		/**
+		 * Combines two transformations, the result first applies o and
+		 * then this transformation (same order as Mat4::operator*()).
+		 */
+		Affine3<T> operator*(const Affine3<T> &o) const
+		{
+			return Affine3<T>(linear * o.linear,
+			                  linear * o.translation + translation);
+		}
+		Affine3<T> &operator*=(const Affine3<T> &o)
+		{
+			*this = *this * o;
+			return *this;
+		}
+
+		Vec3<T> transformPoint(const Vec3<T> &p) const
+		{
+			return linear * p + translation;
+		}
+		Vec3<T> transformDirection(const Vec3<T> &d) const
+		{
+			return linear * d;
+		}
+
+		/**
+		 * Returns the inverse transformation. If the linear part is not
+		 * invertible, the result is undefined.
+		 */
+		Affine3<T> inverse() const
+		{
+			Mat3<T> inv = linear.inverse();
+			return Affine3<T>(inv, -(inv * translation));
+		}
+		/**
+		 * Returns the inverse of a rigid transformation, that is one which
+		 * only contains a rotation and a translation. The result is
+		 * undefined for transformations with scaling or shearing.
+		 */
+		Affine3<T> inverseRigid() const
+		{
+			Mat3<T> inv = linear.transposed();
+			return Affine3<T>(inv, -(inv * translation));
+		}
+
+		bool operator==(const Affine3<T> &o) const
+		{
+			for (unsigned int i = 0; i < 9; i++)
+			{
+				if (linear.m[i] != o.linear.m[i])
+					return false;
+			}
+			return translation == o.translation;
+		}
+		bool operator!=(const Affine3<T> &o) const
+		{
+			return !(*this == o);
+		}
+
+		/**
+		 * Rotation, scale and shear part of the transformation.
+		 */
+		Mat3<T> linear;
+		/**
+		 * Translation which is applied after the linear part.
+		 */
+		Vec3<T> translation;
+	};
+
+	typedef Affine3<float> Affine3f;
+	typedef Affine3<double> Affine3d;
+
+#if defined(GAMEMATH_SSE2)
+	// SIMD version of the Affine3f composition. The linear part and the
+	// translation are stored back-to-back as 12 floats, so the columns can be
+	// loaded with overlapping unaligned loads (the fourth lane of each load
+	// is ignored). The summation order is the same as in the generic
+	// code, so unless FMA is enabled the results are bit-identical.
+	template<> inline Affine3<float> Affine3<float>::operator*(const Affine3<float> &o) const
+	{
+		const float *m = linear.m;
+		const float *om = o.linear.m;
+		Float4 c0 = Float4::load(m);
+		Float4 c1 = Float4::load(m + 3);
+		Float4 c2 = Float4::load(m + 6);
+		Float4 t = Float4::load(m + 8);
+		t = shuffle<1, 2, 3, 3>(t, t);
+		Affine3<float> out;
+		float *dst = out.linear.m;
+		Float4 r0 = madd(c2, Float4(om[2]), madd(c1, Float4(om[1]), c0 * Float4(om[0])));
+		Float4 r1 = madd(c2, Float4(om[5]), madd(c1, Float4(om[4]), c0 * Float4(om[3])));
+		Float4 r2 = madd(c2, Float4(om[8]), madd(c1, Float4(om[7]), c0 * Float4(om[6])));
+		const Vec3<float> &ot = o.translation;
+		Float4 rt = madd(c2, Float4(ot.z), madd(c1, Float4(ot.y), c0 * Float4(ot.x))) + t;
+		// The four 3-element columns are packed into three registers so
+		// that the stores do not overlap (overlapping stores would stall
+		// the store forwarding when the result is read back)
+		Float4 tmp = shuffle<2, 2, 0, 0>(r0, r1);
+		shuffle<0, 1, 0, 2>(r0, tmp).store(dst);
+		shuffle<1, 2, 0, 1>(r1, r2).store(dst + 4);
+		tmp = shuffle<2, 2, 0, 0>(r2, rt);
+		shuffle<0, 2, 1, 2>(tmp, rt).store(dst + 8);
+		return out;
+	}
+#endif
+}
+
+#endif
@@ -24,6 +24,11 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #include "Vec3.hpp"
 #include "Mat4.hpp"
+#include "Affine3.hpp"
+#include "Simd.hpp"
+
+#include <cmath>
+#include <cstddef>
 
 namespace math
 {
@@ -101,6 +106,15 @@ namespace math
 			{
 				return maxCorner - minCorner;
 			}
+			/**
+			 * Returns the surface area of the bounding box.
+			 * @return Surface area of the box.
+			 */
+			float getSurfaceArea() const
+			{
+				Vec3f size = maxCorner - minCorner;
+				return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+			}
 
 			/**
 			 * Inserts a point into the bounding box and enlarges the box so
@@ -108,17 +122,17 @@ namespace math
 			 */
 			void insert(const Vec3f &point)
 			{
-				if (minCorner.x < point.x)
+				if (point.x < minCorner.x)
 					minCorner.x = point.x;
-				if (maxCorner.x > point.x)
+				if (point.x > maxCorner.x)
 					maxCorner.x = point.x;
-				if (minCorner.y < point.y)
+				if (point.y < minCorner.y)
 					minCorner.y = point.y;
-				if (maxCorner.y > point.y)
+				if (point.y > maxCorner.y)
 					maxCorner.y = point.y;
-				if (minCorner.z < point.z)
+				if (point.z < minCorner.z)
 					minCorner.z = point.z;
-				if (maxCorner.z > point.z)
+				if (point.z > maxCorner.z)
 					maxCorner.z = point.z;
 			}
 			/**
@@ -134,19 +148,119 @@ namespace math
 			/**
 			 * Creates a new bounding box which contains all corners of this box
 			 * transformed with the given transformation matrix.
+			 *
+			 * The matrix is treated as an affine transformation (the last row
+			 * is ignored). Instead of transforming all eight corners, the
+			 * center is transformed and the new extents are computed from the
+			 * absolute values of the matrix (Arvo's method), which results in
+			 * the same box.
 			 * @param transformation Transformation matrix.
 			 * @return Transformed bounding box.
 			 */
-			BoundingBox transform(const Mat4f &transformation)
+			BoundingBox transform(const Mat4f &transformation) const
+			{
+				const Mat4f &m = transformation;
+				Vec3f center = getCenter();
+				Vec3f extents = (maxCorner - minCorner) * 0.5f;
+				Vec3f newCenter;
+				Vec3f newExtents;
+				for (unsigned int i = 0; i < 3; i++)
+				{
+					(&newCenter.x)[i] = m(i, 0) * center.x + m(i, 1) * center.y
+					                  + m(i, 2) * center.z + m(i, 3);
+					(&newExtents.x)[i] = std::fabs(m(i, 0)) * extents.x
+					                   + std::fabs(m(i, 1)) * extents.y
+					                   + std::fabs(m(i, 2)) * extents.z;
+				}
+				return BoundingBox(newCenter - newExtents, newCenter + newExtents);
+			}
+			/**
+			 * Creates a new bounding box which contains all corners of this box
+			 * transformed with the given affine transformation.
+			 */
+			BoundingBox transform(const Affine3f &transformation) const
 			{
-				// Construct empty box from first corner
-				// If we do not initialize the box like this, (0/0/0) would
-				// always be in the box
-				BoundingBox box(transformation.transformPoint(getCorner(0)));
-				// Insert other corners
-				for (unsigned int i = 1; i < 8; i++)
-					box.insert(transformation.transformPoint(getCorner(i)));
-				return box;
+				const Mat3f &m = transformation.linear;
+				Vec3f center = transformation.transformPoint(getCenter());
+				Vec3f extents = (maxCorner - minCorner) * 0.5f;
+				Vec3f newExtents;
+				for (unsigned int i = 0; i < 3; i++)
+				{
+					(&newExtents.x)[i] = std::fabs(m(i, 0)) * extents.x
+					                   + std::fabs(m(i, 1)) * extents.y
+					                   + std::fabs(m(i, 2)) * extents.z;
+				}
+				return BoundingBox(center - newExtents, center + newExtents);
+			}
+			/**
+			 * Transforms an array of boxes with the same transformation matrix,
+			 * see transform(). Four boxes are transformed at once.
+			 * @param boxes Boxes to transform.
+			 * @param transformation Transformation matrix.
+			 * @param result Transformed boxes. May be the same as boxes.
+			 * @param count Number of boxes.
+			 */
+			static void transformBoxes(const BoundingBox *boxes,
+			                           const Mat4f &transformation,
+			                           BoundingBox *result,
+			                           size_t count)
+			{
+				Float4 m[3][4];
+				Float4 absm[3][3];
+				for (unsigned int i = 0; i < 3; i++)
+				{
+					for (unsigned int j = 0; j < 4; j++)
+						m[i][j] = Float4(transformation(i, j));
+					for (unsigned int j = 0; j < 3; j++)
+						absm[i][j] = abs(m[i][j]);
+				}
+				size_t simdCount = count & ~(size_t)3;
+				size_t i = 0;
+				for (; i < simdCount; i += 4)
+					transformFour(&boxes[i].minCorner.x, m, absm, &result[i].minCorner.x);
+				for (; i < count; i++)
+					result[i] = boxes[i].transform(transformation);
+			}
+			/**
+			 * Transforms an array of boxes, every box with its own matrix (for
+			 * example to compute the world space boxes of all moving
+			 * objects), see transform(). Four boxes are transformed at once.
+			 * @param boxes Boxes to transform.
+			 * @param transformations Transformation matrices, one per box.
+			 * @param result Transformed boxes. May be the same as boxes.
+			 * @param count Number of boxes.
+			 */
+			static void transformBoxes(const BoundingBox *boxes,
+			                           const Mat4f *transformations,
+			                           BoundingBox *result,
+			                           size_t count)
+			{
+				size_t simdCount = count & ~(size_t)3;
+				size_t i = 0;
+				for (; i < simdCount; i += 4)
+				{
+					// Convert the matrices to SoA form, column j of the four
+					// matrices is transposed so that row k contains m(k, j)
+					Float4 m[3][4];
+					Float4 absm[3][3];
+					for (unsigned int j = 0; j < 4; j++)
+					{
+						Float4 r0 = Float4::load(transformations[i].m + j * 4);
+						Float4 r1 = Float4::load(transformations[i + 1].m + j * 4);
+						Float4 r2 = Float4::load(transformations[i + 2].m + j * 4);
+						Float4 r3 = Float4::load(transformations[i + 3].m + j * 4);
+						transpose(r0, r1, r2, r3);
+						m[0][j] = r0;
+						m[1][j] = r1;
+						m[2][j] = r2;
+					}
+					for (unsigned int k = 0; k < 3; k++)
+						for (unsigned int j = 0; j < 3; j++)
+							absm[k][j] = abs(m[k][j]);
+					transformFour(&boxes[i].minCorner.x, m, absm, &result[i].minCorner.x);
+				}
+				for (; i < count; i++)
+					result[i] = boxes[i].transform(transformations[i]);
 			}
 
 			/**
@@ -197,6 +311,66 @@ namespace math
 			 * Maximum coordinates of all points in the bounding box.
 			 */
 			Vec3f maxCorner;
+		private:
+			/**
+			 * Transforms four consecutive boxes, m and absm contain the
+			 * (absolute) matrix entries for the four boxes.
+			 */
+			static void transformFour(const float *in,
+			                          const Float4 (&m)[3][4],
+			                          const Float4 (&absm)[3][3],
+			                          float *out)
+			{
+				// Convert the boxes to SoA form, the second half of the box is
+				// loaded with an offset of two floats so that no memory behind
+				// the last box is read
+				Float4 minx = Float4::load(in);
+				Float4 miny = Float4::load(in + 6);
+				Float4 minz = Float4::load(in + 12);
+				Float4 maxx = Float4::load(in + 18);
+				transpose(minx, miny, minz, maxx);
+				Float4 maxy = Float4::load(in + 2);
+				Float4 maxz = Float4::load(in + 8);
+				Float4 tmp1 = Float4::load(in + 14);
+				Float4 tmp2 = Float4::load(in + 20);
+				transpose(maxy, maxz, tmp1, tmp2);
+				maxy = tmp1;
+				maxz = tmp2;
+				Float4 half(0.5f);
+				Float4 cx = (minx + maxx) * half;
+				Float4 cy = (miny + maxy) * half;
+				Float4 cz = (minz + maxz) * half;
+				Float4 ex = (maxx - minx) * half;
+				Float4 ey = (maxy - miny) * half;
+				Float4 ez = (maxz - minz) * half;
+				Float4 center[3];
+				Float4 extents[3];
+				for (unsigned int i = 0; i < 3; i++)
+				{
+					center[i] = madd(m[i][2], cz, madd(m[i][1], cy, m[i][0] * cx)) + m[i][3];
+					extents[i] = madd(absm[i][2], ez, madd(absm[i][1], ey, absm[i][0] * ex));
+				}
+				// Back to AoS form, the same overlapping layout as above is
+				// used for the stores
+				minx = center[0] - extents[0];
+				miny = center[1] - extents[1];
+				minz = center[2] - extents[2];
+				maxx = center[0] + extents[0];
+				maxy = center[1] + extents[1];
+				maxz = center[2] + extents[2];
+				tmp1 = minz;
+				tmp2 = maxx;
+				transpose(minx, miny, minz, maxx);
+				transpose(tmp1, tmp2, maxy, maxz);
+				minx.store(out);
+				miny.store(out + 6);
+				minz.store(out + 12);
+				maxx.store(out + 18);
+				tmp1.store(out + 2);
+				tmp2.store(out + 8);
+				maxy.store(out + 14);
+				maxz.store(out + 20);
+			}
 	};
 }
 
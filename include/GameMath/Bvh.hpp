@@ -0,0 +1,888 @@
+/*
+Copyright (C) 2011, Mathias Gottschlag
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef GAMEMATH_BVH_HPP_INCLUDED
+#define GAMEMATH_BVH_HPP_INCLUDED
+
+#include "BoundingBox.hpp"
+#include "Frustum.hpp"
+#include "Ray.hpp"
+#include "Simd.hpp"
+#include "ThreadPool.hpp"
+#include "Types.hpp"
+
+#include <algorithm>
+#include <cfloat>
+#include <cstddef>
+#include <vector>
+
+namespace math
+{
+	/**
+	 * Bounding volume hierarchy over an array of bounding boxes.
+	 *
+	 * The tree is built with a binned surface area heuristic and stored as a
+	 * flat array of nodes in depth-first order, the two children of a node
+	 * are stored next to each other. The primitives are referenced by their
+	 * index in the array which was passed to build(), all queries return
+	 * these indices.
+	 */
+	class Bvh
+	{
+		public:
+			/**
+			 * Node of the tree. Interior nodes have count == 0 and their
+			 * children are stored at nodes[first] and nodes[first + 1], leaf
+			 * nodes reference the primitive indices
+			 * getPrimitiveIndices()[first] to [first + count - 1].
+			 */
+			struct Node
+			{
+				BoundingBox bounds;
+				uint32 first;
+				uint32 count;
+
+				bool isLeaf() const
+				{
+					return count != 0;
+				}
+			};
+
+			Bvh()
+			{
+			}
+
+			/**
+			 * Algorithm used to split the primitives during the build.
+			 */
+			enum BuildMode
+			{
+				/**
+				 * The primitives are split along the axis and position which
+				 * minimizes the surface area heuristic, the candidate
+				 * positions are the borders of 16 equally sized bins along
+				 * the centroid bounds of the node.
+				 */
+				BinnedSah,
+				/**
+				 * The primitives are sorted along a Morton curve through
+				 * their centroids and split where the highest bit of the
+				 * Morton code changes (LBVH). Faster to build, but the tree
+				 * is usually slower to traverse.
+				 */
+				Morton
+			};
+
+			/**
+			 * Builds the tree.
+			 * @param boxes Bounding boxes of the primitives.
+			 * @param count Number of primitives.
+			 * @param maxLeafSize Maximum number of primitives in a leaf.
+			 * @param mode Split algorithm.
+			 */
+			void build(const BoundingBox *boxes,
+			           size_t count,
+			           unsigned int maxLeafSize = 4,
+			           BuildMode mode = BinnedSah)
+			{
+				buildTree(0, boxes, count, maxLeafSize, mode);
+			}
+			/**
+			 * Builds the tree using multiple threads. Subtrees with many
+			 * primitives are built in separate tasks. The resulting tree is
+			 * exactly the same as the one created by the single-threaded
+			 * build(), independent of the number of threads.
+			 * @param pool Thread pool, the calling thread has to be thread 0
+			 * of the pool.
+			 */
+			void build(ThreadPool &pool,
+			           const BoundingBox *boxes,
+			           size_t count,
+			           unsigned int maxLeafSize = 4,
+			           BuildMode mode = BinnedSah)
+			{
+				buildTree(&pool, boxes, count, maxLeafSize, mode);
+			}
+			/**
+			 * Updates the bounds of all nodes after the primitives have moved
+			 * without changing the structure of the tree. This takes O(n)
+			 * time, but the quality of the tree degrades if the primitives
+			 * move far, in this case the tree should be rebuilt.
+			 * @param boxes New bounding boxes of the primitives, in the same
+			 * order as passed to build().
+			 */
+			void refit(const BoundingBox *boxes)
+			{
+				for (size_t i = 0; i < primitives.size(); i++)
+					primitives[i] = boxes[indices[i]];
+				// Children are always stored behind their parents
+				for (size_t i = nodes.size(); i-- > 0;)
+				{
+					Node &node = nodes[i];
+					if (node.isLeaf())
+					{
+						node.bounds = primitives[node.first];
+						for (uint32 j = 1; j < node.count; j++)
+							node.bounds.insert(primitives[node.first + j]);
+					}
+					else
+					{
+						node.bounds = nodes[node.first].bounds;
+						node.bounds.insert(nodes[node.first + 1].bounds);
+					}
+				}
+			}
+
+			/**
+			 * Appends the indices of all primitives whose boxes overlap the
+			 * given box to result.
+			 * @return Number of primitives found.
+			 */
+			size_t queryOverlap(const BoundingBox &box,
+			                    std::vector<uint32> &result) const
+			{
+				if (nodes.empty())
+					return 0;
+				size_t oldSize = result.size();
+				uint32 stack[StackSize];
+				unsigned int stackSize = 0;
+				stack[stackSize++] = 0;
+				while (stackSize != 0)
+				{
+					const Node &node = nodes[stack[--stackSize]];
+					if (!node.bounds.overlap(box))
+						continue;
+					if (node.isLeaf())
+					{
+						for (uint32 i = node.first; i < node.first + node.count; i++)
+						{
+							if (primitives[i].overlap(box))
+								result.push_back(indices[i]);
+						}
+					}
+					else
+					{
+						stack[stackSize++] = node.first + 1;
+						stack[stackSize++] = node.first;
+					}
+				}
+				return result.size() - oldSize;
+			}
+			/**
+			 * Appends the indices of all primitives whose boxes contain the
+			 * given point to result.
+			 * @return Number of primitives found.
+			 */
+			size_t queryPoint(const Vec3f &point,
+			                  std::vector<uint32> &result) const
+			{
+				return queryOverlap(BoundingBox(point), result);
+			}
+			/**
+			 * Appends the indices of all primitives whose boxes are at least
+			 * partially inside the frustum to result (see
+			 * Frustum::isInside(const BoundingBox&)).
+			 *
+			 * Planes which completely contain a node are not tested for the
+			 * children of the node, and subtrees which are completely inside
+			 * the frustum are added without further tests.
+			 * @return Number of primitives found.
+			 */
+			size_t queryFrustum(const Frustum &frustum,
+			                    std::vector<uint32> &result) const
+			{
+				if (nodes.empty())
+					return 0;
+				size_t oldSize = result.size();
+				uint32 stack[StackSize];
+				unsigned int planeMasks[StackSize];
+				unsigned int stackSize = 0;
+				stack[stackSize] = 0;
+				planeMasks[stackSize++] = Frustum::AllPlanes;
+				// Neighbouring nodes usually are rejected by the same plane
+				uint8 cachedPlane = 0;
+				while (stackSize != 0)
+				{
+					stackSize--;
+					const Node &node = nodes[stack[stackSize]];
+					unsigned int planeMask = planeMasks[stackSize];
+					unsigned int childMask = 0;
+					if (frustum.classify(node.bounds, cachedPlane, planeMask, &childMask) == Frustum::Outside)
+						continue;
+					if (childMask == 0)
+					{
+						addSubtree(node, result);
+					}
+					else if (node.isLeaf())
+					{
+						for (uint32 i = node.first; i < node.first + node.count; i++)
+						{
+							if (frustum.classify(primitives[i], cachedPlane, childMask) != Frustum::Outside)
+								result.push_back(indices[i]);
+						}
+					}
+					else
+					{
+						stack[stackSize] = node.first + 1;
+						planeMasks[stackSize++] = childMask;
+						stack[stackSize] = node.first;
+						planeMasks[stackSize++] = childMask;
+					}
+				}
+				return result.size() - oldSize;
+			}
+			/**
+			 * Appends the indices of all primitives whose boxes are hit by
+			 * the ray segment origin + t * direction with 0 <= t <= maxDistance
+			 * to result. The primitives are not sorted by distance.
+			 * @return Number of primitives found.
+			 */
+			size_t queryRay(const Vec3f &origin,
+			                const Vec3f &direction,
+			                float maxDistance,
+			                std::vector<uint32> &result) const
+			{
+				return queryRay(Ray(origin, direction), maxDistance, result);
+			}
+			/**
+			 * Appends the indices of all primitives whose boxes are hit by
+			 * the ray within maxDistance to result.
+			 * @return Number of primitives found.
+			 */
+			size_t queryRay(const Ray &ray,
+			                float maxDistance,
+			                std::vector<uint32> &result) const
+			{
+				if (nodes.empty())
+					return 0;
+				size_t oldSize = result.size();
+				uint32 stack[StackSize];
+				unsigned int stackSize = 0;
+				stack[stackSize++] = 0;
+				while (stackSize != 0)
+				{
+					const Node &node = nodes[stack[--stackSize]];
+					if (!ray.intersect(node.bounds, maxDistance))
+						continue;
+					if (node.isLeaf())
+					{
+						for (uint32 i = node.first; i < node.first + node.count; i++)
+						{
+							if (ray.intersect(primitives[i], maxDistance))
+								result.push_back(indices[i]);
+						}
+					}
+					else
+					{
+						stack[stackSize++] = node.first + 1;
+						stack[stackSize++] = node.first;
+					}
+				}
+				return result.size() - oldSize;
+			}
+
+			/**
+			 * Returns the bounds of all primitives.
+			 */
+			BoundingBox getBounds() const
+			{
+				if (nodes.empty())
+					return BoundingBox();
+				return nodes[0].bounds;
+			}
+			const std::vector<Node> &getNodes() const
+			{
+				return nodes;
+			}
+			/**
+			 * Returns the primitive indices referenced by the leaf nodes.
+			 */
+			const std::vector<uint32> &getPrimitiveIndices() const
+			{
+				return indices;
+			}
+		private:
+			/**
+			 * Below this depth, nodes are split at the object median which
+			 * limits the depth of the tree (and the size of the traversal
+			 * stacks) to MedianDepth + 32.
+			 */
+			static const unsigned int MedianDepth = 48;
+			static const unsigned int StackSize = MedianDepth + 34;
+			static const unsigned int BinCount = 16;
+			/**
+			 * Minimum number of primitives for which a subtree is built in a
+			 * separate task.
+			 */
+			static const unsigned int ParallelThreshold = 4096;
+
+			struct BuildTask
+			{
+				BuildTask()
+				{
+				}
+				BuildTask(uint32 node, uint32 begin, uint32 end, unsigned int depth)
+					: node(node), begin(begin), end(end), depth(depth)
+				{
+				}
+				uint32 node;
+				uint32 begin;
+				uint32 end;
+				unsigned int depth;
+			};
+			/**
+			 * Copy of a primitive box used during the build. The corners are
+			 * padded to four floats so that they can be loaded into SIMD
+			 * registers directly.
+			 */
+			struct BuildPrimitive
+			{
+				BuildPrimitive()
+				{
+				}
+				BuildPrimitive(const BoundingBox &box, uint32 index)
+					: index(index), code(0)
+				{
+					minCorner[0] = box.minCorner.x;
+					minCorner[1] = box.minCorner.y;
+					minCorner[2] = box.minCorner.z;
+					minCorner[3] = 0;
+					maxCorner[0] = box.maxCorner.x;
+					maxCorner[1] = box.maxCorner.y;
+					maxCorner[2] = box.maxCorner.z;
+					maxCorner[3] = 0;
+				}
+				/**
+				 * Returns the centroid along one axis, computed in the same way
+				 * as in the SIMD code in splitNode().
+				 */
+				float getCentroid(unsigned int axis) const
+				{
+					return (minCorner[axis] + maxCorner[axis]) * 0.5f;
+				}
+				float minCorner[4];
+				float maxCorner[4];
+				uint32 index;
+				uint32 code;
+			};
+			/**
+			 * Sort order for the Morton build, equal codes are sorted by
+			 * index so that the order is unique.
+			 */
+			struct CompareCodes
+			{
+				bool operator()(const BuildPrimitive &a, const BuildPrimitive &b) const
+				{
+					return a.code < b.code || (a.code == b.code && a.index < b.index);
+				}
+				bool operator()(const BuildPrimitive &a, uint32 code) const
+				{
+					return a.code < code;
+				}
+			};
+			/**
+			 * State shared by all tasks of a build.
+			 */
+			struct BuildContext
+			{
+				BuildContext(BuildPrimitive *primitives, Node *nodes,
+				             unsigned int maxLeafSize, BuildMode mode,
+				             ThreadPool *pool)
+					: primitives(primitives), nodes(nodes), nodeCount(1),
+					maxLeafSize(maxLeafSize), mode(mode), pool(pool)
+				{
+				}
+				BuildPrimitive *primitives;
+				/**
+				 * Temporary node array, the nodes are allocated in an order
+				 * which depends on the scheduling of the tasks.
+				 */
+				Node *nodes;
+				AtomicCounter nodeCount;
+				unsigned int maxLeafSize;
+				BuildMode mode;
+				ThreadPool *pool;
+				ThreadPool::TaskGroup group;
+			};
+			class SubtreeTask : public ThreadPool::Task
+			{
+				public:
+					SubtreeTask(BuildContext &context, const BuildTask &task)
+						: context(context), task(task)
+					{
+					}
+					virtual void run(ThreadPool &pool, unsigned int thread)
+					{
+						buildSubtree(context, task, thread);
+					}
+				private:
+					BuildContext &context;
+					BuildTask task;
+			};
+			class SortTask : public ThreadPool::Task
+			{
+				public:
+					SortTask(BuildPrimitive *first, BuildPrimitive *middle,
+					         BuildPrimitive *last)
+						: first(first), middle(middle), last(last)
+					{
+					}
+					/**
+					 * Sorts [first, last) if middle is 0, otherwise merges the
+					 * sorted ranges [first, middle) and [middle, last).
+					 */
+					virtual void run(ThreadPool &pool, unsigned int thread)
+					{
+						if (middle)
+							std::inplace_merge(first, middle, last, CompareCodes());
+						else
+							std::sort(first, last, CompareCodes());
+					}
+				private:
+					BuildPrimitive *first;
+					BuildPrimitive *middle;
+					BuildPrimitive *last;
+			};
+			struct Bin
+			{
+				Bin()
+					: minCorner(FLT_MAX), maxCorner(-FLT_MAX), count(0)
+				{
+				}
+				Float4 minCorner;
+				Float4 maxCorner;
+				uint32 count;
+			};
+			/**
+			 * Predicate for std::partition() which returns true for
+			 * primitives left of the split position.
+			 */
+			struct IsLeftOfSplit
+			{
+				IsLeftOfSplit(unsigned int axis, float min, float scale,
+				              unsigned int splitBin)
+					: axis(axis), min(min), scale(scale), splitBin(splitBin)
+				{
+				}
+				bool operator()(const BuildPrimitive &primitive) const
+				{
+					return getBin((primitive.getCentroid(axis) - min) * scale) <= splitBin;
+				}
+				unsigned int axis;
+				float min;
+				float scale;
+				unsigned int splitBin;
+			};
+			/**
+			 * Comparison for std::nth_element() which sorts the primitives
+			 * by their centroids along one axis.
+			 */
+			struct CompareCentroids
+			{
+				CompareCentroids(unsigned int axis)
+					: axis(axis)
+				{
+				}
+				bool operator()(const BuildPrimitive &a, const BuildPrimitive &b) const
+				{
+					return a.getCentroid(axis) < b.getCentroid(axis);
+				}
+				unsigned int axis;
+			};
+
+			/**
+			 * Returns the bin for a centroid position relative to the
+			 * centroid bounds and scaled to [0, BinCount].
+			 */
+			static unsigned int getBin(float scaledCentroid)
+			{
+				unsigned int bin = (unsigned int)scaledCentroid;
+				return bin < BinCount ? bin : BinCount - 1;
+			}
+			static float getSurfaceArea(const Float4 &minCorner, const Float4 &maxCorner)
+			{
+				float size[4];
+				(maxCorner - minCorner).store(size);
+				return 2.0f * (size[0] * size[1] + size[1] * size[2] + size[2] * size[0]);
+			}
+			void buildTree(ThreadPool *pool,
+			               const BoundingBox *boxes,
+			               size_t count,
+			               unsigned int maxLeafSize,
+			               BuildMode mode)
+			{
+				nodes.clear();
+				indices.resize(count);
+				primitives.resize(count);
+				if (count == 0)
+					return;
+				if (maxLeafSize == 0)
+					maxLeafSize = 1;
+				// The primitives are sorted into the leaves by moving copies
+				// of their boxes around, which is much more cache-friendly
+				// than working on the indices only
+				std::vector<BuildPrimitive> buildPrimitives(count);
+				for (size_t i = 0; i < count; i++)
+					buildPrimitives[i] = BuildPrimitive(boxes[i], (uint32)i);
+				if (mode == Morton)
+					sortByMortonCode(pool, &buildPrimitives[0], count);
+				// A binary tree with at most one primitive per leaf has
+				// 2 * count - 1 nodes
+				std::vector<Node> buildNodes(2 * count - 1);
+				BuildContext context(&buildPrimitives[0], &buildNodes[0],
+				                     maxLeafSize, mode, pool);
+				buildSubtree(context, BuildTask(0, 0, (uint32)count, 0), 0);
+				if (pool)
+					pool->wait(context.group, 0);
+				// Sort the nodes into depth-first order, children are placed
+				// in the same order in which the single-threaded build
+				// allocates them
+				nodes.resize(context.nodeCount.get());
+				uint32 stack[StackSize][2];
+				unsigned int stackSize = 0;
+				stack[stackSize][0] = 0;
+				stack[stackSize++][1] = 0;
+				uint32 nodeCount = 1;
+				while (stackSize != 0)
+				{
+					stackSize--;
+					const Node &node = buildNodes[stack[stackSize][0]];
+					uint32 target = stack[stackSize][1];
+					nodes[target] = node;
+					if (node.isLeaf())
+						continue;
+					nodes[target].first = nodeCount;
+					stack[stackSize][0] = node.first + 1;
+					stack[stackSize++][1] = nodeCount + 1;
+					stack[stackSize][0] = node.first;
+					stack[stackSize++][1] = nodeCount;
+					nodeCount += 2;
+				}
+				for (size_t i = 0; i < count; i++)
+				{
+					indices[i] = buildPrimitives[i].index;
+					primitives[i] = boxes[indices[i]];
+				}
+			}
+			/**
+			 * Builds the subtree below a node. Child nodes with many
+			 * primitives are built in separate tasks if a thread pool is
+			 * used.
+			 */
+			static void buildSubtree(BuildContext &context,
+			                         const BuildTask &root,
+			                         unsigned int thread)
+			{
+				BuildTask stack[StackSize];
+				unsigned int stackSize = 0;
+				stack[stackSize++] = root;
+				while (stackSize != 0)
+				{
+					BuildTask task = stack[--stackSize];
+					uint32 split = splitNode(context, task);
+					if (split == task.begin)
+						continue;
+					uint32 left = (uint32)context.nodeCount.add(2) - 2;
+					context.nodes[task.node].first = left;
+					context.nodes[task.node].count = 0;
+					BuildTask children[2] =
+					{
+						BuildTask(left + 1, split, task.end, task.depth + 1),
+						BuildTask(left, task.begin, split, task.depth + 1)
+					};
+					for (unsigned int i = 0; i < 2; i++)
+					{
+						if (context.pool
+						 && children[i].end - children[i].begin >= ParallelThreshold)
+						{
+							context.pool->spawn(new SubtreeTask(context, children[i]),
+							                    context.group, thread);
+						}
+						else
+						{
+							stack[stackSize++] = children[i];
+						}
+					}
+				}
+			}
+			/**
+			 * Spreads the lower 10 bits of a value so that there are two zero
+			 * bits between every two bits.
+			 */
+			static uint32 expandBits(uint32 v)
+			{
+				v = (v * 0x00010001u) & 0xff0000ffu;
+				v = (v * 0x00000101u) & 0x0f00f00fu;
+				v = (v * 0x00000011u) & 0xc30c30c3u;
+				v = (v * 0x00000005u) & 0x49249249u;
+				return v;
+			}
+			/**
+			 * Computes 30-bit Morton codes for the centroids of the primitives
+			 * and sorts the primitives by them.
+			 */
+			static void sortByMortonCode(ThreadPool *pool,
+			                             BuildPrimitive *buildPrimitives,
+			                             size_t count)
+			{
+				Float4 half(0.5f);
+				Float4 centroidMin(FLT_MAX);
+				Float4 centroidMax(-FLT_MAX);
+				for (size_t i = 0; i < count; i++)
+				{
+					const BuildPrimitive &p = buildPrimitives[i];
+					Float4 centroid = (Float4::load(p.minCorner) + Float4::load(p.maxCorner)) * half;
+					centroidMin = min(centroidMin, centroid);
+					centroidMax = max(centroidMax, centroid);
+				}
+				float base[4];
+				float scale[4];
+				centroidMin.store(base);
+				(centroidMax - centroidMin).store(scale);
+				for (unsigned int i = 0; i < 3; i++)
+				{
+					scale[i] = scale[i] > 0 ? 1024.0f / scale[i] : 0;
+					if (scale[i] > FLT_MAX)
+						scale[i] = 0;
+				}
+				for (size_t i = 0; i < count; i++)
+				{
+					BuildPrimitive &p = buildPrimitives[i];
+					uint32 code = 0;
+					for (unsigned int j = 0; j < 3; j++)
+					{
+						uint32 cell = (uint32)((p.getCentroid(j) - base[j]) * scale[j]);
+						code |= expandBits(cell < 1024 ? cell : 1023) << (2 - j);
+					}
+					p.code = code;
+				}
+				if (!pool || count < ParallelThreshold)
+				{
+					std::sort(buildPrimitives, buildPrimitives + count, CompareCodes());
+					return;
+				}
+				// Sort a number of chunks in parallel and merge them pairwise,
+				// the order is unique, so the result does not depend on the
+				// number of chunks
+				unsigned int chunkCount = 1;
+				while (chunkCount < pool->getThreadCount() * 4)
+					chunkCount *= 2;
+				std::vector<BuildPrimitive*> chunks(chunkCount + 1);
+				for (unsigned int i = 0; i <= chunkCount; i++)
+					chunks[i] = buildPrimitives + count * i / chunkCount;
+				ThreadPool::TaskGroup group;
+				for (unsigned int i = 0; i < chunkCount; i++)
+					pool->spawn(new SortTask(chunks[i], 0, chunks[i + 1]), group, 0);
+				pool->wait(group, 0);
+				for (unsigned int width = 1; width < chunkCount; width *= 2)
+				{
+					for (unsigned int i = 0; i < chunkCount; i += 2 * width)
+					{
+						pool->spawn(new SortTask(chunks[i], chunks[i + width],
+						                         chunks[i + 2 * width]),
+						            group, 0);
+					}
+					pool->wait(group, 0);
+				}
+			}
+
+			/**
+			 * Computes the bounds of a node and splits its primitives.
+			 * @return Index of the first primitive of the right child, or
+			 * task.begin if the node was made a leaf.
+			 */
+			static uint32 splitNode(BuildContext &context, const BuildTask &task)
+			{
+				BuildPrimitive *first = context.primitives + task.begin;
+				BuildPrimitive *last = context.primitives + task.end;
+				Float4 half(0.5f);
+				Float4 boundsMin(FLT_MAX);
+				Float4 boundsMax(-FLT_MAX);
+				Float4 centroidMin(FLT_MAX);
+				Float4 centroidMax(-FLT_MAX);
+				for (BuildPrimitive *p = first; p != last; p++)
+				{
+					Float4 minCorner = Float4::load(p->minCorner);
+					Float4 maxCorner = Float4::load(p->maxCorner);
+					Float4 centroid = (minCorner + maxCorner) * half;
+					boundsMin = min(boundsMin, minCorner);
+					boundsMax = max(boundsMax, maxCorner);
+					centroidMin = min(centroidMin, centroid);
+					centroidMax = max(centroidMax, centroid);
+				}
+				Node &node = context.nodes[task.node];
+				float corner[4];
+				boundsMin.store(corner);
+				node.bounds.minCorner = Vec3f(corner[0], corner[1], corner[2]);
+				boundsMax.store(corner);
+				node.bounds.maxCorner = Vec3f(corner[0], corner[1], corner[2]);
+				uint32 count = task.end - task.begin;
+				if (count <= context.maxLeafSize)
+				{
+					node.first = task.begin;
+					node.count = count;
+					return task.begin;
+				}
+				if (context.mode == Morton)
+				{
+					uint32 firstCode = first->code;
+					uint32 lastCode = (last - 1)->code;
+					if (firstCode == lastCode)
+						return task.begin + count / 2;
+					// All codes in the range share the bits above the highest
+					// differing bit, split where this bit changes to 1
+					uint32 bit = firstCode ^ lastCode;
+					while (bit & (bit - 1))
+						bit &= bit - 1;
+					uint32 splitCode = lastCode & ~(bit - 1);
+					BuildPrimitive *middle = std::lower_bound(first, last, splitCode,
+					                                          CompareCodes());
+					return task.begin + (uint32)(middle - first);
+				}
+				float centroidBase[4];
+				float centroidSize[4];
+				centroidMin.store(centroidBase);
+				(centroidMax - centroidMin).store(centroidSize);
+				unsigned int largestAxis = 0;
+				if (centroidSize[1] > centroidSize[0])
+					largestAxis = 1;
+				if (centroidSize[2] > centroidSize[largestAxis])
+					largestAxis = 2;
+				if (task.depth < MedianDepth)
+				{
+					// Sort the primitives into bins along all three axes at
+					// once, axes without extent end up in a single bin and
+					// are never split
+					float scale[4];
+					for (unsigned int axis = 0; axis < 3; axis++)
+					{
+						float extent = centroidSize[axis];
+						scale[axis] = extent > 0 ? BinCount / extent : 0;
+						if (scale[axis] > FLT_MAX)
+							scale[axis] = 0;
+					}
+					scale[3] = 0;
+					Float4 binScale = Float4::load(scale);
+					Bin bins[3][BinCount];
+					for (BuildPrimitive *p = first; p != last; p++)
+					{
+						Float4 minCorner = Float4::load(p->minCorner);
+						Float4 maxCorner = Float4::load(p->maxCorner);
+						float scaled[4];
+						(((minCorner + maxCorner) * half - centroidMin) * binScale).store(scaled);
+						for (unsigned int axis = 0; axis < 3; axis++)
+						{
+							Bin &bin = bins[axis][getBin(scaled[axis])];
+							bin.minCorner = min(bin.minCorner, minCorner);
+							bin.maxCorner = max(bin.maxCorner, maxCorner);
+							bin.count++;
+						}
+					}
+					// Find the split with the lowest SAH cost, the costs of
+					// the right halves are computed in a sweep from the
+					// right, then the left halves are swept from the left
+					float bestCost = FLT_MAX;
+					unsigned int bestAxis = 0;
+					unsigned int bestBin = 0;
+					for (unsigned int axis = 0; axis < 3; axis++)
+					{
+						const Bin *axisBins = bins[axis];
+						float rightCost[BinCount];
+						Float4 rightMin(FLT_MAX);
+						Float4 rightMax(-FLT_MAX);
+						uint32 rightCount = 0;
+						for (unsigned int i = BinCount - 1; i > 0; i--)
+						{
+							rightMin = min(rightMin, axisBins[i].minCorner);
+							rightMax = max(rightMax, axisBins[i].maxCorner);
+							rightCount += axisBins[i].count;
+							rightCost[i - 1] = rightCount ? getSurfaceArea(rightMin, rightMax) * rightCount : 0;
+						}
+						Float4 leftMin(FLT_MAX);
+						Float4 leftMax(-FLT_MAX);
+						uint32 leftCount = 0;
+						for (unsigned int i = 0; i < BinCount - 1; i++)
+						{
+							leftMin = min(leftMin, axisBins[i].minCorner);
+							leftMax = max(leftMax, axisBins[i].maxCorner);
+							leftCount += axisBins[i].count;
+							if (leftCount == 0 || leftCount == count)
+								continue;
+							float cost = getSurfaceArea(leftMin, leftMax) * leftCount + rightCost[i];
+							if (cost < bestCost)
+							{
+								bestCost = cost;
+								bestAxis = axis;
+								bestBin = i;
+							}
+						}
+					}
+					if (bestCost != FLT_MAX)
+					{
+						IsLeftOfSplit isLeft(bestAxis, centroidBase[bestAxis],
+						                     scale[bestAxis], bestBin);
+						BuildPrimitive *middle = std::partition(first, last, isLeft);
+						if (middle != first && middle != last)
+							return task.begin + (uint32)(middle - first);
+					}
+				}
+				// All centroids are at the same position or the tree is too
+				// deep, split at the object median
+				BuildPrimitive *middle = first + count / 2;
+				std::nth_element(first, middle, last, CompareCentroids(largestAxis));
+				return task.begin + count / 2;
+			}
+
+			void addSubtree(const Node &root, std::vector<uint32> &result) const
+			{
+				uint32 stack[StackSize];
+				unsigned int stackSize = 0;
+				const Node *node = &root;
+				while (true)
+				{
+					if (node->isLeaf())
+					{
+						result.insert(result.end(),
+						              indices.begin() + node->first,
+						              indices.begin() + node->first + node->count);
+						if (stackSize == 0)
+							return;
+						node = &nodes[stack[--stackSize]];
+					}
+					else
+					{
+						stack[stackSize++] = node->first + 1;
+						node = &nodes[node->first];
+					}
+				}
+			}
+
+			std::vector<Node> nodes;
+			std::vector<uint32> indices;
+			/**
+			 * Copy of the primitive boxes in the order of indices, so that
+			 * the boxes of a leaf are next to each other in memory.
+			 */
+			std::vector<BoundingBox> primitives;
+	};
+}
+
+#endif
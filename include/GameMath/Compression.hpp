@@ -0,0 +1,498 @@
+/*
+Copyright (C) 2011, Mathias Gottschlag
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef GAMEMATH_COMPRESSION_HPP_INCLUDED
+#define GAMEMATH_COMPRESSION_HPP_INCLUDED
+
+#include "BoundingBox.hpp"
+#include "Platform.hpp"
+#include "Quaternion.hpp"
+#include "Simd.hpp"
+#include "Types.hpp"
+#include "Vec3.hpp"
+
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+
+namespace math
+{
+	/**
+	 * Converts a float to a IEEE 754 half precision float with rounding to
+	 * the nearest value. Values which are too large become infinity, NaN
+	 * stays NaN. For normalized results the relative error is at most
+	 * 2^-11 (about 0.05%), values between 2^-24 and 2^-14 are stored as
+	 * denormals with an absolute error of at most 2^-25.
+	 */
+	inline uint16 floatToHalf(float value)
+	{
+		uint32 f;
+		memcpy(&f, &value, 4);
+		uint32 sign = f & 0x80000000;
+		f ^= sign;
+		uint32 result;
+		if (f >= 0x47800000)
+		{
+			// Overflow, infinity or NaN
+			result = f > 0x7f800000 ? 0x7e00 : 0x7c00;
+		}
+		else if (f < 0x38800000)
+		{
+			// Denormals and zero, the addition shifts the mantissa into
+			// place and rounds it
+			float shifted;
+			memcpy(&shifted, &f, 4);
+			shifted += 0.5f;
+			memcpy(&result, &shifted, 4);
+			result -= 0x3f000000;
+		}
+		else
+		{
+			// Rebias the exponent and round to nearest even
+			uint32 odd = (f >> 13) & 1;
+			f += 0xc8000fff + odd;
+			result = f >> 13;
+		}
+		return (uint16)(result | (sign >> 16));
+	}
+	/**
+	 * Converts a half precision float to a float. The conversion is exact.
+	 */
+	inline float halfToFloat(uint16 half)
+	{
+		uint32 result = (uint32)(half & 0x7fff) << 13;
+		uint32 exponent = result & 0x0f800000;
+		result += (127 - 15) << 23;
+		if (exponent == 0x0f800000)
+		{
+			// Infinity or NaN
+			result += (128 - 16) << 23;
+		}
+		else if (exponent == 0)
+		{
+			// Denormal, renormalized by the float subtraction
+			result += 1 << 23;
+			float value;
+			memcpy(&value, &result, 4);
+			value -= 6.103515625e-05f;
+			memcpy(&result, &value, 4);
+		}
+		result |= (uint32)(half & 0x8000) << 16;
+		float value;
+		memcpy(&value, &result, 4);
+		return value;
+	}
+	/**
+	 * Converts an array of floats to half precision floats, see
+	 * floatToHalf(). Uses the F16C instructions if available, which
+	 * produce the same results for all non-NaN inputs. floatToHalf() converts
+	 * NaNs to the quiet NaN 0x7e00 (keeping the sign), whereas F16C keeps
+	 * the upper bits of the payload.
+	 */
+	inline void floatsToHalves(const float *values, uint16 *halves, size_t count)
+	{
+		size_t i = 0;
+#if defined(GAMEMATH_F16C)
+		size_t simdCount = count & ~(size_t)7;
+		for (; i < simdCount; i += 8)
+		{
+			__m128i converted = _mm256_cvtps_ph(_mm256_loadu_ps(values + i),
+			                                    _MM_FROUND_TO_NEAREST_INT);
+			_mm_storeu_si128((__m128i*)(halves + i), converted);
+		}
+#endif
+		for (; i < count; i++)
+			halves[i] = floatToHalf(values[i]);
+	}
+	/**
+	 * Converts an array of half precision floats to floats, see
+	 * halfToFloat().
+	 */
+	inline void halvesToFloats(const uint16 *halves, float *values, size_t count)
+	{
+		size_t i = 0;
+#if defined(GAMEMATH_F16C)
+		size_t simdCount = count & ~(size_t)7;
+		for (; i < simdCount; i += 8)
+		{
+			__m128i packed = _mm_loadu_si128((const __m128i*)(halves + i));
+			_mm256_storeu_ps(values + i, _mm256_cvtph_ps(packed));
+		}
+#endif
+		for (; i < count; i++)
+			values[i] = halfToFloat(halves[i]);
+	}
+
+	/**
+	 * Smallest-three quaternion encoding. The largest component of a
+	 * normalized quaternion can be reconstructed from the other three, so
+	 * only its index (2 bits) and the three other components are stored.
+	 * The quaternion is negated if necessary so that the largest component
+	 * is positive. The other components are within [-1/sqrt(2), 1/sqrt(2)]
+	 * and are quantized uniformly with Bits bits each.
+	 */
+	template<unsigned int Bits> class SmallestThree
+	{
+	public:
+		/**
+		 * Encodes a normalized quaternion into the lower 2 + 3 * Bits bits
+		 * of the result.
+		 */
+		static uint64 encode(const Quaternion &q)
+		{
+			unsigned int largest = 0;
+			float largestValue = fabsf(q.x);
+			if (fabsf(q.y) > largestValue)
+			{
+				largest = 1;
+				largestValue = fabsf(q.y);
+			}
+			if (fabsf(q.z) > largestValue)
+			{
+				largest = 2;
+				largestValue = fabsf(q.z);
+			}
+			if (fabsf(q.w) > largestValue)
+				largest = 3;
+			float a, b, c, d;
+			switch (largest)
+			{
+				case 0:
+					a = q.y;
+					b = q.z;
+					c = q.w;
+					d = q.x;
+					break;
+				case 1:
+					a = q.x;
+					b = q.z;
+					c = q.w;
+					d = q.y;
+					break;
+				case 2:
+					a = q.x;
+					b = q.y;
+					c = q.w;
+					d = q.z;
+					break;
+				default:
+					a = q.x;
+					b = q.y;
+					c = q.z;
+					d = q.w;
+					break;
+			}
+			float scale = d < 0.0f ? -Scale : Scale;
+			return ((uint64)largest << (3 * Bits))
+			     | ((uint64)quantize(a * scale) << (2 * Bits))
+			     | ((uint64)quantize(b * scale) << Bits)
+			     | (uint64)quantize(c * scale);
+		}
+		/**
+		 * Decodes a quaternion which was encoded with encode().
+		 */
+		static Quaternion decode(uint64 bits)
+		{
+			unsigned int largest = (unsigned int)(bits >> (3 * Bits)) & 3;
+			float a = (float)(uint32)((bits >> (2 * Bits)) & MaxValue) * InvScale - Range;
+			float b = (float)(uint32)((bits >> Bits) & MaxValue) * InvScale - Range;
+			float c = (float)(uint32)(bits & MaxValue) * InvScale - Range;
+			float sum = a * a + b * b + c * c;
+			float d = sum < 1.0f ? sqrtf(1.0f - sum) : 0.0f;
+			switch (largest)
+			{
+				case 0:
+					return Quaternion(d, a, b, c);
+				case 1:
+					return Quaternion(a, d, b, c);
+				case 2:
+					return Quaternion(a, b, d, c);
+				default:
+					return Quaternion(a, b, c, d);
+			}
+		}
+
+		static const uint32 MaxValue = (1u << Bits) - 1;
+	private:
+		/**
+		 * Quantizes a component which was already multiplied by Scale.
+		 */
+		static uint32 quantize(float value)
+		{
+			value += (float)MaxValue * 0.5f;
+			// Clamp against rounding errors of unnormalized input
+			if (value < 0.0f)
+				value = 0.0f;
+			if (value > (float)MaxValue)
+				value = (float)MaxValue;
+			return (uint32)(value + 0.5f);
+		}
+
+		static const float Range;
+		static const float Scale;
+		static const float InvScale;
+	};
+	template<unsigned int Bits> const float SmallestThree<Bits>::Range = 0.70710678f;
+	template<unsigned int Bits> const float SmallestThree<Bits>::Scale
+		= (float)((1u << Bits) - 1) / (2.0f * 0.70710678f);
+	template<unsigned int Bits> const float SmallestThree<Bits>::InvScale
+		= (2.0f * 0.70710678f) / (float)((1u << Bits) - 1);
+
+	/**
+	 * Quaternion compressed to 32 bits (10 bits per component, see
+	 * SmallestThree). Each stored component has an error of at most
+	 * 0.00069, the resulting rotation differs from the original one by
+	 * less than 0.005 radians (0.29 degrees).
+	 */
+	struct PackedQuaternion32
+	{
+		PackedQuaternion32()
+			: bits(0)
+		{
+		}
+		explicit PackedQuaternion32(const Quaternion &q)
+			: bits((uint32)SmallestThree<10>::encode(q))
+		{
+		}
+		Quaternion unpack() const
+		{
+			return SmallestThree<10>::decode(bits);
+		}
+		/**
+		 * Compresses an array of normalized quaternions.
+		 */
+		static void pack(const Quaternion *in, PackedQuaternion32 *out,
+		                 size_t count)
+		{
+			for (size_t i = 0; i < count; i++)
+				out[i].bits = (uint32)SmallestThree<10>::encode(in[i]);
+		}
+		/**
+		 * Decompresses an array of quaternions.
+		 */
+		static void unpack(const PackedQuaternion32 *in, Quaternion *out,
+		                   size_t count)
+		{
+			for (size_t i = 0; i < count; i++)
+				out[i] = SmallestThree<10>::decode(in[i].bits);
+		}
+
+		uint32 bits;
+	};
+	/**
+	 * Quaternion compressed to 48 bits (15 bits per component, see
+	 * SmallestThree). Each stored component has an error of at most
+	 * 0.000022, the resulting rotation differs from the original one by
+	 * less than 0.00015 radians.
+	 */
+	struct PackedQuaternion48
+	{
+		PackedQuaternion48()
+		{
+			bits[0] = bits[1] = bits[2] = 0;
+		}
+		explicit PackedQuaternion48(const Quaternion &q)
+		{
+			set(SmallestThree<15>::encode(q));
+		}
+		Quaternion unpack() const
+		{
+			return SmallestThree<15>::decode(get());
+		}
+		/**
+		 * Compresses an array of normalized quaternions.
+		 */
+		static void pack(const Quaternion *in, PackedQuaternion48 *out,
+		                 size_t count)
+		{
+			for (size_t i = 0; i < count; i++)
+				out[i].set(SmallestThree<15>::encode(in[i]));
+		}
+		/**
+		 * Decompresses an array of quaternions.
+		 */
+		static void unpack(const PackedQuaternion48 *in, Quaternion *out,
+		                   size_t count)
+		{
+			for (size_t i = 0; i < count; i++)
+				out[i] = SmallestThree<15>::decode(in[i].get());
+		}
+
+		/**
+		 * Encoded bits, least significant part first. Stored as three
+		 * 16-bit values so that arrays are packed without padding.
+		 */
+		uint16 bits[3];
+	private:
+		void set(uint64 value)
+		{
+			bits[0] = (uint16)value;
+			bits[1] = (uint16)(value >> 16);
+			bits[2] = (uint16)(value >> 32);
+		}
+		uint64 get() const
+		{
+			return (uint64)bits[0] | ((uint64)bits[1] << 16)
+			     | ((uint64)bits[2] << 32);
+		}
+	};
+
+	/**
+	 * Vector quantized to 16 bits per component, see Vec3Quantizer.
+	 */
+	struct QuantizedVec3
+	{
+		uint16 x;
+		uint16 y;
+		uint16 z;
+	};
+
+	/**
+	 * Quantizes positions within a bounding box to integers with a fixed
+	 * number of bits per component. The maximum error per component is half
+	 * of the size of one quantization step, see getMaxError(). Positions
+	 * outside of the box are clamped to the box.
+	 */
+	class Vec3Quantizer
+	{
+	public:
+		/**
+		 * Constructor.
+		 * @param range Box which contains all positions.
+		 * @param bits Bits per component, between 1 and 16.
+		 */
+		Vec3Quantizer(const BoundingBox &range, unsigned int bits = 16)
+			: offset(range.minCorner),
+			  maxValue((float)((1u << bits) - 1))
+		{
+			Vec3f size = range.maxCorner - range.minCorner;
+			scale = Vec3f(size.x > 0.0f ? maxValue / size.x : 0.0f,
+			              size.y > 0.0f ? maxValue / size.y : 0.0f,
+			              size.z > 0.0f ? maxValue / size.z : 0.0f);
+			step = size / maxValue;
+		}
+
+		/**
+		 * Returns the maximum error of a quantized component, which is half
+		 * of the size of the box divided by 2^bits - 1.
+		 */
+		Vec3f getMaxError() const
+		{
+			return step * 0.5f;
+		}
+
+		QuantizedVec3 quantize(const Vec3f &v) const
+		{
+			QuantizedVec3 result;
+			result.x = quantizeComponent(v.x, offset.x, scale.x);
+			result.y = quantizeComponent(v.y, offset.y, scale.y);
+			result.z = quantizeComponent(v.z, offset.z, scale.z);
+			return result;
+		}
+		Vec3f dequantize(const QuantizedVec3 &v) const
+		{
+			return Vec3f(offset.x + (float)v.x * step.x,
+			             offset.y + (float)v.y * step.y,
+			             offset.z + (float)v.z * step.z);
+		}
+		/**
+		 * Quantizes an array of positions. Four positions are processed at
+		 * once.
+		 */
+		void quantize(const Vec3f *in, QuantizedVec3 *out, size_t count) const
+		{
+			Float4 offsetX(offset.x);
+			Float4 offsetY(offset.y);
+			Float4 offsetZ(offset.z);
+			Float4 scaleX(scale.x);
+			Float4 scaleY(scale.y);
+			Float4 scaleZ(scale.z);
+			Float4 zero = Float4::zero();
+			Float4 maximum(maxValue);
+			Float4 half(0.5f);
+			size_t simdCount = count & ~(size_t)3;
+			size_t i = 0;
+			for (; i < simdCount; i += 4)
+			{
+				Float4 x, y, z;
+				loadInterleaved3(&in[i].x, x, y, z);
+				x = min(max((x - offsetX) * scaleX, zero), maximum) + half;
+				y = min(max((y - offsetY) * scaleY, zero), maximum) + half;
+				z = min(max((z - offsetZ) * scaleZ, zero), maximum) + half;
+				float values[12];
+				storeInterleaved3(values, x, y, z);
+				for (unsigned int j = 0; j < 4; j++)
+				{
+					out[i + j].x = (uint16)values[3 * j];
+					out[i + j].y = (uint16)values[3 * j + 1];
+					out[i + j].z = (uint16)values[3 * j + 2];
+				}
+			}
+			for (; i < count; i++)
+				out[i] = quantize(in[i]);
+		}
+		/**
+		 * Dequantizes an array of positions. Four positions are processed
+		 * at once.
+		 */
+		void dequantize(const QuantizedVec3 *in, Vec3f *out, size_t count) const
+		{
+			Float4 offsetX(offset.x);
+			Float4 offsetY(offset.y);
+			Float4 offsetZ(offset.z);
+			Float4 stepX(step.x);
+			Float4 stepY(step.y);
+			Float4 stepZ(step.z);
+			size_t simdCount = count & ~(size_t)3;
+			size_t i = 0;
+			for (; i < simdCount; i += 4)
+			{
+				Float4 x((float)in[i].x, (float)in[i + 1].x,
+				         (float)in[i + 2].x, (float)in[i + 3].x);
+				Float4 y((float)in[i].y, (float)in[i + 1].y,
+				         (float)in[i + 2].y, (float)in[i + 3].y);
+				Float4 z((float)in[i].z, (float)in[i + 1].z,
+				         (float)in[i + 2].z, (float)in[i + 3].z);
+				storeInterleaved3(&out[i].x, offsetX + x * stepX,
+				                  offsetY + y * stepY, offsetZ + z * stepZ);
+			}
+			for (; i < count; i++)
+				out[i] = dequantize(in[i]);
+		}
+	private:
+		uint16 quantizeComponent(float value, float offset, float scale) const
+		{
+			float quantized = (value - offset) * scale;
+			if (quantized < 0.0f)
+				quantized = 0.0f;
+			if (quantized > maxValue)
+				quantized = maxValue;
+			return (uint16)(quantized + 0.5f);
+		}
+
+		Vec3f offset;
+		Vec3f scale;
+		Vec3f step;
+		float maxValue;
+	};
+}
+
+#endif
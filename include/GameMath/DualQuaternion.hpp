@@ -0,0 +1,202 @@
+/*
+Copyright (C) 2011, Mathias Gottschlag
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef GAMEMATH_DUALQUATERNION_HPP_INCLUDED
+#define GAMEMATH_DUALQUATERNION_HPP_INCLUDED
+
+#include "Mat4.hpp"
+#include "Quaternion.hpp"
+#include "Vec3.hpp"
+
+#include <cmath>
+
+namespace math
+{
+	/**
+	 * Dual quaternion which stores a rigid transformation (rotation and
+	 * translation). Unlike matrices, dual quaternions can be blended
+	 * without introducing scale or shear, which makes them useful for
+	 * skinning.
+	 *
+	 * The transformation is real + eps * dual with dual = 0.5 * t * real,
+	 * where t is the translation as a pure quaternion. Scale cannot be
+	 * represented and has to be applied separately.
+	 */
+	class DualQuaternion
+	{
+	public:
+		/**
+		 * Constructor, creates the identity transformation.
+		 */
+		DualQuaternion()
+			: real(0, 0, 0, 1), dual(0, 0, 0, 0)
+		{
+		}
+		/**
+		 * Constructor.
+		 */
+		DualQuaternion(const Quaternion &real, const Quaternion &dual)
+			: real(real), dual(dual)
+		{
+		}
+		/**
+		 * Creates a transformation which first rotates and then translates.
+		 * The rotation has to be normalized.
+		 */
+		DualQuaternion(const Quaternion &rotation, const Vec3f &translation)
+			: real(rotation),
+			  dual(Quaternion(translation.x, translation.y, translation.z, 0)
+			       * rotation * 0.5f)
+		{
+		}
+		/**
+		 * Creates a dual quaternion from a matrix which only contains
+		 * rotation and translation.
+		 */
+		explicit DualQuaternion(const Mat4f &m)
+		{
+			*this = DualQuaternion(Quaternion(m), Vec3f(m(0, 3), m(1, 3), m(2, 3)));
+		}
+
+		/**
+		 * Returns the rotation part of the transformation.
+		 */
+		const Quaternion &getRotation() const
+		{
+			return real;
+		}
+		/**
+		 * Returns the translation part of the transformation. The dual
+		 * quaternion has to be normalized.
+		 */
+		Vec3f getTranslation() const
+		{
+			// Vector part of 2 * dual * conjugate(real)
+			Vec3f r(real.x, real.y, real.z);
+			Vec3f d(dual.x, dual.y, dual.z);
+			return (d * real.w - r * dual.w + r.cross(d)) * 2.0f;
+		}
+		/**
+		 * Creates a transformation matrix. The dual quaternion has to be
+		 * normalized.
+		 */
+		Mat4f toMatrix() const
+		{
+			Mat4f m = real.toMatrix();
+			Vec3f translation = getTranslation();
+			m(0, 3) = translation.x;
+			m(1, 3) = translation.y;
+			m(2, 3) = translation.z;
+			return m;
+		}
+		/**
+		 * Transforms a point. The dual quaternion has to be normalized.
+		 */
+		Vec3f transformPoint(const Vec3f &point) const
+		{
+			return real.rotate(point) + getTranslation();
+		}
+
+		/**
+		 * Normalizes the dual quaternion so that it represents a rigid
+		 * transformation again, e.g. after blending.
+		 */
+		void normalize()
+		{
+			float length = sqrtf(real.dot(real));
+			real /= length;
+			dual /= length;
+			// The dual part has to be orthogonal to the real part
+			dual -= real * real.dot(dual);
+		}
+		/**
+		 * Blends dual quaternions (dual quaternion linear blending). The
+		 * quaternions are negated if necessary so that they are in the same
+		 * hemisphere as the first one, and the result is normalized.
+		 * \param dualQuaternions Dual quaternions to blend.
+		 * \param weights Weight of every dual quaternion.
+		 * \param count Number of dual quaternions, at least 1.
+		 */
+		static DualQuaternion blend(const DualQuaternion *dualQuaternions,
+			const float *weights, unsigned int count)
+		{
+			DualQuaternion result = dualQuaternions[0] * weights[0];
+			const Quaternion &pivot = dualQuaternions[0].real;
+			for (unsigned int i = 1; i < count; i++)
+			{
+				float weight = weights[i];
+				if (pivot.dot(dualQuaternions[i].real) < 0.0f)
+					weight = -weight;
+				result += dualQuaternions[i] * weight;
+			}
+			result.normalize();
+			return result;
+		}
+
+		/**
+		 * Concatenates two transformations, the result first applies other
+		 * and then this transformation.
+		 */
+		DualQuaternion operator*(const DualQuaternion &other) const
+		{
+			return DualQuaternion(real * other.real,
+				real * other.dual + dual * other.real);
+		}
+		DualQuaternion &operator*=(const DualQuaternion &other)
+		{
+			*this = *this * other;
+			return *this;
+		}
+		DualQuaternion operator*(float s) const
+		{
+			return DualQuaternion(real * s, dual * s);
+		}
+		DualQuaternion operator+(const DualQuaternion &other) const
+		{
+			return DualQuaternion(real + other.real, dual + other.dual);
+		}
+		DualQuaternion &operator+=(const DualQuaternion &other)
+		{
+			real += other.real;
+			dual += other.dual;
+			return *this;
+		}
+		bool operator==(const DualQuaternion &other) const
+		{
+			return real == other.real && dual == other.dual;
+		}
+		bool operator!=(const DualQuaternion &other) const
+		{
+			return !(*this == other);
+		}
+
+		/**
+		 * Rotation part.
+		 */
+		Quaternion real;
+		/**
+		 * Translation part.
+		 */
+		Quaternion dual;
+	};
+}
+
+#endif
@@ -24,25 +24,105 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #include "BoundingBox.hpp"
 #include "Plane.hpp"
+#include "Simd.hpp"
+#include "Vec3Stream.hpp"
+
+#include <cstring>
+#include <vector>
 
 namespace math
 {
 	class Frustum
 	{
 		public:
+			/**
+			 * Result of an intersection test with a volume.
+			 */
+			enum Intersection
+			{
+				/**
+				 * The volume is completely outside of the frustum.
+				 */
+				Outside,
+				/**
+				 * The volume is partially inside of the frustum.
+				 */
+				Intersecting,
+				/**
+				 * The volume is completely inside of the frustum.
+				 */
+				Inside
+			};
+			/**
+			 * Plane mask for classify() which contains all six planes.
+			 */
+			static const unsigned int AllPlanes = 0x3f;
+			/**
+			 * Maximum number of vertices of a triangle clipped by
+			 * clipTriangles(). Clipping a convex triangle against six planes
+			 * yields at most nine vertices, the rest is headroom for
+			 * polygons which rounding left slightly non-convex.
+			 */
+			static const unsigned int MaxClipVertices = 16;
+
 			Frustum()
 			{
+				updatePlaneSigns();
 			}
 			Frustum(const Mat4f &projmat)
 			{
 				setProjectionMatrix(projmat);
 			}
 
+			/**
+			 * Sets the projection matrix (usually projection * view) and
+			 * extracts the planes of the frustum from it.
+			 *
+			 * The planes are computed directly from the rows of the matrix
+			 * (Gribb/Hartmann), a point p is inside of the clip volume if
+			 * -w <= x, y, z <= w for (x, y, z, w) = projmat * (p, 1). The
+			 * resulting planes are normalized and their normal vectors point
+			 * inside.
+			 */
 			void setProjectionMatrix(const Mat4f &projmat)
 			{
 				this->projmat = projmat;
+				const Mat4f &m = projmat;
+				// Near plane
+				planes[0] = Plane(m(3, 0) + m(2, 0), m(3, 1) + m(2, 1),
+				                  m(3, 2) + m(2, 2), -(m(3, 3) + m(2, 3)));
+				// Left plane
+				planes[1] = Plane(m(3, 0) + m(0, 0), m(3, 1) + m(0, 1),
+				                  m(3, 2) + m(0, 2), -(m(3, 3) + m(0, 3)));
+				// Top plane
+				planes[2] = Plane(m(3, 0) - m(1, 0), m(3, 1) - m(1, 1),
+				                  m(3, 2) - m(1, 2), -(m(3, 3) - m(1, 3)));
+				// Right plane
+				planes[3] = Plane(m(3, 0) - m(0, 0), m(3, 1) - m(0, 1),
+				                  m(3, 2) - m(0, 2), -(m(3, 3) - m(0, 3)));
+				// Bottom plane
+				planes[4] = Plane(m(3, 0) + m(1, 0), m(3, 1) + m(1, 1),
+				                  m(3, 2) + m(1, 2), -(m(3, 3) + m(1, 3)));
+				// Far plane
+				planes[5] = Plane(m(3, 0) - m(2, 0), m(3, 1) - m(2, 1),
+				                  m(3, 2) - m(2, 2), -(m(3, 3) - m(2, 3)));
+				for (unsigned int i = 0; i < 6; i++)
+					planes[i].normalize();
+				updatePlaneSigns();
+			}
+
+			/**
+			 * Computes the corners of the frustum in world space. This
+			 * inverts the projection matrix, so it is slow compared to
+			 * setProjectionMatrix().
+			 * @param corners Array with room for eight corners. The first
+			 * four corners are on the near plane, the last four on the far
+			 * plane, both in the order top left, top right, bottom right,
+			 * bottom left.
+			 */
+			void getCorners(Vec3f *corners) const
+			{
 				Mat4f projmatinv = projmat.inverse();
-				// Corners of the frustum in world space
 				corners[0] = projmatinv.transformPoint(Vec3f(-1, 1, -1));
 				corners[1] = projmatinv.transformPoint(Vec3f(1, 1, -1));
 				corners[2] = projmatinv.transformPoint(Vec3f(1, -1, -1));
@@ -51,22 +131,9 @@ namespace math
 				corners[5] = projmatinv.transformPoint(Vec3f(1, 1, 1));
 				corners[6] = projmatinv.transformPoint(Vec3f(1, -1, 1));
 				corners[7] = projmatinv.transformPoint(Vec3f(-1, -1, 1));
-				// Near plane
-				planes[0] = Plane(corners[0], corners[1], corners[2]);
-				// Left plane
-				planes[1] = Plane(corners[0], corners[3], corners[4]);
-				// Top plane
-				planes[2] = Plane(corners[0], corners[1], corners[4]);
-				// Right plane
-				planes[3] = Plane(corners[1], corners[2], corners[5]);
-				// Bottom plane
-				planes[4] = Plane(corners[2], corners[3], corners[6]);
-				// Far plane
-				planes[5] = Plane(corners[4], corners[5], corners[6]);
-				// TODO: Fix normal vectors to point inside!
 			}
 
-			bool isInside(const Vec3f &point)
+			bool isInside(const Vec3f &point) const
 			{
 				for (unsigned int i = 0; i < 6; i++)
 				{
@@ -83,15 +150,395 @@ namespace math
 			 * http://www.lighthouse3d.com/opengl/viewfrustum/index.php?gatest3
 			 * for an explanation of the algorithm used.
 			 */
-			bool isInside(const BoundingBox &box)
+			bool isInside(const BoundingBox &box) const
+			{
+				return classify(box) != Outside;
+			}
+			/**
+			 * Computes whether a box is outside of the frustum, intersects
+			 * it or is completely inside.
+			 *
+			 * For every plane only the corner of the box which is furthest in
+			 * the direction of the normal (the p-vertex) and the opposite
+			 * corner (the n-vertex) are checked. If the p-vertex is behind a
+			 * plane, the box is outside, if the n-vertex is behind a plane,
+			 * the box intersects the frustum. As with isInside(), boxes close
+			 * to the edges of the frustum can be classified as intersecting
+			 * although they are outside.
+			 */
+			Intersection classify(const BoundingBox &box) const
+			{
+				Intersection result = Inside;
+				for (unsigned int i = 0; i < 6; i++)
+				{
+					Intersection planeresult = classifyPlane(box, i);
+					if (planeresult == Outside)
+						return Outside;
+					if (planeresult == Intersecting)
+						result = Intersecting;
+				}
+				return result;
+			}
+			/**
+			 * Version of classify() which exploits temporal and spatial
+			 * coherence. The result is the same as the one of
+			 * classify(const BoundingBox&) if all planes are tested.
+			 *
+			 * The plane which rejected the box during the last call is tested
+			 * first, as objects tend to fail the same plane frame after
+			 * frame. Additionally, planes can be skipped if a parent box of
+			 * this box was already completely on their positive side.
+			 * @param box Box to test.
+			 * @param cachedPlane Per-object cache slot. Holds the index of the
+			 * plane which rejected the box during the last call and is
+			 * updated if the box is rejected by a different plane. Should be
+			 * initialized to 0.
+			 * @param planeMask Planes which have to be tested, bit i stands
+			 * for planes[i]. Planes which are not in the mask are assumed to
+			 * contain the box completely.
+			 * @param childMask If not 0, receives the planes which intersect
+			 * the box. Can be used as planeMask for boxes contained in this
+			 * box.
+			 */
+			Intersection classify(const BoundingBox &box,
+			                      uint8 &cachedPlane,
+			                      unsigned int planeMask = AllPlanes,
+			                      unsigned int *childMask = 0) const
+			{
+				unsigned int intersecting = 0;
+				if (planeMask & (1 << cachedPlane))
+				{
+					Intersection planeresult = classifyPlane(box, cachedPlane);
+					if (planeresult == Outside)
+						return Outside;
+					if (planeresult == Intersecting)
+						intersecting |= 1 << cachedPlane;
+					planeMask &= ~(1 << cachedPlane);
+				}
+				for (unsigned int i = 0; i < 6; i++)
+				{
+					if (!(planeMask & (1 << i)))
+						continue;
+					Intersection planeresult = classifyPlane(box, i);
+					if (planeresult == Outside)
+					{
+						cachedPlane = (uint8)i;
+						return Outside;
+					}
+					if (planeresult == Intersecting)
+						intersecting |= 1 << i;
+				}
+				if (childMask)
+					*childMask = intersecting;
+				return intersecting ? Intersecting : Inside;
+			}
+			/**
+			 * Tests a box against a single plane of the frustum.
+			 * @return Outside if the box is completely behind the plane,
+			 * Inside if it is completely in front of the plane, Intersecting
+			 * otherwise.
+			 */
+			Intersection classifyPlane(const BoundingBox &box, unsigned int plane) const
+			{
+				unsigned int signs = planeSigns[plane];
+				Vec3f pvertex((signs & 1) ? box.maxCorner.x : box.minCorner.x,
+				              (signs & 2) ? box.maxCorner.y : box.minCorner.y,
+				              (signs & 4) ? box.maxCorner.z : box.minCorner.z);
+				if (planes[plane].getDistance(pvertex) < 0)
+					return Outside;
+				Vec3f nvertex((signs & 1) ? box.minCorner.x : box.maxCorner.x,
+				              (signs & 2) ? box.minCorner.y : box.maxCorner.y,
+				              (signs & 4) ? box.minCorner.z : box.maxCorner.z);
+				if (planes[plane].getDistance(nvertex) < 0)
+					return Intersecting;
+				return Inside;
+			}
+
+			/**
+			 * Tests an array of boxes against the frustum and marks all boxes
+			 * which are at least partially inside. The result is the same as
+			 * calling isInside() for every box up to rounding on boxes which
+			 * touch a plane, as the distances are computed in a different
+			 * order, but four boxes are tested at once.
+			 * @param boxes Boxes to test.
+			 * @param count Number of boxes.
+			 * @param visibleMask Bit mask with room for (count + 31) / 32
+			 * values. Bit i % 32 of visibleMask[i / 32] is set if box i is
+			 * visible.
+			 */
+			void cullBoxes(const BoundingBox *boxes,
+			               size_t count,
+			               uint32 *visibleMask) const
+			{
+				memset(visibleMask, 0, ((count + 31) / 32) * sizeof(uint32));
+				Float4 nx[6], ny[6], nz[6], d[6];
+				for (unsigned int j = 0; j < 6; j++)
+				{
+					nx[j] = Float4(planes[j].normal.x);
+					ny[j] = Float4(planes[j].normal.y);
+					nz[j] = Float4(planes[j].normal.z);
+					d[j] = Float4(planes[j].d);
+				}
+				size_t simdCount = count & ~(size_t)3;
+				size_t i = 0;
+				for (; i < simdCount; i += 4)
+				{
+					// Convert four boxes to SoA form, the second half of the
+					// box is loaded with an offset of two floats so that no
+					// memory behind the last box is read
+					const float *box = &boxes[i].minCorner.x;
+					Float4 minx = Float4::load(box);
+					Float4 miny = Float4::load(box + 6);
+					Float4 minz = Float4::load(box + 12);
+					Float4 maxx = Float4::load(box + 18);
+					transpose(minx, miny, minz, maxx);
+					Float4 maxy = Float4::load(box + 2);
+					Float4 maxz = Float4::load(box + 8);
+					Float4 tmp1 = Float4::load(box + 14);
+					Float4 tmp2 = Float4::load(box + 20);
+					transpose(maxy, maxz, tmp1, tmp2);
+					maxy = tmp1;
+					maxz = tmp2;
+					Float4 outside = Float4::zero();
+					for (unsigned int j = 0; j < 6; j++)
+					{
+						unsigned int signs = planeSigns[j];
+						const Float4 &px = (signs & 1) ? maxx : minx;
+						const Float4 &py = (signs & 2) ? maxy : miny;
+						const Float4 &pz = (signs & 4) ? maxz : minz;
+						Float4 distance = madd(nz[j], pz, madd(ny[j], py, nx[j] * px)) - d[j];
+						outside = outside | (distance < Float4::zero());
+					}
+					visibleMask[i / 32] |= (uint32)(~outside.mask() & 0xf) << (i % 32);
+				}
+				for (; i < count; i++)
+				{
+					if (classify(boxes[i]) != Outside)
+						visibleMask[i / 32] |= 1u << (i % 32);
+				}
+			}
+			/**
+			 * Version of cullBoxes() which uses a per-box plane cache, see
+			 * classify(const BoundingBox&, uint8&, unsigned int, unsigned int*).
+			 * This is faster than the SIMD versions if most boxes are
+			 * rejected by the same plane as in the last call.
+			 * @param planeCache Cache slots, one for each box.
+			 */
+			void cullBoxes(const BoundingBox *boxes,
+			               size_t count,
+			               uint32 *visibleMask,
+			               uint8 *planeCache) const
 			{
-				// TODO
-				return false;
+				memset(visibleMask, 0, ((count + 31) / 32) * sizeof(uint32));
+				for (size_t i = 0; i < count; i++)
+				{
+					if (classify(boxes[i], planeCache[i]) != Outside)
+						visibleMask[i / 32] |= 1u << (i % 32);
+				}
+			}
+			/**
+			 * Tests boxes in SoA form against the frustum, see
+			 * cullBoxes(const BoundingBox*, size_t, uint32*). This variant
+			 * tests SimdFloat::Width boxes at once.
+			 * @param minCorners Minimum corners of the boxes.
+			 * @param maxCorners Maximum corners of the boxes, has to have the
+			 * same size as minCorners.
+			 * @param visibleMask Bit mask with room for
+			 * (minCorners.size() + 31) / 32 values.
+			 */
+			void cullBoxes(const Vec3Streamf &minCorners,
+			               const Vec3Streamf &maxCorners,
+			               uint32 *visibleMask) const
+			{
+				size_t count = minCorners.size();
+				memset(visibleMask, 0, ((count + 31) / 32) * sizeof(uint32));
+				// The p-vertex is selected for each plane instead of for each
+				// box
+				const float *px[6], *py[6], *pz[6];
+				SimdFloat nx[6], ny[6], nz[6], d[6];
+				for (unsigned int j = 0; j < 6; j++)
+				{
+					unsigned int signs = planeSigns[j];
+					px[j] = (signs & 1) ? maxCorners.x : minCorners.x;
+					py[j] = (signs & 2) ? maxCorners.y : minCorners.y;
+					pz[j] = (signs & 4) ? maxCorners.z : minCorners.z;
+					nx[j] = SimdFloat(planes[j].normal.x);
+					ny[j] = SimdFloat(planes[j].normal.y);
+					nz[j] = SimdFloat(planes[j].normal.z);
+					d[j] = SimdFloat(planes[j].d);
+				}
+				const uint32 lanemask = (1u << SimdFloat::Width) - 1;
+				for (size_t i = 0; i < count; i += SimdFloat::Width)
+				{
+					SimdFloat outside = SimdFloat::zero();
+					for (unsigned int j = 0; j < 6; j++)
+					{
+						SimdFloat distance = nx[j] * SimdFloat::load(px[j] + i);
+						distance = madd(ny[j], SimdFloat::load(py[j] + i), distance);
+						distance = madd(nz[j], SimdFloat::load(pz[j] + i), distance);
+						outside = outside | (distance - d[j] < SimdFloat::zero());
+					}
+					uint32 visible = ~(uint32)outside.mask() & lanemask;
+					// Clear the bits of the padding elements
+					if (count - i < SimdFloat::Width)
+						visible &= (1u << (count - i)) - 1;
+					visibleMask[i / 32] |= visible << (i % 32);
+				}
+			}
+			/**
+			 * Converts a visibility mask as returned by cullBoxes() into a
+			 * list of the indices of all visible boxes.
+			 * @param visibleMask Visibility mask.
+			 * @param count Number of boxes.
+			 * @param indices Array with room for count indices.
+			 * @return Number of visible boxes.
+			 */
+			static size_t getVisibleIndices(const uint32 *visibleMask,
+			                                size_t count,
+			                                uint32 *indices)
+			{
+				size_t visible = 0;
+				for (size_t i = 0; i < (count + 31) / 32; i++)
+				{
+					uint32 bits = visibleMask[i];
+					while (bits != 0)
+					{
+						uint32 lowest = bits & (~bits + 1);
+						indices[visible++] = (uint32)(i * 32)
+						                   + Math::log2FromPowerOfTwo(lowest);
+						bits &= bits - 1;
+					}
+				}
+				return visible;
+			}
+
+			/**
+			 * Clips a convex polygon against all six planes of the frustum,
+			 * see Plane::clipPolygon().
+			 * @param vertices Vertices of the polygon.
+			 * @param count Number of vertices.
+			 * @param result Receives the vertices of the clipped polygon.
+			 * @param scratch Temporary buffer of the same size as result.
+			 * Neither buffer may overlap with vertices.
+			 * @param maxCount Number of vertices each of the buffers has room
+			 * for. If an intermediate polygon does not fit, 0 is returned.
+			 * count + 6 vertices are sufficient for convex polygons, rounding
+			 * can add a few more for polygons touching several planes.
+			 * @return Number of vertices of the clipped polygon, 0 if the
+			 * polygon is outside of the frustum or does not fit.
+			 */
+			unsigned int clipPolygon(const Vec3f *vertices,
+			                         unsigned int count,
+			                         Vec3f *result,
+			                         Vec3f *scratch,
+			                         unsigned int maxCount) const
+			{
+				// Alternate between the buffers so that the last plane writes
+				// into result
+				Vec3f *buffers[2] = {scratch, result};
+				const Vec3f *input = vertices;
+				for (unsigned int i = 0; i < 6; i++)
+				{
+					Vec3f *output = buffers[i & 1];
+					count = planes[i].clipPolygon(input, count, output, maxCount);
+					if (count == 0)
+						return 0;
+					input = output;
+				}
+				return count;
+			}
+			/**
+			 * Clips an array of triangles against the frustum and appends
+			 * the triangles of the clipped polygons to result, see
+			 * Plane::clipTriangles(). Every input triangle produces up to
+			 * seven output triangles.
+			 *
+			 * Triangles are only clipped against the planes they intersect,
+			 * triangles which are completely inside are copied unchanged.
+			 * Degenerate triangles which rounding turns into polygons with
+			 * more than MaxClipVertices vertices are dropped.
+			 *
+			 * @param vertices Vertices of the triangles, three per triangle.
+			 * @param triangleCount Number of triangles.
+			 * @param result Receives the vertices of the output triangles.
+			 * @param sourceTriangles If not 0, receives the index of the input
+			 * triangle for every output triangle.
+			 * @return Number of triangles appended to result.
+			 */
+			unsigned int clipTriangles(const Vec3f *vertices,
+			                           unsigned int triangleCount,
+			                           std::vector<Vec3f> &result,
+			                           std::vector<uint32> *sourceTriangles = 0) const
+			{
+				unsigned int outputCount = 0;
+				Vec3f buffers[2][MaxClipVertices];
+				for (unsigned int i = 0; i < triangleCount; i++)
+				{
+					const Vec3f *triangle = &vertices[3 * i];
+					unsigned int clipMask = 0;
+					bool outside = false;
+					for (unsigned int j = 0; j < 6; j++)
+					{
+						float distance0 = planes[j].getDistance(triangle[0]);
+						float distance1 = planes[j].getDistance(triangle[1]);
+						float distance2 = planes[j].getDistance(triangle[2]);
+						if (distance0 < 0.0f && distance1 < 0.0f && distance2 < 0.0f)
+						{
+							outside = true;
+							break;
+						}
+						if (distance0 < 0.0f || distance1 < 0.0f || distance2 < 0.0f)
+							clipMask |= 1 << j;
+					}
+					if (outside)
+						continue;
+					const Vec3f *polygon = triangle;
+					unsigned int count = 3;
+					unsigned int current = 0;
+					for (unsigned int j = 0; j < 6 && count != 0; j++)
+					{
+						if ((clipMask & (1 << j)) == 0)
+							continue;
+						count = planes[j].clipPolygon(polygon, count,
+						                              buffers[current],
+						                              MaxClipVertices);
+						polygon = buffers[current];
+						current ^= 1;
+					}
+					outputCount += Plane::appendTriangleFan(polygon, count, i,
+					                                        result,
+					                                        sourceTriangles);
+				}
+				return outputCount;
+			}
+
+			/**
+			 * Updates the cached normal vector signs which are used by
+			 * classify(). This has to be called if the planes are modified
+			 * directly.
+			 */
+			void updatePlaneSigns()
+			{
+				for (unsigned int i = 0; i < 6; i++)
+				{
+					const Vec3f &normal = planes[i].normal;
+					planeSigns[i] = (normal.x >= 0 ? 1 : 0)
+					              | (normal.y >= 0 ? 2 : 0)
+					              | (normal.z >= 0 ? 4 : 0);
+				}
 			}
 
 			Mat4f projmat;
+			/**
+			 * Planes of the frustum. The normal vectors point inside.
+			 */
 			Plane planes[6];
-			Vec3f corners[6];
+		private:
+			/**
+			 * For each plane, bit i is set if component i of the normal
+			 * vector is not negative.
+			 */
+			unsigned int planeSigns[6];
 	};
 }
 
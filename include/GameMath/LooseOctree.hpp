@@ -0,0 +1,532 @@
+/*
+Copyright (C) 2011, Mathias Gottschlag
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef GAMEMATH_LOOSEOCTREE_HPP_INCLUDED
+#define GAMEMATH_LOOSEOCTREE_HPP_INCLUDED
+
+#include "BoundingBox.hpp"
+#include "Frustum.hpp"
+#include "Types.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+namespace math
+{
+	/**
+	 * Loose octree for objects which are inserted, removed and moved
+	 * frequently.
+	 *
+	 * The bounds of every node are twice as large as its cell, so an object
+	 * can be stored in the cell which contains its center if the object is
+	 * not larger than the cell. The depth of the object only depends on its
+	 * size, which allows finding the node of an object in constant time.
+	 * Objects which move without leaving their cell are updated in O(1).
+	 *
+	 * Nodes and objects are stored in pools and are reused after they have
+	 * been freed, the octree only allocates memory when it grows. Objects
+	 * are referenced by handles which are returned by insert() and stay
+	 * valid until the object is removed.
+	 */
+	class LooseOctree
+	{
+		public:
+			/**
+			 * Invalid object or node handle.
+			 */
+			static const uint32 Invalid = 0xffffffff;
+			/**
+			 * Maximum depth of the tree.
+			 */
+			static const unsigned int MaxDepth = 16;
+
+			/**
+			 * Constructor.
+			 * @param worldBounds Area covered by the octree. The root cell is
+			 * the smallest cube which contains the area. Objects with their
+			 * center outside of the area are stored in the root node and are
+			 * tested by every query.
+			 * @param maxDepth Depth of the smallest cells, at most MaxDepth.
+			 */
+			LooseOctree(const BoundingBox &worldBounds, unsigned int maxDepth = 8)
+				: origin(worldBounds.minCorner),
+				  maxDepth(maxDepth < MaxDepth ? maxDepth : MaxDepth), objectCount(0)
+			{
+				Vec3f size = worldBounds.getSize();
+				rootSize = std::max(size.x, std::max(size.y, size.z));
+				clear();
+			}
+
+			/**
+			 * Removes all objects and frees all nodes. Object handles are
+			 * invalidated.
+			 */
+			void clear()
+			{
+				nodes.clear();
+				objects.clear();
+				freeNodes.clear();
+				freeObjects.clear();
+				objectCount = 0;
+				Cell root = {0, 0, 0, 0};
+				allocateNode(Invalid, root);
+			}
+
+			/**
+			 * Inserts an object into the tree.
+			 * @param box Bounding box of the object.
+			 * @return Handle of the object.
+			 */
+			uint32 insert(const BoundingBox &box)
+			{
+				uint32 object;
+				if (!freeObjects.empty())
+				{
+					object = freeObjects.back();
+					freeObjects.pop_back();
+				}
+				else
+				{
+					object = (uint32)objects.size();
+					objects.push_back(Object());
+				}
+				objects[object].bounds = box;
+				link(object, getNode(findCell(box)));
+				objectCount++;
+				return object;
+			}
+			/**
+			 * Removes an object from the tree. Nodes which become empty are
+			 * freed.
+			 * @param object Handle of the object.
+			 */
+			void remove(uint32 object)
+			{
+				uint32 node = objects[object].node;
+				unlink(object);
+				objects[object].node = Invalid;
+				freeObjects.push_back(object);
+				objectCount--;
+				pruneNode(node);
+			}
+			/**
+			 * Changes the bounding box of an object. If the object stays in
+			 * the same cell, only the stored box is updated.
+			 * @param object Handle of the object.
+			 * @param box New bounding box of the object.
+			 * @return True if the object was moved to a different node.
+			 */
+			bool move(uint32 object, const BoundingBox &box)
+			{
+				objects[object].bounds = box;
+				Cell cell = findCell(box);
+				uint32 node = objects[object].node;
+				const Node &current = nodes[node];
+				if (current.cell.depth == cell.depth && current.cell.x == cell.x
+				 && current.cell.y == cell.y && current.cell.z == cell.z)
+					return false;
+				unlink(object);
+				link(object, getNode(cell));
+				pruneNode(node);
+				return true;
+			}
+
+			/**
+			 * Returns the bounding box of an object.
+			 */
+			const BoundingBox &getBounds(uint32 object) const
+			{
+				return objects[object].bounds;
+			}
+			/**
+			 * Returns the number of objects in the tree.
+			 */
+			size_t getObjectCount() const
+			{
+				return objectCount;
+			}
+			/**
+			 * Returns the number of allocated nodes, including the root node.
+			 */
+			size_t getNodeCount() const
+			{
+				return nodes.size() - freeNodes.size();
+			}
+
+			/**
+			 * Appends the handles of all objects whose boxes overlap the
+			 * given box to result.
+			 * @return Number of objects found.
+			 */
+			size_t queryBox(const BoundingBox &box,
+			                std::vector<uint32> &result) const
+			{
+				size_t oldSize = result.size();
+				uint32 stack[StackSize];
+				unsigned int stackSize = 0;
+				stack[stackSize++] = Root;
+				while (stackSize != 0)
+				{
+					uint32 index = stack[--stackSize];
+					const Node &node = nodes[index];
+					// The root node also contains objects outside of its bounds
+					if (index != Root && !node.looseBounds.overlap(box))
+						continue;
+					for (uint32 i = node.firstObject; i != Invalid; i = objects[i].next)
+					{
+						if (objects[i].bounds.overlap(box))
+							result.push_back(i);
+					}
+					pushChildren(node, stack, stackSize);
+				}
+				return result.size() - oldSize;
+			}
+			/**
+			 * Appends the handles of all objects whose boxes overlap the
+			 * given sphere to result.
+			 * @return Number of objects found.
+			 */
+			size_t querySphere(const Vec3f &center,
+			                   float radius,
+			                   std::vector<uint32> &result) const
+			{
+				size_t oldSize = result.size();
+				float radiusSq = radius * radius;
+				uint32 stack[StackSize];
+				unsigned int stackSize = 0;
+				stack[stackSize++] = Root;
+				while (stackSize != 0)
+				{
+					uint32 index = stack[--stackSize];
+					const Node &node = nodes[index];
+					if (index != Root && !overlapSphere(node.looseBounds, center, radiusSq))
+						continue;
+					for (uint32 i = node.firstObject; i != Invalid; i = objects[i].next)
+					{
+						if (overlapSphere(objects[i].bounds, center, radiusSq))
+							result.push_back(i);
+					}
+					pushChildren(node, stack, stackSize);
+				}
+				return result.size() - oldSize;
+			}
+			/**
+			 * Appends the handles of all objects whose boxes are at least
+			 * partially inside the frustum to result (see
+			 * Frustum::isInside(const BoundingBox&)).
+			 *
+			 * Subtrees are rejected as a whole if their bounds are outside of
+			 * the frustum, planes which completely contain a node are not
+			 * tested for its children and objects, and subtrees which are
+			 * completely inside the frustum are added without further tests.
+			 * @return Number of objects found.
+			 */
+			size_t queryFrustum(const Frustum &frustum,
+			                    std::vector<uint32> &result) const
+			{
+				size_t oldSize = result.size();
+				uint32 stack[StackSize];
+				unsigned int planeMasks[StackSize];
+				unsigned int stackSize = 0;
+				stack[stackSize] = Root;
+				planeMasks[stackSize++] = Frustum::AllPlanes;
+				uint8 cachedPlane = 0;
+				while (stackSize != 0)
+				{
+					stackSize--;
+					uint32 index = stack[stackSize];
+					const Node &node = nodes[index];
+					unsigned int childMask = planeMasks[stackSize];
+					if (index != Root && frustum.classify(node.looseBounds, cachedPlane,
+					                                      childMask, &childMask) == Frustum::Outside)
+						continue;
+					if (childMask == 0)
+					{
+						addSubtree(index, result);
+						continue;
+					}
+					for (uint32 i = node.firstObject; i != Invalid; i = objects[i].next)
+					{
+						if (frustum.classify(objects[i].bounds, cachedPlane, childMask) != Frustum::Outside)
+							result.push_back(i);
+					}
+					for (unsigned int i = 0; i < 8; i++)
+					{
+						if (node.children[i] != Invalid)
+						{
+							stack[stackSize] = node.children[i];
+							planeMasks[stackSize++] = childMask;
+						}
+					}
+				}
+				return result.size() - oldSize;
+			}
+		private:
+			static const uint32 Root = 0;
+			/**
+			 * Every node pushes at most 8 children after popping itself.
+			 */
+			static const unsigned int StackSize = 7 * MaxDepth + 1;
+
+			/**
+			 * Integer coordinates of a cell within the grid of its depth.
+			 */
+			struct Cell
+			{
+				uint32 x;
+				uint32 y;
+				uint32 z;
+				uint32 depth;
+			};
+			struct Node
+			{
+				/**
+				 * Bounds of the cell enlarged by half of the cell size on
+				 * every side.
+				 */
+				BoundingBox looseBounds;
+				Cell cell;
+				uint32 parent;
+				uint32 children[8];
+				uint32 childCount;
+				/**
+				 * First object of the doubly linked list of the objects in
+				 * this node.
+				 */
+				uint32 firstObject;
+			};
+			struct Object
+			{
+				BoundingBox bounds;
+				uint32 node;
+				uint32 previous;
+				uint32 next;
+			};
+
+			/**
+			 * Computes the deepest depth at which the cells are at least as
+			 * large as the box.
+			 */
+			uint32 getDepth(const BoundingBox &box) const
+			{
+				Vec3f size = box.getSize();
+				float maxSize = std::max(size.x, std::max(size.y, size.z));
+				if (!(maxSize > 0.0f))
+					return maxDepth;
+				// rootSize / maxSize is in [2^(exponent - 1), 2^exponent)
+				int exponent;
+				std::frexp(rootSize / maxSize, &exponent);
+				if (exponent < 1)
+					return 0;
+				return std::min((uint32)exponent - 1, (uint32)maxDepth);
+			}
+			BoundingBox getLooseBounds(const Cell &cell) const
+			{
+				float cellSize = rootSize / (float)(1u << cell.depth);
+				Vec3f position((float)cell.x, (float)cell.y, (float)cell.z);
+				return BoundingBox(origin + (position - Vec3f(0.5f, 0.5f, 0.5f)) * cellSize,
+				                   origin + (position + Vec3f(1.5f, 1.5f, 1.5f)) * cellSize);
+			}
+			/**
+			 * Computes the cell in which a box is stored.
+			 */
+			Cell findCell(const BoundingBox &box) const
+			{
+				Vec3f center = box.getCenter();
+				Cell cell;
+				for (cell.depth = getDepth(box); cell.depth > 0; cell.depth--)
+				{
+					float cells = (float)(1u << cell.depth);
+					Vec3f position = (center - origin) * (cells / rootSize);
+					if (!(position.x >= 0.0f && position.x < cells
+					   && position.y >= 0.0f && position.y < cells
+					   && position.z >= 0.0f && position.z < cells))
+						break;
+					cell.x = (uint32)position.x;
+					cell.y = (uint32)position.y;
+					cell.z = (uint32)position.z;
+					// Rounding errors can place boxes which are exactly as
+					// large as the cell slightly outside of the loose bounds,
+					// these boxes are stored one level higher
+					BoundingBox looseBounds = getLooseBounds(cell);
+					if (looseBounds.minCorner.x <= box.minCorner.x
+					 && looseBounds.minCorner.y <= box.minCorner.y
+					 && looseBounds.minCorner.z <= box.minCorner.z
+					 && looseBounds.maxCorner.x >= box.maxCorner.x
+					 && looseBounds.maxCorner.y >= box.maxCorner.y
+					 && looseBounds.maxCorner.z >= box.maxCorner.z)
+						return cell;
+				}
+				cell.x = 0;
+				cell.y = 0;
+				cell.z = 0;
+				cell.depth = 0;
+				return cell;
+			}
+			/**
+			 * Returns the node for a cell, missing nodes on the path from the
+			 * root to the cell are created.
+			 */
+			uint32 getNode(const Cell &cell)
+			{
+				uint32 index = Root;
+				for (uint32 depth = 1; depth <= cell.depth; depth++)
+				{
+					uint32 shift = cell.depth - depth;
+					Cell childCell = {cell.x >> shift, cell.y >> shift,
+					                  cell.z >> shift, depth};
+					unsigned int child = (childCell.x & 1) | ((childCell.y & 1) << 1)
+					                   | ((childCell.z & 1) << 2);
+					uint32 childIndex = nodes[index].children[child];
+					if (childIndex == Invalid)
+					{
+						childIndex = allocateNode(index, childCell);
+						nodes[index].children[child] = childIndex;
+						nodes[index].childCount++;
+					}
+					index = childIndex;
+				}
+				return index;
+			}
+			uint32 allocateNode(uint32 parent, const Cell &cell)
+			{
+				uint32 index;
+				if (!freeNodes.empty())
+				{
+					index = freeNodes.back();
+					freeNodes.pop_back();
+				}
+				else
+				{
+					index = (uint32)nodes.size();
+					nodes.push_back(Node());
+				}
+				Node &node = nodes[index];
+				node.looseBounds = getLooseBounds(cell);
+				node.cell = cell;
+				node.parent = parent;
+				for (unsigned int i = 0; i < 8; i++)
+					node.children[i] = Invalid;
+				node.childCount = 0;
+				node.firstObject = Invalid;
+				return index;
+			}
+			/**
+			 * Frees the node and its parents as long as they neither contain
+			 * objects nor children.
+			 */
+			void pruneNode(uint32 index)
+			{
+				while (index != Root)
+				{
+					const Node &node = nodes[index];
+					if (node.firstObject != Invalid || node.childCount != 0)
+						return;
+					Node &parent = nodes[node.parent];
+					for (unsigned int i = 0; i < 8; i++)
+					{
+						if (parent.children[i] == index)
+							parent.children[i] = Invalid;
+					}
+					parent.childCount--;
+					freeNodes.push_back(index);
+					index = node.parent;
+				}
+			}
+			void link(uint32 object, uint32 node)
+			{
+				Object &o = objects[object];
+				o.node = node;
+				o.previous = Invalid;
+				o.next = nodes[node].firstObject;
+				if (o.next != Invalid)
+					objects[o.next].previous = object;
+				nodes[node].firstObject = object;
+			}
+			void unlink(uint32 object)
+			{
+				const Object &o = objects[object];
+				if (o.previous != Invalid)
+					objects[o.previous].next = o.next;
+				else
+					nodes[o.node].firstObject = o.next;
+				if (o.next != Invalid)
+					objects[o.next].previous = o.previous;
+			}
+
+			static void pushChildren(const Node &node,
+			                         uint32 *stack,
+			                         unsigned int &stackSize)
+			{
+				for (unsigned int i = 0; i < 8; i++)
+				{
+					if (node.children[i] != Invalid)
+						stack[stackSize++] = node.children[i];
+				}
+			}
+			static bool overlapSphere(const BoundingBox &box,
+			                          const Vec3f &center,
+			                          float radiusSq)
+			{
+				float distanceSq = 0.0f;
+				for (unsigned int i = 0; i < 3; i++)
+				{
+					float c = (&center.x)[i];
+					float min = (&box.minCorner.x)[i];
+					float max = (&box.maxCorner.x)[i];
+					if (c < min)
+						distanceSq += (min - c) * (min - c);
+					else if (c > max)
+						distanceSq += (c - max) * (c - max);
+				}
+				return distanceSq <= radiusSq;
+			}
+			/**
+			 * Appends all objects in the subtree to result.
+			 */
+			void addSubtree(uint32 root, std::vector<uint32> &result) const
+			{
+				uint32 stack[StackSize];
+				unsigned int stackSize = 0;
+				stack[stackSize++] = root;
+				while (stackSize != 0)
+				{
+					const Node &node = nodes[stack[--stackSize]];
+					for (uint32 i = node.firstObject; i != Invalid; i = objects[i].next)
+						result.push_back(i);
+					pushChildren(node, stack, stackSize);
+				}
+			}
+
+			Vec3f origin;
+			float rootSize;
+			unsigned int maxDepth;
+			size_t objectCount;
+			std::vector<Node> nodes;
+			std::vector<Object> objects;
+			std::vector<uint32> freeNodes;
+			std::vector<uint32> freeObjects;
+	};
+}
+
+#endif
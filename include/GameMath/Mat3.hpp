@@ -39,9 +39,9 @@ namespace math
 				m[i] = other.m[i];
 			}
 		}
-		Mat3<T>(float m00, float m01, float m02,
-		        float m10, float m11, float m12,
-		        float m20, float m21, float m22)
+		Mat3<T>(T m00, T m01, T m02,
+		        T m10, T m11, T m12,
+		        T m20, T m21, T m22)
 		{
 			Mat3<T> &m = *this;
 			m(0, 0) = m00;
@@ -63,20 +63,67 @@ namespace math
 			               0, 0, 1);
 		}
 
+		T determinant() const
+		{
+			const Mat3<T> &m = *this;
+			return m(0, 0) * (m(1, 1) * m(2, 2) - m(1, 2) * m(2, 1))
+			     + m(0, 1) * (m(1, 2) * m(2, 0) - m(1, 0) * m(2, 2))
+			     + m(0, 2) * (m(1, 0) * m(2, 1) - m(1, 1) * m(2, 0));
+		}
+		/**
+		 * Returns the inverse of the matrix. If the matrix is not
+		 * invertible, the result is undefined.
+		 */
+		Mat3<T> inverse() const
+		{
+			const Mat3<T> &m = *this;
+			Mat3<T> out;
+			// Cofactors, the first column of the adjugate matrix is reused
+			// for the determinant
+			out(0, 0) = m(1, 1) * m(2, 2) - m(1, 2) * m(2, 1);
+			out(1, 0) = m(1, 2) * m(2, 0) - m(1, 0) * m(2, 2);
+			out(2, 0) = m(1, 0) * m(2, 1) - m(1, 1) * m(2, 0);
+			T d = 1 / (m(0, 0) * out(0, 0) + m(0, 1) * out(1, 0) + m(0, 2) * out(2, 0));
+			out(0, 0) *= d;
+			out(1, 0) *= d;
+			out(2, 0) *= d;
+			out(0, 1) = (m(0, 2) * m(2, 1) - m(0, 1) * m(2, 2)) * d;
+			out(1, 1) = (m(0, 0) * m(2, 2) - m(0, 2) * m(2, 0)) * d;
+			out(2, 1) = (m(0, 1) * m(2, 0) - m(0, 0) * m(2, 1)) * d;
+			out(0, 2) = (m(0, 1) * m(1, 2) - m(0, 2) * m(1, 1)) * d;
+			out(1, 2) = (m(0, 2) * m(1, 0) - m(0, 0) * m(1, 2)) * d;
+			out(2, 2) = (m(0, 0) * m(1, 1) - m(0, 1) * m(1, 0)) * d;
+			return out;
+		}
+		Mat3<T> transposed() const
+		{
+			const Mat3<T> &m = *this;
+			return Mat3<T>(m(0, 0), m(1, 0), m(2, 0),
+			               m(0, 1), m(1, 1), m(2, 1),
+			               m(0, 2), m(1, 2), m(2, 2));
+		}
+
 		Mat3 operator*(const Mat3 &o) const
 		{
 			const Mat3<T> &m = *this;
-			return Mat3<T>(m(0, 0) * o(0, 0) + m(1, 0) * o(0, 1) + m(2, 0) * o(0, 2),
-			               m(0, 1) * o(0, 0) + m(1, 1) * o(0, 1) + m(2, 1) * o(0, 2),
-			               m(0, 2) * o(0, 0) + m(1, 2) * o(0, 1) + m(2, 2) * o(0, 2),
+			return Mat3<T>(m(0, 0) * o(0, 0) + m(0, 1) * o(1, 0) + m(0, 2) * o(2, 0),
+			               m(0, 0) * o(0, 1) + m(0, 1) * o(1, 1) + m(0, 2) * o(2, 1),
+			               m(0, 0) * o(0, 2) + m(0, 1) * o(1, 2) + m(0, 2) * o(2, 2),
 
-			               m(0, 0) * o(1, 0) + m(1, 0) * o(1, 1) + m(2, 0) * o(1, 2),
-			               m(0, 1) * o(1, 0) + m(1, 1) * o(1, 1) + m(2, 1) * o(1, 2),
-			               m(0, 2) * o(1, 0) + m(1, 2) * o(1, 1) + m(2, 2) * o(1, 2),
+			               m(1, 0) * o(0, 0) + m(1, 1) * o(1, 0) + m(1, 2) * o(2, 0),
+			               m(1, 0) * o(0, 1) + m(1, 1) * o(1, 1) + m(1, 2) * o(2, 1),
+			               m(1, 0) * o(0, 2) + m(1, 1) * o(1, 2) + m(1, 2) * o(2, 2),
 
-			               m(0, 0) * o(2, 0) + m(1, 0) * o(2, 1) + m(2, 0) * o(2, 2),
-			               m(0, 1) * o(2, 0) + m(1, 1) * o(2, 1) + m(2, 1) * o(2, 2),
-			               m(0, 2) * o(2, 0) + m(1, 2) * o(2, 1) + m(2, 2) * o(2, 2));
+			               m(2, 0) * o(0, 0) + m(2, 1) * o(1, 0) + m(2, 2) * o(2, 0),
+			               m(2, 0) * o(0, 1) + m(2, 1) * o(1, 1) + m(2, 2) * o(2, 1),
+			               m(2, 0) * o(0, 2) + m(2, 1) * o(1, 2) + m(2, 2) * o(2, 2));
+		}
+		Vec3<T> operator*(const Vec3<T> &v) const
+		{
+			const Mat3<T> &m = *this;
+			return Vec3<T>(v.x * m(0, 0) + v.y * m(0, 1) + v.z * m(0, 2),
+			               v.x * m(1, 0) + v.y * m(1, 1) + v.z * m(1, 2),
+			               v.x * m(2, 0) + v.y * m(2, 1) + v.z * m(2, 2));
 		}
 
 		T &operator()(int row, int column)
@@ -90,7 +137,7 @@ namespace math
 
 		/**
 		 * Matrix data for linear access. The values are stored in a
-		 * row-major format, so the first row is at indices 0-2.
+		 * column-major format, so the first column is at indices 0-2.
 		 */
 		T m[9];
 	};
@@ -24,6 +24,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #include "Vec4.hpp"
 #include "Mat3.hpp"
+#include "Simd.hpp"
 
 namespace math
 {
@@ -254,63 +255,112 @@ namespace math
 			       (m(0, 2) * m(1, 3) - m(0, 3) * m(1, 2)) * (m(2, 0) * m(3, 1) - m(2, 1) * m(3, 0));
 		}
 
+		/**
+		 * Returns the inverse of the matrix. If the matrix is not
+		 * invertible, the result is undefined.
+		 *
+		 * The 2x2 minors of the last two columns are computed once and are
+		 * shared by all cofactors and by the determinant.
+		 */
 		Mat4<T> inverse() const
 		{
 			Mat4<T> out;
-			T d = determinant();
+			const Mat4<T> &m = *this;
+			// 2x2 minors, in groups of four as they are used below. The
+			// first two entries of every group are the same
+			T fac[6][4];
+			static const int rows[6][2] = {
+				{2, 3}, {1, 3}, {1, 2}, {0, 3}, {0, 2}, {0, 1}
+			};
+			for (unsigned int i = 0; i < 6; i++)
+			{
+				int a = rows[i][0];
+				int b = rows[i][1];
+				fac[i][0] = m(a, 2) * m(b, 3) - m(a, 3) * m(b, 2);
+				fac[i][1] = fac[i][0];
+				fac[i][2] = m(a, 1) * m(b, 3) - m(a, 3) * m(b, 1);
+				fac[i][3] = m(a, 1) * m(b, 2) - m(a, 2) * m(b, 1);
+			}
+			// Row i of the matrix, with the first lane taken from the second
+			// column and all other lanes from the first column
+			T vec[4][4];
+			for (unsigned int i = 0; i < 4; i++)
+			{
+				vec[i][0] = m(i, 1);
+				vec[i][1] = m(i, 0);
+				vec[i][2] = m(i, 0);
+				vec[i][3] = m(i, 0);
+			}
+			// Cofactors, the columns of the adjugate matrix
+			for (unsigned int j = 0; j < 4; j++)
+			{
+				T sign = j % 2 == 0 ? 1 : -1;
+				out.m[j] = sign * (vec[1][j] * fac[0][j] - vec[2][j] * fac[1][j] + vec[3][j] * fac[2][j]);
+				out.m[4 + j] = -sign * (vec[0][j] * fac[0][j] - vec[2][j] * fac[3][j] + vec[3][j] * fac[4][j]);
+				out.m[8 + j] = sign * (vec[0][j] * fac[1][j] - vec[1][j] * fac[3][j] + vec[3][j] * fac[5][j]);
+				out.m[12 + j] = -sign * (vec[0][j] * fac[2][j] - vec[1][j] * fac[4][j] + vec[2][j] * fac[5][j]);
+			}
+			T d = (m.m[0] * out.m[0] + m.m[1] * out.m[4])
+			    + (m.m[2] * out.m[8] + m.m[3] * out.m[12]);
 			if (d == 0)
 				return out;
 			d = 1 / d;
-
+			for (unsigned int i = 0; i < 16; i++)
+				out.m[i] *= d;
+			return out;
+		}
+		/**
+		 * Returns the inverse of an affine transformation matrix, that is a
+		 * matrix with the last row (0, 0, 0, 1). This only has to invert the
+		 * upper 3x3 part and is a lot faster than inverse().
+		 */
+		Mat4<T> inverseAffine() const
+		{
 			const Mat4<T> &m = *this;
-			out(0, 0) = d * (m(1, 1) * (m(2, 2) * m(3, 3) - m(2, 3) * m(3, 2)) +
-			                 m(1, 2) * (m(2, 3) * m(3, 1) - m(2, 1) * m(3, 3)) +
-			                 m(1, 3) * (m(2, 1) * m(3, 2) - m(2, 2) * m(3, 1)));
-			out(0, 1) = d * (m(2, 1) * (m(0, 2) * m(3, 3) - m(0, 3) * m(3, 2)) +
-			                 m(2, 2) * (m(0, 3) * m(3, 1) - m(0, 1) * m(3, 3)) +
-			                 m(2, 3) * (m(0, 1) * m(3, 2) - m(0, 2) * m(3, 1)));
-			out(0, 2) = d * (m(3, 1) * (m(0, 2) * m(1, 3) - m(0, 3) * m(1, 2)) +
-			                 m(3, 2) * (m(0, 3) * m(1, 1) - m(0, 1) * m(1, 3)) +
-			                 m(3, 3) * (m(0, 1) * m(1, 2) - m(0, 2) * m(1, 1)));
-			out(0, 3) = d * (m(0, 1) * (m(1, 3) * m(2, 2) - m(1, 2) * m(2, 3)) +
-			                 m(0, 2) * (m(1, 1) * m(2, 3) - m(1, 3) * m(2, 1)) +
-			                 m(0, 3) * (m(1, 2) * m(2, 1) - m(1, 1) * m(2, 2)));
-			out(1, 0) = d * (m(1, 2) * (m(2, 0) * m(3, 3) - m(2, 3) * m(3, 0)) +
-			                 m(1, 3) * (m(2, 2) * m(3, 0) - m(2, 0) * m(3, 2)) +
-			                 m(1, 0) * (m(2, 3) * m(3, 2) - m(2, 2) * m(3, 3)));
-			out(1, 1) = d * (m(2, 2) * (m(0, 0) * m(3, 3) - m(0, 3) * m(3, 0)) +
-			                 m(2, 3) * (m(0, 2) * m(3, 0) - m(0, 0) * m(3, 2)) +
-			                 m(2, 0) * (m(0, 3) * m(3, 2) - m(0, 2) * m(3, 3)));
-			out(1, 2) = d * (m(3, 2) * (m(0, 0) * m(1, 3) - m(0, 3) * m(1, 0)) +
-			                 m(3, 3) * (m(0, 2) * m(1, 0) - m(0, 0) * m(1, 2)) +
-			                 m(3, 0) * (m(0, 3) * m(1, 2) - m(0, 2) * m(1, 3)));
-			out(1, 3) = d * (m(0, 2) * (m(1, 3) * m(2, 0) - m(1, 0) * m(2, 3)) +
-			                 m(0, 3) * (m(1, 0) * m(2, 2) - m(1, 2) * m(2, 0)) +
-			                 m(0, 0) * (m(1, 2) * m(2, 3) - m(1, 3) * m(2, 2)));
-			out(2, 0) = d * (m(1, 3) * (m(2, 0) * m(3, 1) - m(2, 1) * m(3, 0)) +
-			                 m(1, 0) * (m(2, 1) * m(3, 3) - m(2, 3) * m(3, 1)) +
-			                 m(1, 1) * (m(2, 3) * m(3, 0) - m(2, 0) * m(3, 3)));
-			out(2, 1) = d * (m(2, 3) * (m(0, 0) * m(3, 1) - m(0, 1) * m(3, 0)) +
-			                 m(2, 0) * (m(0, 1) * m(3, 3) - m(0, 3) * m(3, 1)) +
-			                 m(2, 1) * (m(0, 3) * m(3, 0) - m(0, 0) * m(3, 3)));
-			out(2, 2) = d * (m(3, 3) * (m(0, 0) * m(1, 1) - m(0, 1) * m(1, 0)) +
-			                 m(3, 0) * (m(0, 1) * m(1, 3) - m(0, 3) * m(1, 1)) +
-			                 m(3, 1) * (m(0, 3) * m(1, 0) - m(0, 0) * m(1, 3)));
-			out(2, 3) = d * (m(0, 3) * (m(1, 1) * m(2, 0) - m(1, 0) * m(2, 1)) +
-			                 m(0, 0) * (m(1, 3) * m(2, 1) - m(1, 1) * m(2, 3)) +
-			                 m(0, 1) * (m(1, 0) * m(2, 3) - m(1, 3) * m(2, 0)));
-			out(3, 0) = d * (m(1, 0) * (m(2, 2) * m(3, 1) - m(2, 1) * m(3, 2)) +
-			                 m(1, 1) * (m(2, 0) * m(3, 2) - m(2, 2) * m(3, 0)) +
-			                 m(1, 2) * (m(2, 1) * m(3, 0) - m(2, 0) * m(3, 1)));
-			out(3, 1) = d * (m(2, 0) * (m(0, 2) * m(3, 1) - m(0, 1) * m(3, 2)) +
-			                 m(2, 1) * (m(0, 0) * m(3, 2) - m(0, 2) * m(3, 0)) +
-			                 m(2, 2) * (m(0, 1) * m(3, 0) - m(0, 0) * m(3, 1)));
-			out(3, 2) = d * (m(3, 0) * (m(0, 2) * m(1, 1) - m(0, 1) * m(1, 2)) +
-			                 m(3, 1) * (m(0, 0) * m(1, 2) - m(0, 2) * m(1, 0)) +
-			                 m(3, 2) * (m(0, 1) * m(1, 0) - m(0, 0) * m(1, 1)));
-			out(3, 3) = d * (m(0, 0) * (m(1, 1) * m(2, 2) - m(1, 2) * m(2, 1)) +
-			                 m(0, 1) * (m(1, 2) * m(2, 0) - m(1, 0) * m(2, 2)) +
-			                 m(0, 2) * (m(1, 0) * m(2, 1) - m(1, 1) * m(2, 0)));
+			// Cofactors of the upper 3x3 part
+			T c00 = m(1, 1) * m(2, 2) - m(1, 2) * m(2, 1);
+			T c01 = m(1, 2) * m(2, 0) - m(1, 0) * m(2, 2);
+			T c02 = m(1, 0) * m(2, 1) - m(1, 1) * m(2, 0);
+			T d = 1 / (m(0, 0) * c00 + m(0, 1) * c01 + m(0, 2) * c02);
+			Mat4<T> out;
+			out(0, 0) = c00 * d;
+			out(1, 0) = c01 * d;
+			out(2, 0) = c02 * d;
+			out(0, 1) = (m(0, 2) * m(2, 1) - m(0, 1) * m(2, 2)) * d;
+			out(1, 1) = (m(0, 0) * m(2, 2) - m(0, 2) * m(2, 0)) * d;
+			out(2, 1) = (m(0, 1) * m(2, 0) - m(0, 0) * m(2, 1)) * d;
+			out(0, 2) = (m(0, 1) * m(1, 2) - m(0, 2) * m(1, 1)) * d;
+			out(1, 2) = (m(0, 2) * m(1, 0) - m(0, 0) * m(1, 2)) * d;
+			out(2, 2) = (m(0, 0) * m(1, 1) - m(0, 1) * m(1, 0)) * d;
+			// The new translation is the old one transformed with the
+			// inverted 3x3 part and negated
+			for (unsigned int i = 0; i < 3; i++)
+			{
+				out(i, 3) = -(out(i, 0) * m(0, 3) + out(i, 1) * m(1, 3) + out(i, 2) * m(2, 3));
+				out(3, i) = 0;
+			}
+			out(3, 3) = 1;
+			return out;
+		}
+		/**
+		 * Returns the inverse of a rigid transformation matrix, that is a
+		 * matrix which only contains a rotation and a translation. The
+		 * inverse then is the transposed rotation and the negated
+		 * translation rotated with it.
+		 */
+		Mat4<T> inverseRigid() const
+		{
+			const Mat4<T> &m = *this;
+			Mat4<T> out;
+			for (unsigned int i = 0; i < 3; i++)
+			{
+				out(i, 0) = m(0, i);
+				out(i, 1) = m(1, i);
+				out(i, 2) = m(2, i);
+				out(i, 3) = -(m(0, i) * m(0, 3) + m(1, i) * m(1, 3) + m(2, i) * m(2, 3));
+				out(3, i) = 0;
+			}
+			out(3, 3) = 1;
 			return out;
 		}
 		Mat4<T> transposed() const
@@ -377,6 +427,54 @@ namespace math
 			               transformed.z / transformed.w);
 		}
 
+		/**
+		 * Transforms an array of points, including the division by the
+		 * resulting w coordinate.
+		 *
+		 * The strides are given in bytes, so that positions can be read from
+		 * and written to interleaved vertex buffers directly. in and out may
+		 * point to the same array as long as the strides are equal.
+		 * @param in Points to transform.
+		 * @param out Array which receives the transformed points.
+		 * @param count Number of points.
+		 * @param inStride Distance between two input points in bytes.
+		 * @param outStride Distance between two output points in bytes.
+		 */
+		void transformPoints(const Vec3<T> *in,
+		                     Vec3<T> *out,
+		                     size_t count,
+		                     size_t inStride = sizeof(Vec3<T>),
+		                     size_t outStride = sizeof(Vec3<T>)) const
+		{
+			transformVectors(in, out, count, inStride, outStride, true, true);
+		}
+		/**
+		 * Transforms an array of points, assuming that the last row of the
+		 * matrix is (0, 0, 0, 1) so that no division is necessary. See
+		 * transformPoints() for the parameters.
+		 */
+		void transformPointsAffine(const Vec3<T> *in,
+		                           Vec3<T> *out,
+		                           size_t count,
+		                           size_t inStride = sizeof(Vec3<T>),
+		                           size_t outStride = sizeof(Vec3<T>)) const
+		{
+			transformVectors(in, out, count, inStride, outStride, true, false);
+		}
+		/**
+		 * Transforms an array of directions, ignoring the translation part
+		 * and the last row of the matrix. See transformPoints() for the
+		 * parameters.
+		 */
+		void transformDirections(const Vec3<T> *in,
+		                         Vec3<T> *out,
+		                         size_t count,
+		                         size_t inStride = sizeof(Vec3<T>),
+		                         size_t outStride = sizeof(Vec3<T>)) const
+		{
+			transformVectors(in, out, count, inStride, outStride, false, false);
+		}
+
 		Vec4<T> operator*(const Vec4<T> &v) const
 		{
 			Vec4<T> out;
@@ -444,10 +542,243 @@ namespace math
 		 * column-major format, so the first column is at indices 0-3.
 		 */
 		T m[16];
+	private:
+		void transformVectors(const Vec3<T> *in,
+		                      Vec3<T> *out,
+		                      size_t count,
+		                      size_t inStride,
+		                      size_t outStride,
+		                      bool translate,
+		                      bool project) const
+		{
+			const Mat4<T> &m = *this;
+			const char *src = (const char*)in;
+			char *dst = (char*)out;
+			T w = translate ? 1 : 0;
+			for (size_t i = 0; i < count; i++)
+			{
+				Vec3<T> v = *(const Vec3<T>*)src;
+				Vec3<T> result(v.x * m(0, 0) + v.y * m(0, 1) + v.z * m(0, 2) + w * m(0, 3),
+				               v.x * m(1, 0) + v.y * m(1, 1) + v.z * m(1, 2) + w * m(1, 3),
+				               v.x * m(2, 0) + v.y * m(2, 1) + v.z * m(2, 2) + w * m(2, 3));
+				if (project)
+				{
+					T rw = v.x * m(3, 0) + v.y * m(3, 1) + v.z * m(3, 2) + w * m(3, 3);
+					result = Vec3<T>(result.x / rw, result.y / rw, result.z / rw);
+				}
+				*(Vec3<T>*)dst = result;
+				src += inStride;
+				dst += outStride;
+			}
+		}
 	};
 
 	typedef Mat4<float> Mat4f;
 	typedef Mat4<double> Mat4d;
+
+#if defined(GAMEMATH_SSE2)
+	// SIMD versions of the Mat4f operations. The columns of the matrix are
+	// loaded directly from the column-major array and are summed up in the
+	// same order as in the generic code above, so unless FMA is enabled the
+	// results are bit-identical to the scalar fallback.
+	template<> inline Vec4<float> Mat4<float>::operator*(const Vec4<float> &v) const
+	{
+		Float4 out = Float4::load(m) * Float4(v.x);
+		out = madd(Float4::load(m + 4), Float4(v.y), out);
+		out = madd(Float4::load(m + 8), Float4(v.z), out);
+		out = madd(Float4::load(m + 12), Float4(v.w), out);
+		float result[4];
+		out.store(result);
+		return Vec4<float>(result[0], result[1], result[2], result[3]);
+	}
+
+	template<> inline Mat4<float> Mat4<float>::operator*(const Mat4<float> &o) const
+	{
+		Mat4<float> out;
+#if defined(GAMEMATH_AVX)
+		// Two result columns are computed at once, the columns of this matrix
+		// are duplicated into both halves of the AVX registers
+		Float8 c0 = Float8::broadcast(Float4::load(m));
+		Float8 c1 = Float8::broadcast(Float4::load(m + 4));
+		Float8 c2 = Float8::broadcast(Float4::load(m + 8));
+		Float8 c3 = Float8::broadcast(Float4::load(m + 12));
+		for (unsigned int i = 0; i < 16; i += 8)
+		{
+			Float8 columns = Float8::load(o.m + i);
+			Float8 result = c0 * columns.splatHalves<0>();
+			result = madd(c1, columns.splatHalves<1>(), result);
+			result = madd(c2, columns.splatHalves<2>(), result);
+			result = madd(c3, columns.splatHalves<3>(), result);
+			result.store(out.m + i);
+		}
+#else
+		Float4 c0 = Float4::load(m);
+		Float4 c1 = Float4::load(m + 4);
+		Float4 c2 = Float4::load(m + 8);
+		Float4 c3 = Float4::load(m + 12);
+		for (unsigned int i = 0; i < 16; i += 4)
+		{
+			Float4 result = c0 * Float4(o.m[i]);
+			result = madd(c1, Float4(o.m[i + 1]), result);
+			result = madd(c2, Float4(o.m[i + 2]), result);
+			result = madd(c3, Float4(o.m[i + 3]), result);
+			result.store(out.m + i);
+		}
+#endif
+		return out;
+	}
+
+	template<> inline Mat4<float> Mat4<float>::inverse() const
+	{
+		// Same algorithm as the generic version, with one lane per entry of
+		// the fac and vec arrays
+		Float4 c0 = Float4::load(m);
+		Float4 c1 = Float4::load(m + 4);
+		Float4 c2 = Float4::load(m + 8);
+		Float4 c3 = Float4::load(m + 12);
+		Float4 fac[6];
+#define GAMEMATH_INVERSE_FAC(i, a, b) \
+		{ \
+			Float4 ra = shuffle<a, a, a, a>(c2, c1); \
+			Float4 rb = shuffle<b, b, b, b>(c3, c2); \
+			Float4 sa = shuffle<a, a, a, a>(c3, c2); \
+			Float4 sb = shuffle<b, b, b, b>(c2, c1); \
+			rb = shuffle<0, 0, 0, 2>(rb, rb); \
+			sa = shuffle<0, 0, 0, 2>(sa, sa); \
+			fac[i] = ra * rb - sa * sb; \
+		}
+		GAMEMATH_INVERSE_FAC(0, 2, 3)
+		GAMEMATH_INVERSE_FAC(1, 1, 3)
+		GAMEMATH_INVERSE_FAC(2, 1, 2)
+		GAMEMATH_INVERSE_FAC(3, 0, 3)
+		GAMEMATH_INVERSE_FAC(4, 0, 2)
+		GAMEMATH_INVERSE_FAC(5, 0, 1)
+#undef GAMEMATH_INVERSE_FAC
+		Float4 vec0 = shuffle<0, 0, 0, 0>(c1, c0);
+		Float4 vec1 = shuffle<1, 1, 1, 1>(c1, c0);
+		Float4 vec2 = shuffle<2, 2, 2, 2>(c1, c0);
+		Float4 vec3 = shuffle<3, 3, 3, 3>(c1, c0);
+		vec0 = shuffle<0, 2, 2, 2>(vec0, vec0);
+		vec1 = shuffle<0, 2, 2, 2>(vec1, vec1);
+		vec2 = shuffle<0, 2, 2, 2>(vec2, vec2);
+		vec3 = shuffle<0, 2, 2, 2>(vec3, vec3);
+		Float4 signa(1, -1, 1, -1);
+		Float4 signb(-1, 1, -1, 1);
+		Float4 inv0 = (vec1 * fac[0] - vec2 * fac[1] + vec3 * fac[2]) * signa;
+		Float4 inv1 = (vec0 * fac[0] - vec2 * fac[3] + vec3 * fac[4]) * signb;
+		Float4 inv2 = (vec0 * fac[1] - vec1 * fac[3] + vec3 * fac[5]) * signa;
+		Float4 inv3 = (vec0 * fac[2] - vec1 * fac[4] + vec2 * fac[5]) * signb;
+		// The determinant is the dot product of the first column and the
+		// first row of the adjugate matrix
+		Float4 row0 = shuffle<0, 2, 0, 2>(shuffle<0, 0, 0, 0>(inv0, inv1),
+		                                  shuffle<0, 0, 0, 0>(inv2, inv3));
+		Float4 d = horizontalAdd(c0 * row0);
+		Mat4<float> out;
+		if (d.get(0) == 0)
+			return out;
+		d = Float4(1.0f) / d;
+		(inv0 * d).store(out.m);
+		(inv1 * d).store(out.m + 4);
+		(inv2 * d).store(out.m + 8);
+		(inv3 * d).store(out.m + 12);
+		return out;
+	}
+
+	template<> inline void Mat4<float>::transformVectors(const Vec3<float> *in,
+	                                                     Vec3<float> *out,
+	                                                     size_t count,
+	                                                     size_t inStride,
+	                                                     size_t outStride,
+	                                                     bool translate,
+	                                                     bool project) const
+	{
+		// Four points are processed at once, they are converted to SoA form
+		// when they are loaded so that every lane holds one point
+		Float4 c0[4];
+		Float4 c1[4];
+		Float4 c2[4];
+		Float4 c3[4];
+		for (unsigned int i = 0; i < 4; i++)
+		{
+			c0[i] = Float4(m[i]);
+			c1[i] = Float4(m[i + 4]);
+			c2[i] = Float4(m[i + 8]);
+			c3[i] = Float4(translate ? m[i + 12] : 0.0f);
+		}
+		const char *src = (const char*)in;
+		char *dst = (char*)out;
+		size_t i = 0;
+		if (inStride == sizeof(Vec3<float>) && outStride == sizeof(Vec3<float>))
+		{
+			// Packed arrays can be converted with a few shuffles
+			size_t simdCount = count & ~(size_t)3;
+			for (; i < simdCount; i += 4)
+			{
+				Float4 vx, vy, vz;
+				loadInterleaved3((const float*)src, vx, vy, vz);
+				Float4 rx = madd(vz, c2[0], madd(vy, c1[0], vx * c0[0])) + c3[0];
+				Float4 ry = madd(vz, c2[1], madd(vy, c1[1], vx * c0[1])) + c3[1];
+				Float4 rz = madd(vz, c2[2], madd(vy, c1[2], vx * c0[2])) + c3[2];
+				if (project)
+				{
+					Float4 rw = madd(vz, c2[3], madd(vy, c1[3], vx * c0[3])) + c3[3];
+					rx /= rw;
+					ry /= rw;
+					rz /= rw;
+				}
+				storeInterleaved3((float*)dst, rx, ry, rz);
+				src += 4 * sizeof(Vec3<float>);
+				dst += 4 * sizeof(Vec3<float>);
+			}
+		}
+		for (; i < count; i += 4)
+		{
+			const Vec3<float> *p[4];
+			if (count - i >= 4)
+			{
+				for (unsigned int j = 0; j < 4; j++)
+					p[j] = (const Vec3<float>*)(src + j * inStride);
+			}
+			else
+			{
+				// Repeat the last point for the remaining lanes
+				for (unsigned int j = 0; j < 4; j++)
+					p[j] = (const Vec3<float>*)(src + (j < count - i ? j : count - i - 1) * inStride);
+			}
+			Float4 vx(p[0]->x, p[1]->x, p[2]->x, p[3]->x);
+			Float4 vy(p[0]->y, p[1]->y, p[2]->y, p[3]->y);
+			Float4 vz(p[0]->z, p[1]->z, p[2]->z, p[3]->z);
+			Float4 rx = madd(vz, c2[0], madd(vy, c1[0], vx * c0[0])) + c3[0];
+			Float4 ry = madd(vz, c2[1], madd(vy, c1[1], vx * c0[1])) + c3[1];
+			Float4 rz = madd(vz, c2[2], madd(vy, c1[2], vx * c0[2])) + c3[2];
+			if (project)
+			{
+				Float4 rw = madd(vz, c2[3], madd(vy, c1[3], vx * c0[3])) + c3[3];
+				rx /= rw;
+				ry /= rw;
+				rz /= rw;
+			}
+			// Convert back to AoS form, every vector then holds one point
+			Float4 rw;
+			transpose(rx, ry, rz, rw);
+			float result[4][4];
+			rx.store(result[0]);
+			ry.store(result[1]);
+			rz.store(result[2]);
+			rw.store(result[3]);
+			size_t blocksize = count - i < 4 ? count - i : 4;
+			for (size_t j = 0; j < blocksize; j++)
+			{
+				Vec3<float> *v = (Vec3<float>*)(dst + j * outStride);
+				v->x = result[j][0];
+				v->y = result[j][1];
+				v->z = result[j][2];
+			}
+			src += 4 * inStride;
+			dst += 4 * outStride;
+		}
+	}
+#endif
 }
 
 #endif
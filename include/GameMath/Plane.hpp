@@ -23,6 +23,13 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #define _CORERENDER_MATH_PLANE_HPP_INCLUDED_
 
 #include <GameMath.hpp>
+#include "Math.hpp"
+#include "Simd.hpp"
+#include "Types.hpp"
+
+#include <cstddef>
+#include <cstring>
+#include <vector>
 
 namespace math
 {
@@ -35,6 +42,25 @@ namespace math
 	class Plane
 	{
 		public:
+			/**
+			 * Side of a point relative to the plane, see classifyPoints().
+			 */
+			enum Side
+			{
+				/**
+				 * The point is on the side the normal points to.
+				 */
+				Front,
+				/**
+				 * The point is behind the plane.
+				 */
+				Back,
+				/**
+				 * The point is within the tolerance of the plane.
+				 */
+				On
+			};
+
 			/**
 			 * Constructor.
 			 */
@@ -102,7 +128,7 @@ namespace math
 			 * @param point Point to compute the distance to.
 			 * @return Distance of the point to the plane.
 			 */
-			float getDistance(const Vec3f &point)
+			float getDistance(const Vec3f &point) const
 			{
 				float d2 = point.dot(normal);
 				return d2 - d;
@@ -123,7 +149,7 @@ namespace math
 			 */
 			bool intersectWithLine(Vec3f lineoffset,
 								Vec3f linedirection,
-								Vec3f *intersection = 0)
+								Vec3f *intersection = 0) const
 			{
 				float ndotd = normal.dot(linedirection);
 				if (ndotd == 0)
@@ -164,7 +190,7 @@ namespace math
 			 */
 			bool intersectWithLineSegment(Vec3f point1,
 										Vec3f point2,
-										Vec3f *intersection = 0)
+										Vec3f *intersection = 0) const
 			{
 				float ndotd = normal.dot(point2 - point1);
 				if (ndotd == 0)
@@ -199,6 +225,303 @@ namespace math
 				}
 			}
 
+			/**
+			 * Computes the distances of an array of points to the plane (see
+			 * getDistance()) and classifies the points. Four points are
+			 * processed at once.
+			 * @param points Points to classify.
+			 * @param count Number of points.
+			 * @param distances If not 0, receives the distance of every point.
+			 * @param sides Receives the Side of every point.
+			 * @param epsilon Points with a distance of at most epsilon are
+			 * classified as On.
+			 */
+			void classifyPoints(const Vec3f *points,
+			                    size_t count,
+			                    float *distances,
+			                    uint8 *sides,
+			                    float epsilon = 0.0f) const
+			{
+				size_t simdCount = count & ~(size_t)3;
+				size_t i = 0;
+				for (; i < simdCount; i += 4)
+				{
+					int front;
+					int back;
+					classifyFour(&points[i], distances ? distances + i : 0,
+					             epsilon, front, back);
+					int on = ~(front | back) & 0xf;
+					// Expand the masks to one byte per point, the byte-wise
+					// sum cannot overflow so the byte order does not matter
+					uint32 backBytes;
+					uint32 onBytes;
+					memcpy(&backBytes, expandMask(back), 4);
+					memcpy(&onBytes, expandMask(on), 4);
+					uint32 sideBytes = backBytes * Back + onBytes * On;
+					memcpy(&sides[i], &sideBytes, 4);
+				}
+				for (; i < count; i++)
+				{
+					float distance = getDistance(points[i]);
+					if (distances)
+						distances[i] = distance;
+					sides[i] = (uint8)classifyDistance(distance, epsilon);
+				}
+			}
+			/**
+			 * Version of classifyPoints() which creates compacted lists of
+			 * the indices of the points on each side, which can be used to
+			 * clip meshes. The indices are appended to the lists in
+			 * ascending order.
+			 * @param distances If not 0, receives the distance of every point.
+			 * @param front Receives the indices of the points in front of
+			 * the plane.
+			 * @param back Receives the indices of the points behind the
+			 * plane.
+			 * @param on Receives the indices of the points within epsilon of
+			 * the plane.
+			 */
+			void classifyPoints(const Vec3f *points,
+			                    size_t count,
+			                    float *distances,
+			                    std::vector<uint32> &front,
+			                    std::vector<uint32> &back,
+			                    std::vector<uint32> &on,
+			                    float epsilon = 0.0f) const
+			{
+				size_t simdCount = count & ~(size_t)3;
+				size_t i = 0;
+				for (; i < simdCount; i += 4)
+				{
+					int frontMask;
+					int backMask;
+					classifyFour(&points[i], distances ? distances + i : 0,
+					             epsilon, frontMask, backMask);
+					appendIndices((uint32)i, frontMask, front);
+					appendIndices((uint32)i, backMask, back);
+					appendIndices((uint32)i, ~(frontMask | backMask) & 0xf, on);
+				}
+				for (; i < count; i++)
+				{
+					float distance = getDistance(points[i]);
+					if (distances)
+						distances[i] = distance;
+					switch (classifyDistance(distance, epsilon))
+					{
+						case Front:
+							front.push_back((uint32)i);
+							break;
+						case Back:
+							back.push_back((uint32)i);
+							break;
+						default:
+							on.push_back((uint32)i);
+							break;
+					}
+				}
+			}
+			/**
+			 * Intersects an array of line segments with the plane, the
+			 * results are the same as the ones of intersectWithLineSegment().
+			 * Four segments are processed at once.
+			 * @param points1 Start points of the segments.
+			 * @param points2 End points of the segments.
+			 * @param count Number of segments.
+			 * @param intersections Receives the intersection points. The
+			 * contents are undefined for segments which do not intersect the
+			 * plane.
+			 * @param hitMask Bit mask with room for (count + 31) / 32 values.
+			 * Bit i % 32 of hitMask[i / 32] is set if segment i intersects
+			 * the plane.
+			 * @return Number of segments which intersect the plane.
+			 */
+			size_t intersectWithLineSegments(const Vec3f *points1,
+			                                 const Vec3f *points2,
+			                                 size_t count,
+			                                 Vec3f *intersections,
+			                                 uint32 *hitMask) const
+			{
+				memset(hitMask, 0, ((count + 31) / 32) * sizeof(uint32));
+				Float4 nx(normal.x);
+				Float4 ny(normal.y);
+				Float4 nz(normal.z);
+				Float4 d4(d);
+				Float4 zero = Float4::zero();
+				Float4 one(1.0f);
+				size_t hits = 0;
+				size_t simdCount = count & ~(size_t)3;
+				size_t i = 0;
+				for (; i < simdCount; i += 4)
+				{
+					Float4 x1, y1, z1;
+					Float4 x2, y2, z2;
+					loadInterleaved3(&points1[i].x, x1, y1, z1);
+					loadInterleaved3(&points2[i].x, x2, y2, z2);
+					Float4 ndotd = (x2 - x1) * nx + (y2 - y1) * ny + (z2 - z1) * nz;
+					Float4 ndotv = x1 * nx + y1 * ny + z1 * nz;
+					// Parallel segments result in NaN or infinity which fails
+					// the range test
+					Float4 s = (d4 - ndotv) / ndotd;
+					Float4 parallel = ndotd == zero;
+					Float4 hit = (s >= zero) & (s <= one);
+					hit = select(parallel, (ndotv - d4) == zero, hit);
+					Float4 t = one - s;
+					Float4 x = select(parallel, x1, t * x1 + s * x2);
+					Float4 y = select(parallel, y1, t * y1 + s * y2);
+					Float4 z = select(parallel, z1, t * z1 + s * z2);
+					storeInterleaved3(&intersections[i].x, x, y, z);
+					uint32 mask = (uint32)hit.mask();
+					hitMask[i / 32] |= mask << (i % 32);
+					hits += (mask & 1) + ((mask >> 1) & 1) + ((mask >> 2) & 1) + (mask >> 3);
+				}
+				for (; i < count; i++)
+				{
+					if (intersectWithLineSegment(points1[i], points2[i], &intersections[i]))
+					{
+						hitMask[i / 32] |= 1u << (i % 32);
+						hits++;
+					}
+				}
+				return hits;
+			}
+
+			/**
+			 * Clips a convex polygon against the plane (Sutherland-Hodgman) and
+			 * keeps the part in front of the plane, i.e. the part with a
+			 * distance of at least 0.
+			 *
+			 * New vertices are always interpolated from the vertex in front of
+			 * the plane to the one behind it, so edges shared by two polygons
+			 * are clipped at exactly the same point and no cracks appear.
+			 *
+			 * A convex polygon gains at most one vertex, but rounding can
+			 * leave the output of an earlier clip slightly non-convex, in
+			 * which case every vertex can produce up to two vertices.
+			 *
+			 * @param vertices Vertices of the polygon.
+			 * @param count Number of vertices.
+			 * @param result Receives the vertices of the clipped polygon, must
+			 * not overlap with vertices.
+			 * @param maxCount Number of vertices result has room for. If the
+			 * clipped polygon does not fit, 0 is returned. 2 * count vertices
+			 * are always sufficient.
+			 * @return Number of vertices of the clipped polygon, 0 if less
+			 * than three vertices remain.
+			 */
+			unsigned int clipPolygon(const Vec3f *vertices,
+			                         unsigned int count,
+			                         Vec3f *result,
+			                         unsigned int maxCount) const
+			{
+				if (count == 0)
+					return 0;
+				unsigned int resultCount = 0;
+				unsigned int previous = count - 1;
+				float previousDistance = getDistance(vertices[previous]);
+				for (unsigned int i = 0; i < count; i++)
+				{
+					float distance = getDistance(vertices[i]);
+					bool inside = distance >= 0.0f;
+					if (inside != (previousDistance >= 0.0f))
+					{
+						if (resultCount == maxCount)
+							return 0;
+						if (inside)
+						{
+							result[resultCount++] = interpolate(vertices[i],
+							                                    distance,
+							                                    vertices[previous],
+							                                    previousDistance);
+						}
+						else
+						{
+							result[resultCount++] = interpolate(vertices[previous],
+							                                    previousDistance,
+							                                    vertices[i],
+							                                    distance);
+						}
+					}
+					if (inside)
+					{
+						if (resultCount == maxCount)
+							return 0;
+						result[resultCount++] = vertices[i];
+					}
+					previous = i;
+					previousDistance = distance;
+				}
+				return resultCount < 3 ? 0 : resultCount;
+			}
+			/**
+			 * Clips an array of triangles against the plane and appends the
+			 * triangles of the clipped polygons to result. Every input triangle
+			 * produces up to two output triangles.
+			 *
+			 * Triangles which are completely in front of the plane are copied
+			 * unchanged. No memory is allocated if result already has enough
+			 * capacity, so the output vectors should be reused.
+			 *
+			 * @param vertices Vertices of the triangles, three per triangle.
+			 * @param triangleCount Number of triangles.
+			 * @param result Receives the vertices of the output triangles.
+			 * @param sourceTriangles If not 0, receives the index of the input
+			 * triangle for every output triangle.
+			 * @return Number of triangles appended to result.
+			 */
+			unsigned int clipTriangles(const Vec3f *vertices,
+			                           unsigned int triangleCount,
+			                           std::vector<Vec3f> &result,
+			                           std::vector<uint32> *sourceTriangles = 0) const
+			{
+				unsigned int outputCount = 0;
+				// A clipped triangle has at most four vertices
+				Vec3f polygon[4];
+				for (unsigned int i = 0; i < triangleCount; i++)
+				{
+					const Vec3f *triangle = &vertices[3 * i];
+					float distance0 = getDistance(triangle[0]);
+					float distance1 = getDistance(triangle[1]);
+					float distance2 = getDistance(triangle[2]);
+					if (distance0 < 0.0f && distance1 < 0.0f && distance2 < 0.0f)
+						continue;
+					if (distance0 >= 0.0f && distance1 >= 0.0f && distance2 >= 0.0f)
+					{
+						outputCount += appendTriangleFan(triangle, 3, i, result,
+						                                 sourceTriangles);
+						continue;
+					}
+					unsigned int count = clipPolygon(triangle, 3, polygon, 4);
+					outputCount += appendTriangleFan(polygon, count, i, result,
+					                                 sourceTriangles);
+				}
+				return outputCount;
+			}
+			/**
+			 * Triangulates a convex polygon as a triangle fan and appends the
+			 * triangles to result.
+			 * @param source Value which is appended to sourceTriangles (if not
+			 * 0) for every triangle.
+			 * @return Number of appended triangles.
+			 */
+			static unsigned int appendTriangleFan(const Vec3f *polygon,
+			                                      unsigned int count,
+			                                      uint32 source,
+			                                      std::vector<Vec3f> &result,
+			                                      std::vector<uint32> *sourceTriangles)
+			{
+				if (count < 3)
+					return 0;
+				for (unsigned int i = 2; i < count; i++)
+				{
+					result.push_back(polygon[0]);
+					result.push_back(polygon[i - 1]);
+					result.push_back(polygon[i]);
+					if (sourceTriangles)
+						sourceTriangles->push_back(source);
+				}
+				return count - 2;
+			}
+
 			/**
 			 * Normal vector of the plane.
 			 */
@@ -208,6 +531,71 @@ namespace math
 			 * plane.
 			 */
 			float d;
+		private:
+			/**
+			 * Returns the point on the edge between a point in front of the
+			 * plane and a point behind it.
+			 */
+			static Vec3f interpolate(const Vec3f &front,
+			                         float frontDistance,
+			                         const Vec3f &back,
+			                         float backDistance)
+			{
+				float s = frontDistance / (frontDistance - backDistance);
+				return front + s * (back - front);
+			}
+			static Side classifyDistance(float distance, float epsilon)
+			{
+				if (distance > epsilon)
+					return Front;
+				if (distance < -epsilon)
+					return Back;
+				return On;
+			}
+			/**
+			 * Computes the distances of four points and returns bit masks of
+			 * the points in front of and behind the plane.
+			 */
+			void classifyFour(const Vec3f *points,
+			                  float *distances,
+			                  float epsilon,
+			                  int &front,
+			                  int &back) const
+			{
+				Float4 x, y, z;
+				loadInterleaved3(&points[0].x, x, y, z);
+				Float4 distance = x * Float4(normal.x) + y * Float4(normal.y)
+				                + z * Float4(normal.z) - Float4(d);
+				if (distances)
+					distance.store(distances);
+				front = (distance > Float4(epsilon)).mask();
+				back = (distance < Float4(-epsilon)).mask();
+			}
+			/**
+			 * Returns four bytes which are 1 if the corresponding bit of
+			 * the mask is set and 0 otherwise.
+			 */
+			static const uint8 *expandMask(int mask)
+			{
+				static const uint8 bytes[16][4] =
+				{
+					{0, 0, 0, 0}, {1, 0, 0, 0}, {0, 1, 0, 0}, {1, 1, 0, 0},
+					{0, 0, 1, 0}, {1, 0, 1, 0}, {0, 1, 1, 0}, {1, 1, 1, 0},
+					{0, 0, 0, 1}, {1, 0, 0, 1}, {0, 1, 0, 1}, {1, 1, 0, 1},
+					{0, 0, 1, 1}, {1, 0, 1, 1}, {0, 1, 1, 1}, {1, 1, 1, 1}
+				};
+				return bytes[mask];
+			}
+			static void appendIndices(uint32 first, int mask, std::vector<uint32> &indices)
+			{
+				uint32 bits = (uint32)mask;
+				while (bits != 0)
+				{
+					uint32 lowest = bits & (~bits + 1);
+					indices.push_back(first + Math::log2FromPowerOfTwo(lowest));
+					bits &= bits - 1;
+				}
+			}
 		};
 }
 
@@ -36,4 +36,21 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 	#define GAMEMATH_GCC
 #endif
 
+// SIMD instruction sets enabled for the current compiler target. Define
+// GAMEMATH_NO_SIMD to force the scalar code paths everywhere.
+#if !defined(GAMEMATH_NO_SIMD)
+	#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+		#define GAMEMATH_SSE2
+	#endif
+	#if defined(GAMEMATH_SSE2) && defined(__AVX__)
+		#define GAMEMATH_AVX
+	#endif
+	#if defined(GAMEMATH_AVX) && (defined(__FMA__) || (defined(GAMEMATH_MSVC) && defined(__AVX2__)))
+		#define GAMEMATH_FMA
+	#endif
+	#if defined(GAMEMATH_AVX) && (defined(__F16C__) || (defined(GAMEMATH_MSVC) && defined(__AVX2__)))
+		#define GAMEMATH_F16C
+	#endif
+#endif
+
 #endif
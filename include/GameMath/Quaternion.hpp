@@ -40,6 +40,10 @@ and to alter it and redistribute it freely, subject to the following restriction
 
 #include "Vec3.hpp"
 #include "Mat4.hpp"
+#include "Simd.hpp"
+
+#include <cmath>
+#include <cstddef>
 
 namespace math
 {
@@ -101,6 +105,48 @@ namespace math
 
 			normalize();
 		}
+		/**
+		 * Creates a quaternion from the rotation part of a matrix. The
+		 * upper 3x3 part of the matrix has to be a rotation without scale.
+		 */
+		explicit Quaternion(const Mat4f &m)
+		{
+			float trace = m(0, 0) + m(1, 1) + m(2, 2);
+			// Use the largest component for the square root to avoid
+			// cancellation
+			if (trace > 0.0f)
+			{
+				float s = 0.5f / sqrtf(trace + 1.0f);
+				w = 0.25f / s;
+				x = (m(2, 1) - m(1, 2)) * s;
+				y = (m(0, 2) - m(2, 0)) * s;
+				z = (m(1, 0) - m(0, 1)) * s;
+			}
+			else if (m(0, 0) > m(1, 1) && m(0, 0) > m(2, 2))
+			{
+				float s = 2.0f * sqrtf(1.0f + m(0, 0) - m(1, 1) - m(2, 2));
+				w = (m(2, 1) - m(1, 2)) / s;
+				x = 0.25f * s;
+				y = (m(0, 1) + m(1, 0)) / s;
+				z = (m(0, 2) + m(2, 0)) / s;
+			}
+			else if (m(1, 1) > m(2, 2))
+			{
+				float s = 2.0f * sqrtf(1.0f + m(1, 1) - m(0, 0) - m(2, 2));
+				w = (m(0, 2) - m(2, 0)) / s;
+				x = (m(0, 1) + m(1, 0)) / s;
+				y = 0.25f * s;
+				z = (m(1, 2) + m(2, 1)) / s;
+			}
+			else
+			{
+				float s = 2.0f * sqrtf(1.0f + m(2, 2) - m(0, 0) - m(1, 1));
+				w = (m(1, 0) - m(0, 1)) / s;
+				x = (m(0, 2) + m(2, 0)) / s;
+				y = (m(1, 2) + m(2, 1)) / s;
+				z = 0.25f * s;
+			}
+		}
 		/**
 		 * Copy constructor.
 		 */
@@ -128,6 +174,9 @@ namespace math
 		 * \param b Second quaternion
 		 * \param d Interpolation factor. If it is 0, then the quaternion
 		 * will be set to a, if it is 1, the quaternion will be b.
+		 *
+		 * The result is not normalized and the interpolation does not take
+		 * the shortest path, use nlerp() or slerp() for rotations.
 		 */
 		Quaternion &interpolate(const Quaternion &a, const Quaternion &b,
 			float d)
@@ -136,11 +185,193 @@ namespace math
 			*this = a + dv * d;
 			return *this;
 		}
+		/**
+		 * Sets the quaternion to the normalized linear interpolation between
+		 * a and b. b is negated if necessary so that the interpolation takes
+		 * the shortest path. The angular velocity is not constant, but the
+		 * function is a lot faster than slerp().
+		 * \param a First quaternion
+		 * \param b Second quaternion
+		 * \param d Interpolation factor between 0 and 1.
+		 */
+		Quaternion &nlerp(const Quaternion &a, const Quaternion &b, float d)
+		{
+			float sign = a.dot(b) < 0.0f ? -1.0f : 1.0f;
+			*this = a + (b * sign - a) * d;
+			normalize();
+			return *this;
+		}
+		/**
+		 * Sets the quaternion to the spherical linear interpolation between
+		 * a and b along the shortest path. a and b have to be normalized.
+		 * \param a First quaternion
+		 * \param b Second quaternion
+		 * \param d Interpolation factor between 0 and 1.
+		 */
+		Quaternion &slerp(const Quaternion &a, const Quaternion &b, float d)
+		{
+			float cosAngle = a.dot(b);
+			float sign = 1.0f;
+			if (cosAngle < 0.0f)
+			{
+				cosAngle = -cosAngle;
+				sign = -1.0f;
+			}
+			// For small angles sin(angle) loses precision, but nlerp is
+			// accurate there
+			if (cosAngle > 0.9995f)
+				return nlerp(a, b, d);
+			float angle = acosf(cosAngle);
+			float invSin = 1.0f / sinf(angle);
+			float s0 = sinf((1.0f - d) * angle) * invSin;
+			float s1 = sinf(d * angle) * invSin * sign;
+			*this = a * s0 + b * s1;
+			return *this;
+		}
+		/**
+		 * Sets the quaternion to an approximation of slerp(). The
+		 * interpolation factor is corrected with a polynomial fitted to
+		 * slerp and the quaternions are then interpolated with nlerp(), so
+		 * no trigonometric functions are needed. The maximum angular error
+		 * is below 0.001 radians.
+		 * \param a First quaternion
+		 * \param b Second quaternion
+		 * \param d Interpolation factor between 0 and 1.
+		 */
+		Quaternion &fastSlerp(const Quaternion &a, const Quaternion &b, float d)
+		{
+			float cosAngle = fabsf(a.dot(b));
+			float ka = 1.0904f + cosAngle * (-3.2452f + cosAngle
+			         * (3.55645f - cosAngle * 1.43519f));
+			float kb = 0.848013f + cosAngle * (-1.06021f + cosAngle * 0.215638f);
+			float k = ka * (d - 0.5f) * (d - 0.5f) + kb;
+			float corrected = d + d * (d - 0.5f) * (d - 1.0f) * k;
+			return nlerp(a, b, corrected);
+		}
+		/**
+		 * Blends two arrays of quaternions (e.g. the poses of a skeleton)
+		 * with nlerp(). Four quaternions are processed at once.
+		 * \param a First quaternions.
+		 * \param b Second quaternions.
+		 * \param d Interpolation factor between 0 and 1.
+		 * \param result Receives the blended quaternions, may be equal to a
+		 * or b.
+		 * \param count Number of quaternions.
+		 */
+		static void nlerp(const Quaternion *a, const Quaternion *b, float d,
+			Quaternion *result, size_t count)
+		{
+			blend(a, b, UniformWeight(d), false, result, count);
+		}
+		/**
+		 * Version of nlerp() with one interpolation factor per quaternion,
+		 * e.g. for partial blends which only affect some bones.
+		 */
+		static void nlerp(const Quaternion *a, const Quaternion *b,
+			const float *weights, Quaternion *result, size_t count)
+		{
+			blend(a, b, ArrayWeight(weights), false, result, count);
+		}
+		/**
+		 * Blends two arrays of quaternions with fastSlerp(), see nlerp().
+		 */
+		static void fastSlerp(const Quaternion *a, const Quaternion *b,
+			float d, Quaternion *result, size_t count)
+		{
+			blend(a, b, UniformWeight(d), true, result, count);
+		}
+		/**
+		 * Version of fastSlerp() with one interpolation factor per
+		 * quaternion.
+		 */
+		static void fastSlerp(const Quaternion *a, const Quaternion *b,
+			const float *weights, Quaternion *result, size_t count)
+		{
+			blend(a, b, ArrayWeight(weights), true, result, count);
+		}
+
+		/**
+		 * Returns the dot product of the two quaternions.
+		 */
+		float dot(const Quaternion &other) const
+		{
+			return x * other.x + y * other.y + z * other.z + w * other.w;
+		}
+
+		/**
+		 * Returns the conjugate of the quaternion, which is the inverse
+		 * rotation for normalized quaternions.
+		 */
+		Quaternion conjugate() const
+		{
+			return Quaternion(-x, -y, -z, w);
+		}
+		/**
+		 * Returns the inverse of the quaternion. For normalized quaternions
+		 * conjugate() returns the same result faster.
+		 */
+		Quaternion inverse() const
+		{
+			return conjugate() / dot(*this);
+		}
+		/**
+		 * Rotates a vector by the quaternion, which has to be normalized.
+		 *
+		 * Uses v' = v + w * t + cross(q, t) with t = 2 * cross(q, v) which
+		 * takes 15 multiplications instead of the 27 of the full product
+		 * q * v * conjugate(q).
+		 */
+		Vec3f rotate(const Vec3f &v) const
+		{
+			float tx = y * v.z - z * v.y;
+			float ty = z * v.x - x * v.z;
+			float tz = x * v.y - y * v.x;
+			tx += tx;
+			ty += ty;
+			tz += tz;
+			return Vec3f(v.x + w * tx + (y * tz - z * ty),
+			             v.y + w * ty + (z * tx - x * tz),
+			             v.z + w * tz + (x * ty - y * tx));
+		}
+		/**
+		 * Rotates an array of vectors by the quaternion, see rotate(). Four
+		 * vectors are processed at once.
+		 * \param vectors Input vectors.
+		 * \param result Receives the rotated vectors, may be equal to
+		 * vectors.
+		 * \param count Number of vectors.
+		 */
+		void rotate(const Vec3f *vectors, Vec3f *result, size_t count) const
+		{
+			Float4 qx(x);
+			Float4 qy(y);
+			Float4 qz(z);
+			Float4 qw(w);
+			size_t simdCount = count & ~(size_t)3;
+			size_t i = 0;
+			for (; i < simdCount; i += 4)
+			{
+				Float4 vx, vy, vz;
+				loadInterleaved3(&vectors[i].x, vx, vy, vz);
+				Float4 tx = qy * vz - qz * vy;
+				Float4 ty = qz * vx - qx * vz;
+				Float4 tz = qx * vy - qy * vx;
+				tx = tx + tx;
+				ty = ty + ty;
+				tz = tz + tz;
+				vx = vx + qw * tx + (qy * tz - qz * ty);
+				vy = vy + qw * ty + (qz * tx - qx * tz);
+				vz = vz + qw * tz + (qx * ty - qy * tx);
+				storeInterleaved3(&result[i].x, vx, vy, vz);
+			}
+			for (; i < count; i++)
+				result[i] = rotate(vectors[i]);
+		}
 
 		/**
 		 * Creates a rotation matrix from the quaternion.
 		 */
-		Mat4f toMatrix()
+		Mat4f toMatrix() const
 		{
 			Mat4f m;
 			m(0, 0) = 1.0f - 2.0f * (y * y + z * z);
@@ -165,6 +396,30 @@ namespace math
 			return m;
 		}
 
+		/**
+		 * Returns the Hamilton product of the quaternions, which is the
+		 * rotation by other followed by the rotation by this quaternion, so
+		 * (a * b).toMatrix() equals a.toMatrix() * b.toMatrix().
+		 */
+		Quaternion operator*(const Quaternion &other) const
+		{
+			Float4 a = Float4::load(&x);
+			Float4 b = Float4::load(&other.x);
+			// Negates the w component of the partial products
+			Float4 negateW(0.0f, 0.0f, 0.0f, -0.0f);
+			Float4 r = a.splat<3>() * b;
+			r = r + ((shuffle<0, 1, 2, 0>(a, a) * shuffle<3, 3, 3, 0>(b, b)) ^ negateW);
+			r = r + ((shuffle<1, 2, 0, 1>(a, a) * shuffle<2, 0, 1, 1>(b, b)) ^ negateW);
+			r = r - shuffle<2, 0, 1, 2>(a, a) * shuffle<1, 2, 0, 2>(b, b);
+			Quaternion result;
+			r.store(&result.x);
+			return result;
+		}
+		Quaternion &operator*=(const Quaternion &other)
+		{
+			*this = *this * other;
+			return *this;
+		}
 		Quaternion operator*(float s) const
 		{
 			return Quaternion(x * s, y * s, z * s, w * s);
@@ -241,6 +496,104 @@ namespace math
 		float y;
 		float z;
 		float w;
+	private:
+		struct UniformWeight
+		{
+			UniformWeight(float d)
+				: d(d)
+			{
+			}
+			float get(size_t) const
+			{
+				return d;
+			}
+			Float4 load(size_t) const
+			{
+				return Float4(d);
+			}
+			float d;
+		};
+		struct ArrayWeight
+		{
+			ArrayWeight(const float *weights)
+				: weights(weights)
+			{
+			}
+			float get(size_t i) const
+			{
+				return weights[i];
+			}
+			Float4 load(size_t i) const
+			{
+				return Float4::load(weights + i);
+			}
+			const float *weights;
+		};
+
+		template<typename Weight>
+		static void blend(const Quaternion *a, const Quaternion *b,
+			const Weight &weight, bool correct, Quaternion *result,
+			size_t count)
+		{
+			Float4 half(0.5f);
+			Float4 one(1.0f);
+			Float4 signMask(-0.0f);
+			size_t simdCount = count & ~(size_t)3;
+			size_t i = 0;
+			for (; i < simdCount; i += 4)
+			{
+				Float4 ax = Float4::load(&a[i].x);
+				Float4 ay = Float4::load(&a[i + 1].x);
+				Float4 az = Float4::load(&a[i + 2].x);
+				Float4 aw = Float4::load(&a[i + 3].x);
+				transpose(ax, ay, az, aw);
+				Float4 bx = Float4::load(&b[i].x);
+				Float4 by = Float4::load(&b[i + 1].x);
+				Float4 bz = Float4::load(&b[i + 2].x);
+				Float4 bw = Float4::load(&b[i + 3].x);
+				transpose(bx, by, bz, bw);
+				Float4 d = weight.load(i);
+				Float4 cosAngle = ax * bx + ay * by + az * bz + aw * bw;
+				// Negate b if the quaternions are in different hemispheres
+				Float4 sign = cosAngle & signMask;
+				bx = bx ^ sign;
+				by = by ^ sign;
+				bz = bz ^ sign;
+				bw = bw ^ sign;
+				if (correct)
+				{
+					// See fastSlerp()
+					Float4 c = abs(cosAngle);
+					Float4 ka = Float4(1.0904f) + c * (Float4(-3.2452f) + c
+					          * (Float4(3.55645f) - c * Float4(1.43519f)));
+					Float4 kb = Float4(0.848013f) + c * (Float4(-1.06021f)
+					          + c * Float4(0.215638f));
+					Float4 k = ka * (d - half) * (d - half) + kb;
+					d = d + d * (d - half) * (d - one) * k;
+				}
+				Float4 rx = ax + (bx - ax) * d;
+				Float4 ry = ay + (by - ay) * d;
+				Float4 rz = az + (bz - az) * d;
+				Float4 rw = aw + (bw - aw) * d;
+				Float4 length = sqrt(rx * rx + ry * ry + rz * rz + rw * rw);
+				rx = rx / length;
+				ry = ry / length;
+				rz = rz / length;
+				rw = rw / length;
+				transpose(rx, ry, rz, rw);
+				rx.store(&result[i].x);
+				ry.store(&result[i + 1].x);
+				rz.store(&result[i + 2].x);
+				rw.store(&result[i + 3].x);
+			}
+			for (; i < count; i++)
+			{
+				if (correct)
+					result[i].fastSlerp(a[i], b[i], weight.get(i));
+				else
+					result[i].nlerp(a[i], b[i], weight.get(i));
+			}
+		}
 	};
 }
 
@@ -0,0 +1,625 @@
+/*
+Copyright (C) 2011, Mathias Gottschlag
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef GAMEMATH_RAY_HPP_INCLUDED
+#define GAMEMATH_RAY_HPP_INCLUDED
+
+#include "BoundingBox.hpp"
+#include "Simd.hpp"
+#include "Types.hpp"
+#include "Vec3.hpp"
+#include "Vec3Stream.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+
+namespace math
+{
+	/**
+	 * Ray with origin and direction. The inverse of the direction is stored
+	 * as well, as it is needed for all intersection tests with boxes.
+	 *
+	 * The box tests use the slab method without branches. The sign of the
+	 * inverse direction selects which side of each slab is entered first.
+	 * Components of the direction which are 0 result in an infinite inverse
+	 * direction, which is handled correctly: the NaN of 0 * infinity which
+	 * occurs if the ray lies exactly in the plane of a side is ignored, so
+	 * such rays hit the box.
+	 */
+	class Ray
+	{
+		public:
+			/**
+			 * Result of a ray/triangle intersection. The hit point is
+			 * (1 - u - v) * v0 + u * v1 + v * v2.
+			 */
+			struct TriangleHit
+			{
+				/**
+				 * Distance along the ray, in multiples of the direction.
+				 */
+				float distance;
+				float u;
+				float v;
+			};
+
+			Ray()
+			{
+				setDirection(Vec3f(0, 0, 1));
+			}
+			/**
+			 * Constructor.
+			 * @param origin Start point of the ray.
+			 * @param direction Direction of the ray. Distances are measured in
+			 * multiples of the length of the direction.
+			 */
+			Ray(const Vec3f &origin, const Vec3f &direction)
+				: origin(origin)
+			{
+				setDirection(direction);
+			}
+
+			void setDirection(const Vec3f &direction)
+			{
+				this->direction = direction;
+				invDirection = Vec3f(1.0f / direction.x,
+				                     1.0f / direction.y,
+				                     1.0f / direction.z);
+				// Transformation for the watertight triangle test, the
+				// dominant axis of the direction becomes the z axis and the
+				// winding of the other two is kept
+				const float *d = &direction.x;
+				kz = 0;
+				if (std::fabs(d[1]) > std::fabs(d[kz]))
+					kz = 1;
+				if (std::fabs(d[2]) > std::fabs(d[kz]))
+					kz = 2;
+				kx = (uint8)((kz + 1) % 3);
+				ky = (uint8)((kx + 1) % 3);
+				if (d[kz] < 0.0f)
+					std::swap(kx, ky);
+				shearX = d[kx] / d[kz];
+				shearY = d[ky] / d[kz];
+				shearZ = 1.0f / d[kz];
+			}
+			const Vec3f &getDirection() const
+			{
+				return direction;
+			}
+			const Vec3f &getInverseDirection() const
+			{
+				return invDirection;
+			}
+			/**
+			 * Returns the point origin + distance * direction.
+			 */
+			Vec3f getPoint(float distance) const
+			{
+				return origin + direction * distance;
+			}
+
+			/**
+			 * Tests whether the ray hits a box.
+			 * @param box Box to test.
+			 * @param maxDistance Length of the ray.
+			 * @param distance If not 0, receives the distance at which the ray
+			 * enters the box, or 0 if the origin is inside the box.
+			 * @return True if the box is hit between 0 and maxDistance.
+			 */
+			bool intersect(const BoundingBox &box,
+			               float maxDistance,
+			               float *distance = 0) const
+			{
+				float tmin = 0.0f;
+				float tmax = maxDistance;
+				for (unsigned int i = 0; i < 3; i++)
+				{
+					float o = (&origin.x)[i];
+					float inv = (&invDirection.x)[i];
+					float boxMin = (&box.minCorner.x)[i];
+					float boxMax = (&box.maxCorner.x)[i];
+					float tnear = ((inv < 0.0f ? boxMax : boxMin) - o) * inv;
+					float tfar = ((inv < 0.0f ? boxMin : boxMax) - o) * inv;
+					// std::max/std::min return the first operand for NaN
+					tmin = std::max(tmin, tnear);
+					tmax = std::min(tmax, tfar);
+				}
+				if (distance)
+					*distance = tmin;
+				return tmin <= tmax;
+			}
+			/**
+			 * Tests the ray against F::Width boxes in SoA form (F is Float4,
+			 * Float8 or SimdFloat).
+			 * @param maxDistance Length of the ray.
+			 * @param distance If not 0, receives the entry distances, only
+			 * valid for lanes where the box is hit.
+			 * @return Mask with bit i set if box i is hit.
+			 */
+			template<typename F> int intersect(const F &minX,
+			                                   const F &minY,
+			                                   const F &minZ,
+			                                   const F &maxX,
+			                                   const F &maxY,
+			                                   const F &maxZ,
+			                                   float maxDistance,
+			                                   F *distance = 0) const
+			{
+				F tmin = F::zero();
+				F tmax(maxDistance);
+				if (invDirection.x < 0.0f)
+					slab(maxX, minX, F(origin.x), F(invDirection.x), tmin, tmax);
+				else
+					slab(minX, maxX, F(origin.x), F(invDirection.x), tmin, tmax);
+				if (invDirection.y < 0.0f)
+					slab(maxY, minY, F(origin.y), F(invDirection.y), tmin, tmax);
+				else
+					slab(minY, maxY, F(origin.y), F(invDirection.y), tmin, tmax);
+				if (invDirection.z < 0.0f)
+					slab(maxZ, minZ, F(origin.z), F(invDirection.z), tmin, tmax);
+				else
+					slab(minZ, maxZ, F(origin.z), F(invDirection.z), tmin, tmax);
+				if (distance)
+					*distance = tmin;
+				return (tmin <= tmax).mask();
+			}
+			/**
+			 * Tests the ray against an array of boxes in SoA form,
+			 * SimdFloat::Width boxes are tested at once.
+			 * @param minCorners Minimum corners of the boxes.
+			 * @param maxCorners Maximum corners of the boxes, has to have the
+			 * same size as minCorners.
+			 * @param maxDistance Length of the ray.
+			 * @param hitMask Bit mask with room for
+			 * (minCorners.size() + 31) / 32 values. Bit i % 32 of
+			 * hitMask[i / 32] is set if box i is hit.
+			 */
+			void intersect(const Vec3Streamf &minCorners,
+			               const Vec3Streamf &maxCorners,
+			               float maxDistance,
+			               uint32 *hitMask) const
+			{
+				size_t count = minCorners.size();
+				memset(hitMask, 0, ((count + 31) / 32) * sizeof(uint32));
+				const uint32 lanemask = (1u << SimdFloat::Width) - 1;
+				for (size_t i = 0; i < count; i += SimdFloat::Width)
+				{
+					uint32 hit = (uint32)intersect(SimdFloat::load(minCorners.x + i),
+					                               SimdFloat::load(minCorners.y + i),
+					                               SimdFloat::load(minCorners.z + i),
+					                               SimdFloat::load(maxCorners.x + i),
+					                               SimdFloat::load(maxCorners.y + i),
+					                               SimdFloat::load(maxCorners.z + i),
+					                               maxDistance) & lanemask;
+					// Clear the bits of the padding elements
+					if (count - i < SimdFloat::Width)
+						hit &= (1u << (count - i)) - 1;
+					hitMask[i / 32] |= hit << (i % 32);
+				}
+			}
+
+			/**
+			 * Tests whether the ray hits a triangle (Möller-Trumbore). Both
+			 * sides of the triangle are hit.
+			 *
+			 * This test is fast, but rays which hit an edge shared by two
+			 * triangles can miss both triangles due to rounding errors, see
+			 * intersectTriangleWatertight().
+			 * @param maxDistance Length of the ray.
+			 * @param hit If not 0, receives the distance and the barycentric
+			 * coordinates of the hit point.
+			 * @return True if the triangle is hit between 0 and maxDistance.
+			 */
+			bool intersectTriangle(const Vec3f &v0,
+			                       const Vec3f &v1,
+			                       const Vec3f &v2,
+			                       float maxDistance,
+			                       TriangleHit *hit = 0) const
+			{
+				Vec3f edge1 = v1 - v0;
+				Vec3f edge2 = v2 - v0;
+				Vec3f p = direction.cross(edge2);
+				// Rays parallel to the triangle result in an infinite or NaN
+				// inverse determinant, which fails the tests below
+				float invDet = 1.0f / edge1.dot(p);
+				Vec3f s = origin - v0;
+				Vec3f q = s.cross(edge1);
+				float u = s.dot(p) * invDet;
+				float v = direction.dot(q) * invDet;
+				float t = edge2.dot(q) * invDet;
+				if (!(u >= 0.0f && v >= 0.0f && u + v <= 1.0f
+				   && t >= 0.0f && t <= maxDistance))
+					return false;
+				if (hit)
+				{
+					hit->distance = t;
+					hit->u = u;
+					hit->v = v;
+				}
+				return true;
+			}
+			/**
+			 * Watertight ray/triangle test (Woop, Benthin and Wald, 2013).
+			 * Rays which hit an edge or a vertex shared by several
+			 * triangles always hit at least one of them, which makes this
+			 * test suitable for closed meshes.
+			 *
+			 * The triangle is transformed into a coordinate system where the
+			 * ray starts at the origin and points along the z axis, so that
+			 * the edge tests are 2D tests which are exact for edges shared
+			 * by two triangles. The edge tests are computed in double
+			 * precision.
+			 * @see intersectTriangle()
+			 */
+			bool intersectTriangleWatertight(const Vec3f &v0,
+			                                 const Vec3f &v1,
+			                                 const Vec3f &v2,
+			                                 float maxDistance,
+			                                 TriangleHit *hit = 0) const
+			{
+				Vec3f a = v0 - origin;
+				Vec3f b = v1 - origin;
+				Vec3f c = v2 - origin;
+				const float *pa = &a.x;
+				const float *pb = &b.x;
+				const float *pc = &c.x;
+				float ax = pa[kx] - shearX * pa[kz];
+				float ay = pa[ky] - shearY * pa[kz];
+				float bx = pb[kx] - shearX * pb[kz];
+				float by = pb[ky] - shearY * pb[kz];
+				float cx = pc[kx] - shearX * pc[kz];
+				float cy = pc[ky] - shearY * pc[kz];
+				// Scaled barycentric coordinates (edge functions). The
+				// products are exact in double precision, so the results
+				// cannot change their sign if the compiler fuses the
+				// multiplication and the subtraction.
+				float e0 = (float)((double)cx * by - (double)cy * bx);
+				float e1 = (float)((double)ax * cy - (double)ay * cx);
+				float e2 = (float)((double)bx * ay - (double)by * ax);
+				if ((e0 < 0.0f || e1 < 0.0f || e2 < 0.0f)
+				 && (e0 > 0.0f || e1 > 0.0f || e2 > 0.0f))
+					return false;
+				float det = e0 + e1 + e2;
+				if (det == 0.0f)
+					return false;
+				float t = e0 * (shearZ * pa[kz]) + e1 * (shearZ * pb[kz])
+				        + e2 * (shearZ * pc[kz]);
+				// Compare t / det against the ray interval without division
+				float signedT = det < 0.0f ? -t : t;
+				if (signedT < 0.0f || signedT > maxDistance * std::fabs(det))
+					return false;
+				if (hit)
+				{
+					float invDet = 1.0f / det;
+					hit->distance = t * invDet;
+					hit->u = e1 * invDet;
+					hit->v = e2 * invDet;
+				}
+				return true;
+			}
+			/**
+			 * Möller-Trumbore test against F::Width triangles in SoA form
+			 * (F is Float4, Float8 or SimdFloat), see intersectTriangle().
+			 * @param v0 x, y and z coordinates of the first vertices.
+			 * @param distance If not 0, receives the distances, only valid
+			 * for lanes where the triangle is hit. The same applies to u and
+			 * v.
+			 * @return Mask with bit i set if triangle i is hit.
+			 */
+			template<typename F> int intersectTriangles(const F (&v0)[3],
+			                                            const F (&v1)[3],
+			                                            const F (&v2)[3],
+			                                            float maxDistance,
+			                                            F *distance = 0,
+			                                            F *u = 0,
+			                                            F *v = 0) const
+			{
+				F edge1[3];
+				F edge2[3];
+				F s[3];
+				for (unsigned int i = 0; i < 3; i++)
+				{
+					edge1[i] = v1[i] - v0[i];
+					edge2[i] = v2[i] - v0[i];
+					s[i] = F((&origin.x)[i]) - v0[i];
+				}
+				F dx(direction.x);
+				F dy(direction.y);
+				F dz(direction.z);
+				// p = direction x edge2, q = s x edge1
+				F px = dy * edge2[2] - dz * edge2[1];
+				F py = dz * edge2[0] - dx * edge2[2];
+				F pz = dx * edge2[1] - dy * edge2[0];
+				F qx = s[1] * edge1[2] - s[2] * edge1[1];
+				F qy = s[2] * edge1[0] - s[0] * edge1[2];
+				F qz = s[0] * edge1[1] - s[1] * edge1[0];
+				F invDet = F(1.0f) / (edge1[0] * px + edge1[1] * py + edge1[2] * pz);
+				F hitU = (s[0] * px + s[1] * py + s[2] * pz) * invDet;
+				F hitV = (dx * qx + dy * qy + dz * qz) * invDet;
+				F t = (edge2[0] * qx + edge2[1] * qy + edge2[2] * qz) * invDet;
+				F zero = F::zero();
+				F hit = (hitU >= zero) & (hitV >= zero) & (hitU + hitV <= F(1.0f))
+				      & (t >= zero) & (t <= F(maxDistance));
+				if (distance)
+					*distance = t;
+				if (u)
+					*u = hitU;
+				if (v)
+					*v = hitV;
+				return hit.mask();
+			}
+			/**
+			 * Watertight test against F::Width triangles in SoA form, see
+			 * intersectTriangleWatertight() and intersectTriangles(). Edge
+			 * tests which evaluate to exactly 0 are not repeated in double
+			 * precision, so a ray which hits an edge exactly can hit both
+			 * triangles of the edge, but it never misses both.
+			 */
+			template<typename F> int intersectTrianglesWatertight(const F (&v0)[3],
+			                                                      const F (&v1)[3],
+			                                                      const F (&v2)[3],
+			                                                      float maxDistance,
+			                                                      F *distance = 0,
+			                                                      F *u = 0,
+			                                                      F *v = 0) const
+			{
+				F ox((&origin.x)[kx]);
+				F oy((&origin.x)[ky]);
+				F oz((&origin.x)[kz]);
+				F sx(shearX);
+				F sy(shearY);
+				F sz(shearZ);
+				F az = v0[kz] - oz;
+				F bz = v1[kz] - oz;
+				F cz = v2[kz] - oz;
+				F ax = (v0[kx] - ox) - sx * az;
+				F ay = (v0[ky] - oy) - sy * az;
+				F bx = (v1[kx] - ox) - sx * bz;
+				F by = (v1[ky] - oy) - sy * bz;
+				F cx = (v2[kx] - ox) - sx * cz;
+				F cy = (v2[ky] - oy) - sy * cz;
+				// The products must not be fused with the subtraction,
+				// otherwise the edge tests are not exact for shared edges
+				F e0 = mulRounded(cx, by) - mulRounded(cy, bx);
+				F e1 = mulRounded(ax, cy) - mulRounded(ay, cx);
+				F e2 = mulRounded(bx, ay) - mulRounded(by, ax);
+				F zero = F::zero();
+				F negative = (e0 < zero) | (e1 < zero) | (e2 < zero);
+				F positive = (e0 > zero) | (e1 > zero) | (e2 > zero);
+				F det = e0 + e1 + e2;
+				F t = e0 * (sz * az) + e1 * (sz * bz) + e2 * (sz * cz);
+				// Flip the sign of t if det is negative
+				F signedT = t ^ (det & F(-0.0f));
+				F hit = (det != zero) & (signedT >= zero)
+				      & (signedT <= F(maxDistance) * abs(det));
+				hit = (negative & positive).andNot(hit);
+				F invDet = F(1.0f) / det;
+				if (distance)
+					*distance = t * invDet;
+				if (u)
+					*u = e1 * invDet;
+				if (v)
+					*v = e2 * invDet;
+				return hit.mask();
+			}
+			/**
+			 * Tests the ray against an array of triangles in SoA form,
+			 * SimdFloat::Width triangles are tested at once.
+			 * @param v0 First vertices of the triangles.
+			 * @param v1 Second vertices, has to have the same size as v0.
+			 * @param v2 Third vertices, has to have the same size as v0.
+			 * @param maxDistance Length of the ray.
+			 * @param hitMask Bit mask with room for (v0.size() + 31) / 32
+			 * values. Bit i % 32 of hitMask[i / 32] is set if triangle i is
+			 * hit.
+			 * @param hits If not 0, array with room for v0.size() entries
+			 * which receives the hit information of all triangles which are
+			 * hit.
+			 * @param watertight If true, the watertight test is used.
+			 */
+			void intersectTriangles(const Vec3Streamf &v0,
+			                        const Vec3Streamf &v1,
+			                        const Vec3Streamf &v2,
+			                        float maxDistance,
+			                        uint32 *hitMask,
+			                        TriangleHit *hits = 0,
+			                        bool watertight = false) const
+			{
+				size_t count = v0.size();
+				memset(hitMask, 0, ((count + 31) / 32) * sizeof(uint32));
+				const uint32 lanemask = (1u << SimdFloat::Width) - 1;
+				for (size_t i = 0; i < count; i += SimdFloat::Width)
+				{
+					SimdFloat a[3] = {SimdFloat::load(v0.x + i),
+					                  SimdFloat::load(v0.y + i),
+					                  SimdFloat::load(v0.z + i)};
+					SimdFloat b[3] = {SimdFloat::load(v1.x + i),
+					                  SimdFloat::load(v1.y + i),
+					                  SimdFloat::load(v1.z + i)};
+					SimdFloat c[3] = {SimdFloat::load(v2.x + i),
+					                  SimdFloat::load(v2.y + i),
+					                  SimdFloat::load(v2.z + i)};
+					SimdFloat distance;
+					SimdFloat u;
+					SimdFloat v;
+					uint32 hit;
+					if (watertight)
+						hit = (uint32)intersectTrianglesWatertight(a, b, c, maxDistance, &distance, &u, &v);
+					else
+						hit = (uint32)intersectTriangles(a, b, c, maxDistance, &distance, &u, &v);
+					hit &= lanemask;
+					// Clear the bits of the padding elements
+					if (count - i < SimdFloat::Width)
+						hit &= (1u << (count - i)) - 1;
+					hitMask[i / 32] |= hit << (i % 32);
+					if (hits && hit != 0)
+					{
+						float values[3][SimdFloat::Width];
+						distance.store(values[0]);
+						u.store(values[1]);
+						v.store(values[2]);
+						for (unsigned int j = 0; j < SimdFloat::Width; j++)
+						{
+							if (hit & (1u << j))
+							{
+								hits[i + j].distance = values[0][j];
+								hits[i + j].u = values[1][j];
+								hits[i + j].v = values[2][j];
+							}
+						}
+					}
+				}
+			}
+
+			/**
+			 * Clips the ray interval [tmin, tmax] against one slab. The order
+			 * of the operands of min() and max() makes sure that the NaN of
+			 * 0 * infinity is dropped (minps/maxps return the second operand
+			 * for NaN).
+			 * @param nearPlane Side of the slab which is entered first.
+			 * @param farPlane Side of the slab which is left last.
+			 */
+			template<typename F> static void slab(const F &nearPlane,
+			                                      const F &farPlane,
+			                                      const F &origin,
+			                                      const F &invDirection,
+			                                      F &tmin,
+			                                      F &tmax)
+			{
+				tmin = max((nearPlane - origin) * invDirection, tmin);
+				tmax = min((farPlane - origin) * invDirection, tmax);
+			}
+
+			Vec3f origin;
+		private:
+			Vec3f direction;
+			Vec3f invDirection;
+			/**
+			 * Axis permutation and shear for the watertight triangle test.
+			 */
+			uint8 kx;
+			uint8 ky;
+			uint8 kz;
+			float shearX;
+			float shearY;
+			float shearZ;
+	};
+
+	/**
+	 * Packet of F::Width rays in SoA form (F is Float4, Float8 or
+	 * SimdFloat), which are tested against a box at once. This is efficient
+	 * for coherent rays such as primary rays of neighbouring pixels.
+	 */
+	template<typename F> class RayPacket
+	{
+		public:
+			static const unsigned int Width = F::Width;
+
+			RayPacket()
+			{
+			}
+			/**
+			 * Constructor.
+			 * @param rays Array of Width rays.
+			 */
+			explicit RayPacket(const Ray *rays)
+			{
+				float values[9][Width];
+				for (unsigned int i = 0; i < Width; i++)
+				{
+					values[0][i] = rays[i].origin.x;
+					values[1][i] = rays[i].origin.y;
+					values[2][i] = rays[i].origin.z;
+					values[3][i] = rays[i].getDirection().x;
+					values[4][i] = rays[i].getDirection().y;
+					values[5][i] = rays[i].getDirection().z;
+					values[6][i] = rays[i].getInverseDirection().x;
+					values[7][i] = rays[i].getInverseDirection().y;
+					values[8][i] = rays[i].getInverseDirection().z;
+				}
+				originX = F::load(values[0]);
+				originY = F::load(values[1]);
+				originZ = F::load(values[2]);
+				directionX = F::load(values[3]);
+				directionY = F::load(values[4]);
+				directionZ = F::load(values[5]);
+				invDirectionX = F::load(values[6]);
+				invDirectionY = F::load(values[7]);
+				invDirectionZ = F::load(values[8]);
+			}
+
+			/**
+			 * Tests all rays against a box.
+			 * @param box Box to test.
+			 * @param maxDistance Lengths of the rays.
+			 * @param distance If not 0, receives the entry distances, only
+			 * valid for lanes where the box is hit.
+			 * @return Mask with bit i set if ray i hits the box.
+			 */
+			int intersect(const BoundingBox &box,
+			              const F &maxDistance,
+			              F *distance = 0) const
+			{
+				F tmin = F::zero();
+				F tmax = maxDistance;
+				intersectSlab(box.minCorner.x, box.maxCorner.x, originX, invDirectionX, tmin, tmax);
+				intersectSlab(box.minCorner.y, box.maxCorner.y, originY, invDirectionY, tmin, tmax);
+				intersectSlab(box.minCorner.z, box.maxCorner.z, originZ, invDirectionZ, tmin, tmax);
+				if (distance)
+					*distance = tmin;
+				return (tmin <= tmax).mask();
+			}
+
+			F originX;
+			F originY;
+			F originZ;
+			F directionX;
+			F directionY;
+			F directionZ;
+			F invDirectionX;
+			F invDirectionY;
+			F invDirectionZ;
+		private:
+			/**
+			 * Clips the rays against one slab of the box, the side which is
+			 * entered first is selected per ray.
+			 */
+			static void intersectSlab(float boxMin,
+			                          float boxMax,
+			                          const F &origin,
+			                          const F &invDirection,
+			                          F &tmin,
+			                          F &tmax)
+			{
+				F negative = invDirection < F::zero();
+				Ray::slab(select(negative, F(boxMax), F(boxMin)),
+				          select(negative, F(boxMin), F(boxMax)),
+				          origin, invDirection, tmin, tmax);
+			}
+	};
+
+	typedef RayPacket<Float4> RayPacket4;
+	typedef RayPacket<Float8> RayPacket8;
+}
+
+#endif
@@ -0,0 +1,835 @@
+/*
+Copyright (C) 2011, Mathias Gottschlag
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef GAMEMATH_SIMD_HPP_INCLUDED
+#define GAMEMATH_SIMD_HPP_INCLUDED
+
+#include "Types.hpp"
+
+#include <cmath>
+#include <cstring>
+
+#if defined(GAMEMATH_AVX)
+	#include <immintrin.h>
+#elif defined(GAMEMATH_SSE2)
+	#include <emmintrin.h>
+#endif
+
+namespace math
+{
+	/**
+	 * Four floats which are processed in parallel. This maps to an SSE
+	 * register if SSE2 is available and falls back to plain scalar code
+	 * otherwise, so the same code can be used on all platforms.
+	 *
+	 * Comparisons return a mask which has all bits set in the lanes where the
+	 * comparison is true. Masks can be combined with the bitwise operators and
+	 * be used in select().
+	 */
+	class Float4
+	{
+	public:
+		static const unsigned int Width = 4;
+
+		/**
+		 * Constructor. The contents are undefined.
+		 */
+		Float4()
+		{
+		}
+		/**
+		 * Constructor. Sets all lanes to s.
+		 */
+		explicit Float4(float s)
+		{
+#if defined(GAMEMATH_SSE2)
+			v = _mm_set1_ps(s);
+#else
+			v[0] = v[1] = v[2] = v[3] = s;
+#endif
+		}
+		/**
+		 * Constructor.
+		 */
+		Float4(float x, float y, float z, float w)
+		{
+#if defined(GAMEMATH_SSE2)
+			v = _mm_setr_ps(x, y, z, w);
+#else
+			v[0] = x;
+			v[1] = y;
+			v[2] = z;
+			v[3] = w;
+#endif
+		}
+#if defined(GAMEMATH_SSE2)
+		Float4(__m128 v) : v(v)
+		{
+		}
+#endif
+
+		static Float4 zero()
+		{
+			return Float4(0.0f);
+		}
+		/**
+		 * Returns a mask with all bits set in all lanes.
+		 */
+		static Float4 allOnes()
+		{
+			return zero() == zero();
+		}
+
+		/**
+		 * Loads four floats from memory which does not need to be aligned.
+		 */
+		static Float4 load(const float *p)
+		{
+#if defined(GAMEMATH_SSE2)
+			return _mm_loadu_ps(p);
+#else
+			return Float4(p[0], p[1], p[2], p[3]);
+#endif
+		}
+		/**
+		 * Loads four floats from 16-byte aligned memory.
+		 */
+		static Float4 loadAligned(const float *p)
+		{
+#if defined(GAMEMATH_SSE2)
+			return _mm_load_ps(p);
+#else
+			return Float4(p[0], p[1], p[2], p[3]);
+#endif
+		}
+		/**
+		 * Stores the four floats to memory which does not need to be aligned.
+		 */
+		void store(float *p) const
+		{
+#if defined(GAMEMATH_SSE2)
+			_mm_storeu_ps(p, v);
+#else
+			for (unsigned int i = 0; i < 4; i++)
+				p[i] = v[i];
+#endif
+		}
+		/**
+		 * Stores the four floats to 16-byte aligned memory.
+		 */
+		void storeAligned(float *p) const
+		{
+#if defined(GAMEMATH_SSE2)
+			_mm_store_ps(p, v);
+#else
+			store(p);
+#endif
+		}
+
+		/**
+		 * Returns the value of a single lane. This is slow and should not be
+		 * used in inner loops.
+		 */
+		float get(unsigned int index) const
+		{
+			float values[4];
+			store(values);
+			return values[index];
+		}
+		/**
+		 * Returns a vector with all lanes set to the value of lane i.
+		 */
+		template<int i> Float4 splat() const
+		{
+#if defined(GAMEMATH_SSE2)
+			return _mm_shuffle_ps(v, v, _MM_SHUFFLE(i, i, i, i));
+#else
+			return Float4(v[i]);
+#endif
+		}
+		/**
+		 * Returns a bit mask with bit i set if the sign bit of lane i is set,
+		 * which is the case for all lanes where a comparison was true.
+		 */
+		int mask() const
+		{
+#if defined(GAMEMATH_SSE2)
+			return _mm_movemask_ps(v);
+#else
+			int result = 0;
+			for (unsigned int i = 0; i < 4; i++)
+				result |= (int)(toBits(v[i]) >> 31) << i;
+			return result;
+#endif
+		}
+		bool any() const
+		{
+			return mask() != 0;
+		}
+		bool all() const
+		{
+			return mask() == 0xf;
+		}
+
+		Float4 operator+(const Float4 &o) const
+		{
+#if defined(GAMEMATH_SSE2)
+			return _mm_add_ps(v, o.v);
+#else
+			return Float4(v[0] + o.v[0], v[1] + o.v[1],
+			              v[2] + o.v[2], v[3] + o.v[3]);
+#endif
+		}
+		Float4 operator-(const Float4 &o) const
+		{
+#if defined(GAMEMATH_SSE2)
+			return _mm_sub_ps(v, o.v);
+#else
+			return Float4(v[0] - o.v[0], v[1] - o.v[1],
+			              v[2] - o.v[2], v[3] - o.v[3]);
+#endif
+		}
+		Float4 operator*(const Float4 &o) const
+		{
+#if defined(GAMEMATH_SSE2)
+			return _mm_mul_ps(v, o.v);
+#else
+			return Float4(v[0] * o.v[0], v[1] * o.v[1],
+			              v[2] * o.v[2], v[3] * o.v[3]);
+#endif
+		}
+		Float4 operator/(const Float4 &o) const
+		{
+#if defined(GAMEMATH_SSE2)
+			return _mm_div_ps(v, o.v);
+#else
+			return Float4(v[0] / o.v[0], v[1] / o.v[1],
+			              v[2] / o.v[2], v[3] / o.v[3]);
+#endif
+		}
+		Float4 operator-() const
+		{
+			return zero() - *this;
+		}
+		Float4 &operator+=(const Float4 &o)
+		{
+			*this = *this + o;
+			return *this;
+		}
+		Float4 &operator-=(const Float4 &o)
+		{
+			*this = *this - o;
+			return *this;
+		}
+		Float4 &operator*=(const Float4 &o)
+		{
+			*this = *this * o;
+			return *this;
+		}
+		Float4 &operator/=(const Float4 &o)
+		{
+			*this = *this / o;
+			return *this;
+		}
+
+		Float4 operator&(const Float4 &o) const
+		{
+#if defined(GAMEMATH_SSE2)
+			return _mm_and_ps(v, o.v);
+#else
+			Float4 r;
+			for (unsigned int i = 0; i < 4; i++)
+				r.v[i] = fromBits(toBits(v[i]) & toBits(o.v[i]));
+			return r;
+#endif
+		}
+		Float4 operator|(const Float4 &o) const
+		{
+#if defined(GAMEMATH_SSE2)
+			return _mm_or_ps(v, o.v);
+#else
+			Float4 r;
+			for (unsigned int i = 0; i < 4; i++)
+				r.v[i] = fromBits(toBits(v[i]) | toBits(o.v[i]));
+			return r;
+#endif
+		}
+		Float4 operator^(const Float4 &o) const
+		{
+#if defined(GAMEMATH_SSE2)
+			return _mm_xor_ps(v, o.v);
+#else
+			Float4 r;
+			for (unsigned int i = 0; i < 4; i++)
+				r.v[i] = fromBits(toBits(v[i]) ^ toBits(o.v[i]));
+			return r;
+#endif
+		}
+		/**
+		 * Returns (~*this) & o.
+		 */
+		Float4 andNot(const Float4 &o) const
+		{
+#if defined(GAMEMATH_SSE2)
+			return _mm_andnot_ps(v, o.v);
+#else
+			Float4 r;
+			for (unsigned int i = 0; i < 4; i++)
+				r.v[i] = fromBits(~toBits(v[i]) & toBits(o.v[i]));
+			return r;
+#endif
+		}
+
+		Float4 operator<(const Float4 &o) const
+		{
+#if defined(GAMEMATH_SSE2)
+			return _mm_cmplt_ps(v, o.v);
+#else
+			return compare(v[0] < o.v[0], v[1] < o.v[1],
+			               v[2] < o.v[2], v[3] < o.v[3]);
+#endif
+		}
+		Float4 operator<=(const Float4 &o) const
+		{
+#if defined(GAMEMATH_SSE2)
+			return _mm_cmple_ps(v, o.v);
+#else
+			return compare(v[0] <= o.v[0], v[1] <= o.v[1],
+			               v[2] <= o.v[2], v[3] <= o.v[3]);
+#endif
+		}
+		Float4 operator>(const Float4 &o) const
+		{
+			return o < *this;
+		}
+		Float4 operator>=(const Float4 &o) const
+		{
+			return o <= *this;
+		}
+		Float4 operator==(const Float4 &o) const
+		{
+#if defined(GAMEMATH_SSE2)
+			return _mm_cmpeq_ps(v, o.v);
+#else
+			return compare(v[0] == o.v[0], v[1] == o.v[1],
+			               v[2] == o.v[2], v[3] == o.v[3]);
+#endif
+		}
+		Float4 operator!=(const Float4 &o) const
+		{
+#if defined(GAMEMATH_SSE2)
+			return _mm_cmpneq_ps(v, o.v);
+#else
+			return compare(v[0] != o.v[0], v[1] != o.v[1],
+			               v[2] != o.v[2], v[3] != o.v[3]);
+#endif
+		}
+
+		// The following functions are only found via argument-dependent
+		// lookup, so they do not hide the standard functions of the same name
+		// within the math namespace
+		friend Float4 min(const Float4 &a, const Float4 &b)
+		{
+#if defined(GAMEMATH_SSE2)
+			return _mm_min_ps(a.v, b.v);
+#else
+			// Same NaN behaviour as minps: Returns b if the comparison fails
+			return Float4(a.v[0] < b.v[0] ? a.v[0] : b.v[0],
+			              a.v[1] < b.v[1] ? a.v[1] : b.v[1],
+			              a.v[2] < b.v[2] ? a.v[2] : b.v[2],
+			              a.v[3] < b.v[3] ? a.v[3] : b.v[3]);
+#endif
+		}
+		friend Float4 max(const Float4 &a, const Float4 &b)
+		{
+#if defined(GAMEMATH_SSE2)
+			return _mm_max_ps(a.v, b.v);
+#else
+			return Float4(a.v[0] > b.v[0] ? a.v[0] : b.v[0],
+			              a.v[1] > b.v[1] ? a.v[1] : b.v[1],
+			              a.v[2] > b.v[2] ? a.v[2] : b.v[2],
+			              a.v[3] > b.v[3] ? a.v[3] : b.v[3]);
+#endif
+		}
+		friend Float4 sqrt(const Float4 &a)
+		{
+#if defined(GAMEMATH_SSE2)
+			return _mm_sqrt_ps(a.v);
+#else
+			return Float4(std::sqrt(a.v[0]), std::sqrt(a.v[1]),
+			              std::sqrt(a.v[2]), std::sqrt(a.v[3]));
+#endif
+		}
+		friend Float4 abs(const Float4 &a)
+		{
+			return Float4(-0.0f).andNot(a);
+		}
+
+#if defined(GAMEMATH_SSE2)
+		__m128 v;
+#else
+		static uint32 toBits(float f)
+		{
+			uint32 i;
+			memcpy(&i, &f, sizeof(i));
+			return i;
+		}
+		static float fromBits(uint32 i)
+		{
+			float f;
+			memcpy(&f, &i, sizeof(f));
+			return f;
+		}
+		static Float4 compare(bool a, bool b, bool c, bool d)
+		{
+			return Float4(fromBits(a ? 0xffffffff : 0),
+			              fromBits(b ? 0xffffffff : 0),
+			              fromBits(c ? 0xffffffff : 0),
+			              fromBits(d ? 0xffffffff : 0));
+		}
+
+		float v[4];
+#endif
+	};
+
+	/**
+	 * Returns the value of a for all lanes where the mask is set and the value
+	 * of b for all other lanes.
+	 */
+	inline Float4 select(const Float4 &mask, const Float4 &a, const Float4 &b)
+	{
+		return (mask & a) | mask.andNot(b);
+	}
+	/**
+	 * Returns a * b + c. This is a fused multiply-add if FMA is available, so
+	 * the result can differ from the separate operations in the last bit.
+	 */
+	inline Float4 madd(const Float4 &a, const Float4 &b, const Float4 &c)
+	{
+#if defined(GAMEMATH_FMA)
+		return _mm_fmadd_ps(a.v, b.v, c.v);
+#else
+		return a * b + c;
+#endif
+	}
+	/**
+	 * Returns a * b rounded to float precision. Unlike a plain product, the
+	 * result cannot be contracted with a following addition or subtraction
+	 * into a fused multiply-add (as GCC does with -ffp-contract=fast), which
+	 * is required by code which relies on the rounding of the individual
+	 * products.
+	 */
+	inline Float4 mulRounded(const Float4 &a, const Float4 &b)
+	{
+		Float4 product = a * b;
+#if defined(GAMEMATH_GCC)
+	#if defined(GAMEMATH_SSE2)
+		__asm__("" : "+x"(product.v));
+	#else
+		__asm__("" : "+m"(product.v));
+	#endif
+#endif
+		return product;
+	}
+	/**
+	 * Returns (a[i0], a[i1], b[i2], b[i3]).
+	 */
+	template<int i0, int i1, int i2, int i3> inline Float4 shuffle(const Float4 &a, const Float4 &b)
+	{
+#if defined(GAMEMATH_SSE2)
+		return _mm_shuffle_ps(a.v, b.v, _MM_SHUFFLE(i3, i2, i1, i0));
+#else
+		return Float4(a.v[i0], a.v[i1], b.v[i2], b.v[i3]);
+#endif
+	}
+	/**
+	 * Returns a vector with all lanes set to the sum of the lanes of a.
+	 */
+	inline Float4 horizontalAdd(const Float4 &a)
+	{
+		// (x + y) + (z + w)
+		Float4 pairs = a + shuffle<1, 0, 3, 2>(a, a);
+		return pairs + shuffle<2, 3, 0, 1>(pairs, pairs);
+	}
+	/**
+	 * Transposes the 4x4 matrix formed by the four vectors in place.
+	 */
+	inline void transpose(Float4 &r0, Float4 &r1, Float4 &r2, Float4 &r3)
+	{
+#if defined(GAMEMATH_SSE2)
+		_MM_TRANSPOSE4_PS(r0.v, r1.v, r2.v, r3.v);
+#else
+		Float4 t0(r0.v[0], r1.v[0], r2.v[0], r3.v[0]);
+		Float4 t1(r0.v[1], r1.v[1], r2.v[1], r3.v[1]);
+		Float4 t2(r0.v[2], r1.v[2], r2.v[2], r3.v[2]);
+		Float4 t3(r0.v[3], r1.v[3], r2.v[3], r3.v[3]);
+		r0 = t0;
+		r1 = t1;
+		r2 = t2;
+		r3 = t3;
+#endif
+	}
+
+	/**
+	 * Loads four packed xyz triples (12 floats) from unaligned memory and
+	 * converts them to SoA form.
+	 */
+	inline void loadInterleaved3(const float *p, Float4 &x, Float4 &y, Float4 &z)
+	{
+#if defined(GAMEMATH_SSE2)
+		__m128 a = _mm_loadu_ps(p);
+		__m128 b = _mm_loadu_ps(p + 4);
+		__m128 c = _mm_loadu_ps(p + 8);
+		__m128 t1 = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 2, 3, 0));
+		__m128 t2 = _mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 1, 2, 2));
+		x = _mm_shuffle_ps(t1, t2, _MM_SHUFFLE(2, 0, 1, 0));
+		t1 = _mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1));
+		t2 = _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 3, 3));
+		y = _mm_shuffle_ps(t1, t2, _MM_SHUFFLE(2, 0, 2, 0));
+		t1 = _mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2));
+		t2 = _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 0, 0));
+		z = _mm_shuffle_ps(t1, t2, _MM_SHUFFLE(2, 0, 2, 0));
+#else
+		x = Float4(p[0], p[3], p[6], p[9]);
+		y = Float4(p[1], p[4], p[7], p[10]);
+		z = Float4(p[2], p[5], p[8], p[11]);
+#endif
+	}
+	/**
+	 * Converts four points from SoA form to packed xyz triples and stores
+	 * them to unaligned memory.
+	 */
+	inline void storeInterleaved3(float *p, const Float4 &x, const Float4 &y, const Float4 &z)
+	{
+#if defined(GAMEMATH_SSE2)
+		__m128 t1 = _mm_shuffle_ps(x.v, y.v, _MM_SHUFFLE(0, 0, 0, 0));
+		__m128 t2 = _mm_shuffle_ps(z.v, x.v, _MM_SHUFFLE(1, 1, 0, 0));
+		_mm_storeu_ps(p, _mm_shuffle_ps(t1, t2, _MM_SHUFFLE(2, 0, 2, 0)));
+		t1 = _mm_shuffle_ps(y.v, z.v, _MM_SHUFFLE(1, 1, 1, 1));
+		t2 = _mm_shuffle_ps(x.v, y.v, _MM_SHUFFLE(2, 2, 2, 2));
+		_mm_storeu_ps(p + 4, _mm_shuffle_ps(t1, t2, _MM_SHUFFLE(2, 0, 2, 0)));
+		t1 = _mm_shuffle_ps(z.v, x.v, _MM_SHUFFLE(3, 3, 2, 2));
+		t2 = _mm_shuffle_ps(y.v, z.v, _MM_SHUFFLE(3, 3, 3, 3));
+		_mm_storeu_ps(p + 8, _mm_shuffle_ps(t1, t2, _MM_SHUFFLE(2, 0, 2, 0)));
+#else
+		for (unsigned int i = 0; i < 4; i++)
+		{
+			p[3 * i] = x.v[i];
+			p[3 * i + 1] = y.v[i];
+			p[3 * i + 2] = z.v[i];
+		}
+#endif
+	}
+
+	/**
+	 * Eight floats which are processed in parallel. This maps to an AVX
+	 * register if AVX is available and to two Float4 values otherwise.
+	 *
+	 * The interface is the same as the one of Float4, so kernels can be
+	 * written once for SimdFloat.
+	 */
+	class Float8
+	{
+	public:
+		static const unsigned int Width = 8;
+
+		Float8()
+		{
+		}
+		explicit Float8(float s)
+#if !defined(GAMEMATH_AVX)
+			: lo(s), hi(s)
+#endif
+		{
+#if defined(GAMEMATH_AVX)
+			v = _mm256_set1_ps(s);
+#endif
+		}
+		Float8(const Float4 &lo, const Float4 &hi)
+#if !defined(GAMEMATH_AVX)
+			: lo(lo), hi(hi)
+#endif
+		{
+#if defined(GAMEMATH_AVX)
+			v = _mm256_insertf128_ps(_mm256_castps128_ps256(lo.v), hi.v, 1);
+#endif
+		}
+#if defined(GAMEMATH_AVX)
+		Float8(__m256 v) : v(v)
+		{
+		}
+#endif
+
+		static Float8 zero()
+		{
+			return Float8(0.0f);
+		}
+		static Float8 allOnes()
+		{
+			return zero() == zero();
+		}
+		/**
+		 * Returns a vector which contains v in both halves.
+		 */
+		static Float8 broadcast(const Float4 &v)
+		{
+			return Float8(v, v);
+		}
+
+		static Float8 load(const float *p)
+		{
+#if defined(GAMEMATH_AVX)
+			return _mm256_loadu_ps(p);
+#else
+			return Float8(Float4::load(p), Float4::load(p + 4));
+#endif
+		}
+		/**
+		 * Loads eight floats from 32-byte aligned memory.
+		 */
+		static Float8 loadAligned(const float *p)
+		{
+#if defined(GAMEMATH_AVX)
+			return _mm256_load_ps(p);
+#else
+			return Float8(Float4::loadAligned(p), Float4::loadAligned(p + 4));
+#endif
+		}
+		void store(float *p) const
+		{
+#if defined(GAMEMATH_AVX)
+			_mm256_storeu_ps(p, v);
+#else
+			lo.store(p);
+			hi.store(p + 4);
+#endif
+		}
+		void storeAligned(float *p) const
+		{
+#if defined(GAMEMATH_AVX)
+			_mm256_store_ps(p, v);
+#else
+			lo.storeAligned(p);
+			hi.storeAligned(p + 4);
+#endif
+		}
+
+		Float4 low() const
+		{
+#if defined(GAMEMATH_AVX)
+			return _mm256_castps256_ps128(v);
+#else
+			return lo;
+#endif
+		}
+		Float4 high() const
+		{
+#if defined(GAMEMATH_AVX)
+			return _mm256_extractf128_ps(v, 1);
+#else
+			return hi;
+#endif
+		}
+		float get(unsigned int index) const
+		{
+			float values[8];
+			store(values);
+			return values[index];
+		}
+		/**
+		 * Returns a vector with all lanes of each half set to the value of
+		 * lane i of that half.
+		 */
+		template<int i> Float8 splatHalves() const
+		{
+#if defined(GAMEMATH_AVX)
+			return _mm256_shuffle_ps(v, v, _MM_SHUFFLE(i, i, i, i));
+#else
+			return Float8(lo.splat<i>(), hi.splat<i>());
+#endif
+		}
+		int mask() const
+		{
+#if defined(GAMEMATH_AVX)
+			return _mm256_movemask_ps(v);
+#else
+			return lo.mask() | (hi.mask() << 4);
+#endif
+		}
+		bool any() const
+		{
+			return mask() != 0;
+		}
+		bool all() const
+		{
+			return mask() == 0xff;
+		}
+
+#if defined(GAMEMATH_AVX)
+	#define GAMEMATH_FLOAT8_OP(op, intrinsic) \
+		Float8 operator op(const Float8 &o) const \
+		{ \
+			return intrinsic(v, o.v); \
+		}
+	#define GAMEMATH_FLOAT8_CMP(op, predicate) \
+		Float8 operator op(const Float8 &o) const \
+		{ \
+			return _mm256_cmp_ps(v, o.v, predicate); \
+		}
+#else
+	#define GAMEMATH_FLOAT8_OP(op, intrinsic) \
+		Float8 operator op(const Float8 &o) const \
+		{ \
+			return Float8(lo op o.lo, hi op o.hi); \
+		}
+	#define GAMEMATH_FLOAT8_CMP(op, predicate) GAMEMATH_FLOAT8_OP(op, 0)
+#endif
+		GAMEMATH_FLOAT8_OP(+, _mm256_add_ps)
+		GAMEMATH_FLOAT8_OP(-, _mm256_sub_ps)
+		GAMEMATH_FLOAT8_OP(*, _mm256_mul_ps)
+		GAMEMATH_FLOAT8_OP(/, _mm256_div_ps)
+		GAMEMATH_FLOAT8_OP(&, _mm256_and_ps)
+		GAMEMATH_FLOAT8_OP(|, _mm256_or_ps)
+		GAMEMATH_FLOAT8_OP(^, _mm256_xor_ps)
+		GAMEMATH_FLOAT8_CMP(<, _CMP_LT_OQ)
+		GAMEMATH_FLOAT8_CMP(<=, _CMP_LE_OQ)
+		GAMEMATH_FLOAT8_CMP(>, _CMP_GT_OQ)
+		GAMEMATH_FLOAT8_CMP(>=, _CMP_GE_OQ)
+		GAMEMATH_FLOAT8_CMP(==, _CMP_EQ_OQ)
+		GAMEMATH_FLOAT8_CMP(!=, _CMP_NEQ_UQ)
+#undef GAMEMATH_FLOAT8_OP
+#undef GAMEMATH_FLOAT8_CMP
+
+		Float8 operator-() const
+		{
+			return zero() - *this;
+		}
+		Float8 &operator+=(const Float8 &o)
+		{
+			*this = *this + o;
+			return *this;
+		}
+		Float8 &operator-=(const Float8 &o)
+		{
+			*this = *this - o;
+			return *this;
+		}
+		Float8 &operator*=(const Float8 &o)
+		{
+			*this = *this * o;
+			return *this;
+		}
+		Float8 &operator/=(const Float8 &o)
+		{
+			*this = *this / o;
+			return *this;
+		}
+		Float8 andNot(const Float8 &o) const
+		{
+#if defined(GAMEMATH_AVX)
+			return _mm256_andnot_ps(v, o.v);
+#else
+			return Float8(lo.andNot(o.lo), hi.andNot(o.hi));
+#endif
+		}
+
+		// Only found via argument-dependent lookup, see Float4
+		friend Float8 min(const Float8 &a, const Float8 &b)
+		{
+#if defined(GAMEMATH_AVX)
+			return _mm256_min_ps(a.v, b.v);
+#else
+			return Float8(min(a.lo, b.lo), min(a.hi, b.hi));
+#endif
+		}
+		friend Float8 max(const Float8 &a, const Float8 &b)
+		{
+#if defined(GAMEMATH_AVX)
+			return _mm256_max_ps(a.v, b.v);
+#else
+			return Float8(max(a.lo, b.lo), max(a.hi, b.hi));
+#endif
+		}
+		friend Float8 sqrt(const Float8 &a)
+		{
+#if defined(GAMEMATH_AVX)
+			return _mm256_sqrt_ps(a.v);
+#else
+			return Float8(sqrt(a.lo), sqrt(a.hi));
+#endif
+		}
+		friend Float8 abs(const Float8 &a)
+		{
+			return Float8(-0.0f).andNot(a);
+		}
+
+#if defined(GAMEMATH_AVX)
+		__m256 v;
+#else
+		Float4 lo;
+		Float4 hi;
+#endif
+	};
+
+	inline Float8 select(const Float8 &mask, const Float8 &a, const Float8 &b)
+	{
+#if defined(GAMEMATH_AVX)
+		return _mm256_blendv_ps(b.v, a.v, mask.v);
+#else
+		return Float8(select(mask.lo, a.lo, b.lo), select(mask.hi, a.hi, b.hi));
+#endif
+	}
+	inline Float8 madd(const Float8 &a, const Float8 &b, const Float8 &c)
+	{
+#if defined(GAMEMATH_FMA)
+		return _mm256_fmadd_ps(a.v, b.v, c.v);
+#elif defined(GAMEMATH_AVX)
+		return a * b + c;
+#else
+		return Float8(madd(a.lo, b.lo, c.lo), madd(a.hi, b.hi, c.hi));
+#endif
+	}
+	inline Float8 mulRounded(const Float8 &a, const Float8 &b)
+	{
+#if defined(GAMEMATH_AVX)
+		Float8 product = a * b;
+	#if defined(GAMEMATH_GCC)
+		__asm__("" : "+x"(product.v));
+	#endif
+		return product;
+#else
+		return Float8(mulRounded(a.lo, b.lo), mulRounded(a.hi, b.hi));
+#endif
+	}
+
+	/**
+	 * Widest float vector type available on the target. Kernels which are
+	 * written for this type run eight lanes at once if AVX is available and
+	 * four lanes otherwise.
+	 */
+#if defined(GAMEMATH_AVX)
+	typedef Float8 SimdFloat;
+#else
+	typedef Float4 SimdFloat;
+#endif
+}
+
+#endif
@@ -0,0 +1,338 @@
+/*
+Copyright (C) 2011, Mathias Gottschlag
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef GAMEMATH_SKELETON_HPP_INCLUDED
+#define GAMEMATH_SKELETON_HPP_INCLUDED
+
+#include "Mat4.hpp"
+#include "Quaternion.hpp"
+#include "Simd.hpp"
+#include "ThreadPool.hpp"
+#include "Types.hpp"
+#include "Vec3.hpp"
+
+#include <cstddef>
+#include <vector>
+
+namespace math
+{
+	/**
+	 * Bone hierarchy of an animated character, which converts local bone
+	 * poses into world and skinning matrix palettes.
+	 *
+	 * The bones are stored in an order where every parent comes before its
+	 * children, so the world matrices can be computed in one linear pass
+	 * without recursion. The local poses are passed as separate arrays of
+	 * rotations, translations and scales.
+	 */
+	class Skeleton
+	{
+		public:
+			/**
+			 * Parent index of root bones.
+			 */
+			static const uint32 NoParent = 0xffffffff;
+
+			/**
+			 * Local pose of one character together with the output
+			 * palettes, see computePalettes().
+			 */
+			struct Pose
+			{
+				const Quaternion *rotations;
+				const Vec3f *translations;
+				const Vec3f *scales;
+				/**
+				 * Transformation of the root bones, identity if 0.
+				 */
+				const Mat4f *root;
+				Mat4f *world;
+				/**
+				 * Receives the skinning matrices, not computed if 0.
+				 */
+				Mat4f *skinning;
+			};
+
+			Skeleton()
+			{
+			}
+			/**
+			 * Constructor.
+			 * @param parents Parent of every bone, either NoParent or the
+			 * index of a bone which comes before the bone.
+			 * @param inverseBindPose Inverse of the world matrix of every
+			 * bone in the bind pose, used for the skinning matrices. The
+			 * matrices have to be affine, i.e. their last row has to be
+			 * (0, 0, 0, 1), as it is ignored when they are multiplied.
+			 * @param boneCount Number of bones.
+			 */
+			Skeleton(const uint32 *parents,
+			         const Mat4f *inverseBindPose,
+			         unsigned int boneCount)
+				: parents(parents, parents + boneCount),
+				  inverseBindPose(inverseBindPose, inverseBindPose + boneCount)
+			{
+			}
+
+			unsigned int getBoneCount() const
+			{
+				return (unsigned int)parents.size();
+			}
+			uint32 getParent(unsigned int bone) const
+			{
+				return parents[bone];
+			}
+			const Mat4f &getInverseBindPose(unsigned int bone) const
+			{
+				return inverseBindPose[bone];
+			}
+
+			/**
+			 * Computes the world matrices and the skinning matrices
+			 * (world * inverse bind pose) of all bones.
+			 *
+			 * The local matrices are created four bones at a time and are
+			 * immediately combined with the world matrix of the parent, so no
+			 * intermediate arrays are written. All local matrices are assumed
+			 * to be affine, which saves a quarter of the multiplications of a
+			 * general matrix product.
+			 *
+			 * @param rotations Local rotation of every bone.
+			 * @param translations Local translation of every bone.
+			 * @param scales Local scale of every bone.
+			 * @param world Receives the world matrix of every bone.
+			 * @param skinning Receives the skinning matrix of every bone, not
+			 * computed if 0.
+			 * @param root Transformation of the root bones, identity if 0.
+			 */
+			void computePalettes(const Quaternion *rotations,
+			                     const Vec3f *translations,
+			                     const Vec3f *scales,
+			                     Mat4f *world,
+			                     Mat4f *skinning,
+			                     const Mat4f *root = 0) const
+			{
+				unsigned int boneCount = getBoneCount();
+				Mat4f local[4];
+				for (unsigned int first = 0; first < boneCount; first += 4)
+				{
+					unsigned int count = boneCount - first < 4 ? boneCount - first : 4;
+					composeLocal(rotations + first, translations + first,
+					             scales + first, local, count);
+					for (unsigned int i = 0; i < count; i++)
+					{
+						unsigned int bone = first + i;
+						uint32 parent = parents[bone];
+						if (parent != NoParent)
+							multiplyAffine(world[parent], local[i], world[bone]);
+						else if (root)
+							multiplyAffine(*root, local[i], world[bone]);
+						else
+							world[bone] = local[i];
+						if (skinning)
+						{
+							multiplyAffine(world[bone], inverseBindPose[bone],
+							               skinning[bone]);
+						}
+					}
+				}
+			}
+			void computePalettes(const Pose &pose) const
+			{
+				computePalettes(pose.rotations, pose.translations, pose.scales,
+				                pose.world, pose.skinning, pose.root);
+			}
+			/**
+			 * Multithreaded version of computePalettes() for many characters
+			 * which share the skeleton. The poses are split into ranges which
+			 * are processed in separate tasks.
+			 * @param pool Thread pool, the calling thread has to be thread 0
+			 * of the pool.
+			 * @param poses Poses of the characters.
+			 * @param poseCount Number of poses.
+			 */
+			void computePalettes(ThreadPool &pool,
+			                     const Pose *poses,
+			                     size_t poseCount) const
+			{
+				size_t taskCount = pool.getThreadCount() * 4;
+				if (taskCount > poseCount)
+					taskCount = poseCount;
+				ThreadPool::TaskGroup group;
+				for (size_t i = 0; i < taskCount; i++)
+				{
+					size_t first = poseCount * i / taskCount;
+					size_t last = poseCount * (i + 1) / taskCount;
+					pool.spawn(new PaletteTask(*this, poses + first, last - first),
+					           group, 0);
+				}
+				pool.wait(group, 0);
+			}
+
+			/**
+			 * Creates local matrices (translation * rotation * scale) from
+			 * arrays of rotations, translations and scales. Four matrices are
+			 * created at once.
+			 * @param rotations Rotations, have to be normalized.
+			 * @param translations Translations.
+			 * @param scales Scale factors along the local axes.
+			 * @param result Receives the matrices.
+			 * @param count Number of matrices.
+			 */
+			static void composeLocal(const Quaternion *rotations,
+			                         const Vec3f *translations,
+			                         const Vec3f *scales,
+			                         Mat4f *result,
+			                         size_t count)
+			{
+				Float4 zero = Float4::zero();
+				Float4 one(1.0f);
+				Float4 two(2.0f);
+				size_t simdCount = count & ~(size_t)3;
+				size_t i = 0;
+				for (; i < simdCount; i += 4)
+				{
+					Float4 qx = Float4::load(&rotations[i].x);
+					Float4 qy = Float4::load(&rotations[i + 1].x);
+					Float4 qz = Float4::load(&rotations[i + 2].x);
+					Float4 qw = Float4::load(&rotations[i + 3].x);
+					transpose(qx, qy, qz, qw);
+					Float4 tx, ty, tz;
+					loadInterleaved3(&translations[i].x, tx, ty, tz);
+					Float4 sx, sy, sz;
+					loadInterleaved3(&scales[i].x, sx, sy, sz);
+					// Same formula as Quaternion::toMatrix()
+					Float4 xx = qx * qx;
+					Float4 yy = qy * qy;
+					Float4 zz = qz * qz;
+					Float4 xy = qx * qy;
+					Float4 xz = qx * qz;
+					Float4 yz = qy * qz;
+					Float4 xw = qx * qw;
+					Float4 yw = qy * qw;
+					Float4 zw = qz * qw;
+					// Each column is computed for four bones and then
+					// transposed into the four matrices
+					Float4 r0 = (one - two * (yy + zz)) * sx;
+					Float4 r1 = two * (xy + zw) * sx;
+					Float4 r2 = two * (xz - yw) * sx;
+					Float4 r3 = zero;
+					storeColumns(r0, r1, r2, r3, result + i, 0);
+					r0 = two * (xy - zw) * sy;
+					r1 = (one - two * (xx + zz)) * sy;
+					r2 = two * (yz + xw) * sy;
+					r3 = zero;
+					storeColumns(r0, r1, r2, r3, result + i, 1);
+					r0 = two * (xz + yw) * sz;
+					r1 = two * (yz - xw) * sz;
+					r2 = (one - two * (xx + yy)) * sz;
+					r3 = zero;
+					storeColumns(r0, r1, r2, r3, result + i, 2);
+					r3 = one;
+					storeColumns(tx, ty, tz, r3, result + i, 3);
+				}
+				for (; i < count; i++)
+				{
+					const Quaternion &q = rotations[i];
+					const Vec3f &s = scales[i];
+					Mat4f &m = result[i];
+					m(0, 0) = (1.0f - 2.0f * (q.y * q.y + q.z * q.z)) * s.x;
+					m(1, 0) = 2.0f * (q.x * q.y + q.z * q.w) * s.x;
+					m(2, 0) = 2.0f * (q.x * q.z - q.y * q.w) * s.x;
+					m(3, 0) = 0.0f;
+					m(0, 1) = 2.0f * (q.x * q.y - q.z * q.w) * s.y;
+					m(1, 1) = (1.0f - 2.0f * (q.x * q.x + q.z * q.z)) * s.y;
+					m(2, 1) = 2.0f * (q.y * q.z + q.x * q.w) * s.y;
+					m(3, 1) = 0.0f;
+					m(0, 2) = 2.0f * (q.x * q.z + q.y * q.w) * s.z;
+					m(1, 2) = 2.0f * (q.y * q.z - q.x * q.w) * s.z;
+					m(2, 2) = (1.0f - 2.0f * (q.x * q.x + q.y * q.y)) * s.z;
+					m(3, 2) = 0.0f;
+					m(0, 3) = translations[i].x;
+					m(1, 3) = translations[i].y;
+					m(2, 3) = translations[i].z;
+					m(3, 3) = 1.0f;
+				}
+			}
+		private:
+			class PaletteTask : public ThreadPool::Task
+			{
+				public:
+					PaletteTask(const Skeleton &skeleton, const Pose *poses,
+					            size_t count)
+						: skeleton(skeleton), poses(poses), count(count)
+					{
+					}
+					virtual void run(ThreadPool &pool, unsigned int thread)
+					{
+						for (size_t i = 0; i < count; i++)
+							skeleton.computePalettes(poses[i]);
+					}
+				private:
+					const Skeleton &skeleton;
+					const Pose *poses;
+					size_t count;
+			};
+
+			/**
+			 * Transposes the column of four matrices which is passed as one
+			 * register per row and stores it into the matrices.
+			 */
+			static void storeColumns(Float4 &r0, Float4 &r1, Float4 &r2,
+			                         Float4 &r3, Mat4f *matrices,
+			                         unsigned int column)
+			{
+				transpose(r0, r1, r2, r3);
+				r0.store(matrices[0].m + column * 4);
+				r1.store(matrices[1].m + column * 4);
+				r2.store(matrices[2].m + column * 4);
+				r3.store(matrices[3].m + column * 4);
+			}
+			/**
+			 * Computes a * b for a matrix b with the last row (0, 0, 0, 1).
+			 * result must not be b.
+			 */
+			static void multiplyAffine(const Mat4f &a, const Mat4f &b,
+			                           Mat4f &result)
+			{
+				Float4 c0 = Float4::load(a.m);
+				Float4 c1 = Float4::load(a.m + 4);
+				Float4 c2 = Float4::load(a.m + 8);
+				Float4 c3 = Float4::load(a.m + 12);
+				for (unsigned int i = 0; i < 12; i += 4)
+				{
+					Float4 column = c0 * Float4(b.m[i]);
+					column = madd(c1, Float4(b.m[i + 1]), column);
+					column = madd(c2, Float4(b.m[i + 2]), column);
+					column.store(result.m + i);
+				}
+				Float4 column = madd(c0, Float4(b.m[12]), c3);
+				column = madd(c1, Float4(b.m[13]), column);
+				column = madd(c2, Float4(b.m[14]), column);
+				column.store(result.m + 12);
+			}
+
+			std::vector<uint32> parents;
+			std::vector<Mat4f> inverseBindPose;
+	};
+}
+
+#endif
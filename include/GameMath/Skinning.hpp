@@ -0,0 +1,244 @@
+/*
+Copyright (C) 2011, Mathias Gottschlag
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef GAMEMATH_SKINNING_HPP_INCLUDED
+#define GAMEMATH_SKINNING_HPP_INCLUDED
+
+#include "DualQuaternion.hpp"
+#include "Mat4.hpp"
+#include "Simd.hpp"
+#include "Types.hpp"
+#include "Vec3.hpp"
+
+#include <cstddef>
+
+namespace math
+{
+	/**
+	 * Deforms vertices with linear blend skinning. Every vertex is
+	 * influenced by four bones, the weighted sum of their matrices is
+	 * applied to the position and the normal of the vertex.
+	 *
+	 * Normals are transformed with the blended upper 3x3 matrix and are not
+	 * normalized, so the palette should not contain non-uniform scale.
+	 * Input and output arrays may be the same.
+	 *
+	 * @param palette Skinning matrices, see Skeleton::computePalettes().
+	 * @param boneIndices Four bone indices per vertex.
+	 * @param boneWeights Four weights per vertex which add up to 1.
+	 * @param positions Input positions.
+	 * @param outPositions Receives the deformed positions.
+	 * @param count Number of vertices.
+	 * @param normals Input normals, if 0 no normals are transformed.
+	 * @param outNormals Receives the deformed normals.
+	 */
+	inline void skinLinear(const Mat4f *palette,
+	                       const uint16 *boneIndices,
+	                       const float *boneWeights,
+	                       const Vec3f *positions,
+	                       Vec3f *outPositions,
+	                       size_t count,
+	                       const Vec3f *normals = 0,
+	                       Vec3f *outNormals = 0)
+	{
+		for (size_t i = 0; i < count; i++)
+		{
+			const uint16 *bones = boneIndices + 4 * i;
+			const float *weights = boneWeights + 4 * i;
+			// Blend the columns of the matrices, the last row is ignored
+			const float *m = palette[bones[0]].m;
+			Float4 weight(weights[0]);
+			Float4 c0 = Float4::load(m) * weight;
+			Float4 c1 = Float4::load(m + 4) * weight;
+			Float4 c2 = Float4::load(m + 8) * weight;
+			Float4 c3 = Float4::load(m + 12) * weight;
+			for (unsigned int j = 1; j < 4; j++)
+			{
+				m = palette[bones[j]].m;
+				weight = Float4(weights[j]);
+				c0 = madd(Float4::load(m), weight, c0);
+				c1 = madd(Float4::load(m + 4), weight, c1);
+				c2 = madd(Float4::load(m + 8), weight, c2);
+				c3 = madd(Float4::load(m + 12), weight, c3);
+			}
+			float result[4];
+			const Vec3f &position = positions[i];
+			Float4 transformed = madd(c0, Float4(position.x),
+			                          madd(c1, Float4(position.y),
+			                               madd(c2, Float4(position.z), c3)));
+			transformed.store(result);
+			outPositions[i] = Vec3f(result[0], result[1], result[2]);
+			if (normals)
+			{
+				const Vec3f &normal = normals[i];
+				transformed = madd(c0, Float4(normal.x),
+				                   madd(c1, Float4(normal.y),
+				                        c2 * Float4(normal.z)));
+				transformed.store(result);
+				outNormals[i] = Vec3f(result[0], result[1], result[2]);
+			}
+		}
+	}
+
+	/**
+	 * Deforms vertices with dual quaternion skinning. The four dual
+	 * quaternions influencing a vertex are blended with
+	 * DualQuaternion::blend(), which avoids the volume loss of linear blend
+	 * skinning at twisted joints. Four vertices are processed at once.
+	 *
+	 * See skinLinear() for the parameters, normals are rotated and stay
+	 * normalized.
+	 *
+	 * @param palette Normalized skinning transformations, e.g. created from
+	 * the matrices of Skeleton::computePalettes() if they contain no scale.
+	 */
+	inline void skinDualQuaternion(const DualQuaternion *palette,
+	                               const uint16 *boneIndices,
+	                               const float *boneWeights,
+	                               const Vec3f *positions,
+	                               Vec3f *outPositions,
+	                               size_t count,
+	                               const Vec3f *normals = 0,
+	                               Vec3f *outNormals = 0)
+	{
+		Float4 one(1.0f);
+		Float4 signMask(-0.0f);
+		size_t simdCount = count & ~(size_t)3;
+		size_t i = 0;
+		for (; i < simdCount; i += 4)
+		{
+			const uint16 *bones = boneIndices + 4 * i;
+			// Weights of influence j of the four vertices
+			Float4 w0 = Float4::load(boneWeights + 4 * i);
+			Float4 w1 = Float4::load(boneWeights + 4 * i + 4);
+			Float4 w2 = Float4::load(boneWeights + 4 * i + 8);
+			Float4 w3 = Float4::load(boneWeights + 4 * i + 12);
+			transpose(w0, w1, w2, w3);
+			Float4 weights[4] = {w0, w1, w2, w3};
+			// The rotations of the first influences are used to select the
+			// hemisphere
+			Float4 pivotX = Float4::load(&palette[bones[0]].real.x);
+			Float4 pivotY = Float4::load(&palette[bones[4]].real.x);
+			Float4 pivotZ = Float4::load(&palette[bones[8]].real.x);
+			Float4 pivotW = Float4::load(&palette[bones[12]].real.x);
+			transpose(pivotX, pivotY, pivotZ, pivotW);
+			Float4 rx = Float4::zero();
+			Float4 ry = Float4::zero();
+			Float4 rz = Float4::zero();
+			Float4 rw = Float4::zero();
+			Float4 dx = Float4::zero();
+			Float4 dy = Float4::zero();
+			Float4 dz = Float4::zero();
+			Float4 dw = Float4::zero();
+			for (unsigned int j = 0; j < 4; j++)
+			{
+				const DualQuaternion &q0 = palette[bones[j]];
+				const DualQuaternion &q1 = palette[bones[4 + j]];
+				const DualQuaternion &q2 = palette[bones[8 + j]];
+				const DualQuaternion &q3 = palette[bones[12 + j]];
+				Float4 qrx = Float4::load(&q0.real.x);
+				Float4 qry = Float4::load(&q1.real.x);
+				Float4 qrz = Float4::load(&q2.real.x);
+				Float4 qrw = Float4::load(&q3.real.x);
+				transpose(qrx, qry, qrz, qrw);
+				Float4 qdx = Float4::load(&q0.dual.x);
+				Float4 qdy = Float4::load(&q1.dual.x);
+				Float4 qdz = Float4::load(&q2.dual.x);
+				Float4 qdw = Float4::load(&q3.dual.x);
+				transpose(qdx, qdy, qdz, qdw);
+				Float4 weight = weights[j];
+				// Negate the weight if the rotation is in the other
+				// hemisphere
+				Float4 cosAngle = pivotX * qrx + pivotY * qry + pivotZ * qrz
+				                + pivotW * qrw;
+				weight = weight ^ (cosAngle & signMask);
+				rx = madd(qrx, weight, rx);
+				ry = madd(qry, weight, ry);
+				rz = madd(qrz, weight, rz);
+				rw = madd(qrw, weight, rw);
+				dx = madd(qdx, weight, dx);
+				dy = madd(qdy, weight, dy);
+				dz = madd(qdz, weight, dz);
+				dw = madd(qdw, weight, dw);
+			}
+			Float4 invLength = one / sqrt(rx * rx + ry * ry + rz * rz + rw * rw);
+			rx = rx * invLength;
+			ry = ry * invLength;
+			rz = rz * invLength;
+			rw = rw * invLength;
+			dx = dx * invLength;
+			dy = dy * invLength;
+			dz = dz * invLength;
+			dw = dw * invLength;
+			// Translation, see DualQuaternion::getTranslation(). The part of
+			// the dual quaternion which is parallel to the real part cancels
+			// out, so it does not have to be removed.
+			Float4 tx = rw * dx - dw * rx + (ry * dz - rz * dy);
+			Float4 ty = rw * dy - dw * ry + (rz * dx - rx * dz);
+			Float4 tz = rw * dz - dw * rz + (rx * dy - ry * dx);
+			tx = tx + tx;
+			ty = ty + ty;
+			tz = tz + tz;
+			// Rotation, see Quaternion::rotate()
+			Float4 px, py, pz;
+			loadInterleaved3(&positions[i].x, px, py, pz);
+			Float4 ux = ry * pz - rz * py;
+			Float4 uy = rz * px - rx * pz;
+			Float4 uz = rx * py - ry * px;
+			ux = ux + ux;
+			uy = uy + uy;
+			uz = uz + uz;
+			px = px + rw * ux + (ry * uz - rz * uy) + tx;
+			py = py + rw * uy + (rz * ux - rx * uz) + ty;
+			pz = pz + rw * uz + (rx * uy - ry * ux) + tz;
+			storeInterleaved3(&outPositions[i].x, px, py, pz);
+			if (normals)
+			{
+				Float4 nx, ny, nz;
+				loadInterleaved3(&normals[i].x, nx, ny, nz);
+				ux = ry * nz - rz * ny;
+				uy = rz * nx - rx * nz;
+				uz = rx * ny - ry * nx;
+				ux = ux + ux;
+				uy = uy + uy;
+				uz = uz + uz;
+				nx = nx + rw * ux + (ry * uz - rz * uy);
+				ny = ny + rw * uy + (rz * ux - rx * uz);
+				nz = nz + rw * uz + (rx * uy - ry * ux);
+				storeInterleaved3(&outNormals[i].x, nx, ny, nz);
+			}
+		}
+		for (; i < count; i++)
+		{
+			const uint16 *bones = boneIndices + 4 * i;
+			DualQuaternion influences[4];
+			for (unsigned int j = 0; j < 4; j++)
+				influences[j] = palette[bones[j]];
+			DualQuaternion blended = DualQuaternion::blend(influences,
+				boneWeights + 4 * i, 4);
+			outPositions[i] = blended.transformPoint(positions[i]);
+			if (normals)
+				outNormals[i] = blended.real.rotate(normals[i]);
+		}
+	}
+}
+
+#endif
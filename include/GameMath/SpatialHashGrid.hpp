@@ -0,0 +1,429 @@
+/*
+Copyright (C) 2011, Mathias Gottschlag
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef GAMEMATH_SPATIALHASHGRID_HPP_INCLUDED
+#define GAMEMATH_SPATIALHASHGRID_HPP_INCLUDED
+
+#include "BoundingBox.hpp"
+#include "ThreadPool.hpp"
+#include "Types.hpp"
+#include "Vec3.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+namespace math
+{
+	/**
+	 * Uniform grid for broad-phase collision detection.
+	 *
+	 * Every object is inserted into all cells its bounding box touches. Only
+	 * cells which contain objects are stored, in a hash table with open
+	 * addressing (linear probing) which is indexed by the integer cell
+	 * coordinates. The objects of a cell are stored as a linked list in a
+	 * single entry array.
+	 *
+	 * The grid works best if the cell size is slightly larger than the
+	 * typical object, as large objects are inserted into many cells. The
+	 * grid is usually rebuilt every frame with clear() and insert().
+	 */
+	class SpatialHashGrid
+	{
+		public:
+			/**
+			 * Pair of overlapping objects, first is always smaller than
+			 * second.
+			 */
+			struct Pair
+			{
+				uint32 first;
+				uint32 second;
+
+				bool operator==(const Pair &other) const
+				{
+					return first == other.first && second == other.second;
+				}
+				bool operator<(const Pair &other) const
+				{
+					return first < other.first
+					    || (first == other.first && second < other.second);
+				}
+			};
+
+			/**
+			 * Constructor.
+			 * @param cellSize Edge length of the cubic cells.
+			 */
+			explicit SpatialHashGrid(float cellSize)
+				: invCellSize(1.0f / cellSize), usedSlots(0)
+			{
+				slots.resize(MinCapacity);
+				clearSlots();
+			}
+
+			/**
+			 * Removes all objects. The memory of the hash table is kept.
+			 */
+			void clear()
+			{
+				boxes.clear();
+				minCells.clear();
+				entries.clear();
+				clearSlots();
+			}
+			/**
+			 * Inserts an object.
+			 * @param box Bounding box of the object.
+			 * @return Index of the object, objects are numbered in the order
+			 * of insertion.
+			 */
+			uint32 insert(const BoundingBox &box)
+			{
+				Vec3i minCell;
+				Vec3i maxCell;
+				getCellRange(box, minCell, maxCell);
+				reserveSlots(usedSlots + getCellCount(minCell, maxCell));
+				return add(box, minCell, maxCell);
+			}
+			/**
+			 * Inserts an array of objects. The number of cells is computed
+			 * first, so that the hash table is resized at most once.
+			 * @param boxes Bounding boxes of the objects, which get
+			 * consecutive indices.
+			 * @param count Number of objects.
+			 */
+			void insert(const BoundingBox *boxes, size_t count)
+			{
+				size_t cellCount = 0;
+				for (size_t i = 0; i < count; i++)
+				{
+					Vec3i minCell;
+					Vec3i maxCell;
+					getCellRange(boxes[i], minCell, maxCell);
+					cellCount += getCellCount(minCell, maxCell);
+				}
+				reserveSlots(usedSlots + cellCount);
+				entries.reserve(entries.size() + cellCount);
+				this->boxes.reserve(this->boxes.size() + count);
+				minCells.reserve(minCells.size() + count);
+				for (size_t i = 0; i < count; i++)
+				{
+					Vec3i minCell;
+					Vec3i maxCell;
+					getCellRange(boxes[i], minCell, maxCell);
+					add(boxes[i], minCell, maxCell);
+				}
+			}
+
+			/**
+			 * Returns the cell which contains a point.
+			 */
+			Vec3i getCell(const Vec3f &point) const
+			{
+				return Vec3i((int)std::floor(point.x * invCellSize),
+				             (int)std::floor(point.y * invCellSize),
+				             (int)std::floor(point.z * invCellSize));
+			}
+			size_t getObjectCount() const
+			{
+				return boxes.size();
+			}
+			/**
+			 * Returns the number of cells which contain at least one object.
+			 */
+			size_t getCellCount() const
+			{
+				return usedSlots;
+			}
+
+			/**
+			 * Appends the indices of all objects whose boxes overlap the
+			 * given box to result. Every object is only reported once.
+			 * @return Number of objects found.
+			 */
+			size_t query(const BoundingBox &box, std::vector<uint32> &result) const
+			{
+				size_t oldSize = result.size();
+				Vec3i minCell;
+				Vec3i maxCell;
+				getCellRange(box, minCell, maxCell);
+				Vec3i cell;
+				for (cell.z = minCell.z; cell.z <= maxCell.z; cell.z++)
+				{
+					for (cell.y = minCell.y; cell.y <= maxCell.y; cell.y++)
+					{
+						for (cell.x = minCell.x; cell.x <= maxCell.x; cell.x++)
+						{
+							uint32 slot = findSlot(cell);
+							if (slot == Invalid)
+								continue;
+							for (uint32 i = slots[slot].first; i != Invalid; i = entries[i].next)
+							{
+								uint32 object = entries[i].object;
+								if (isFirstSharedCell(cell, minCell, minCells[object])
+								 && boxes[object].overlap(box))
+									result.push_back(object);
+							}
+						}
+					}
+				}
+				return result.size() - oldSize;
+			}
+			/**
+			 * Appends all pairs of objects with overlapping boxes to pairs.
+			 * Every pair is reported once, even if the objects share
+			 * multiple cells: a pair is only reported in the shared cell
+			 * with the smallest coordinates.
+			 * @return Number of pairs found.
+			 */
+			size_t findPairs(std::vector<Pair> &pairs) const
+			{
+				size_t oldSize = pairs.size();
+				std::vector<uint32> cellObjects;
+				findPairs(0, slots.size(), pairs, cellObjects);
+				return pairs.size() - oldSize;
+			}
+			/**
+			 * Multithreaded version of findPairs(). The hash table is split
+			 * into ranges of cells which are processed in separate tasks,
+			 * the result is the same as the one of the single-threaded
+			 * version.
+			 * @param pool Thread pool, the calling thread has to be thread 0
+			 * of the pool.
+			 */
+			size_t findPairs(ThreadPool &pool, std::vector<Pair> &pairs) const
+			{
+				size_t oldSize = pairs.size();
+				size_t taskCount = pool.getThreadCount() * 4;
+				std::vector<std::vector<Pair> > taskPairs(taskCount);
+				ThreadPool::TaskGroup group;
+				for (size_t i = 0; i < taskCount; i++)
+				{
+					size_t first = slots.size() * i / taskCount;
+					size_t last = slots.size() * (i + 1) / taskCount;
+					pool.spawn(new PairTask(*this, first, last, taskPairs[i]), group, 0);
+				}
+				pool.wait(group, 0);
+				size_t count = 0;
+				for (size_t i = 0; i < taskCount; i++)
+					count += taskPairs[i].size();
+				pairs.reserve(oldSize + count);
+				for (size_t i = 0; i < taskCount; i++)
+					pairs.insert(pairs.end(), taskPairs[i].begin(), taskPairs[i].end());
+				return count;
+			}
+		private:
+			static const uint32 Invalid = 0xffffffff;
+			static const size_t MinCapacity = 64;
+
+			/**
+			 * Hash table slot for a cell. Empty slots have first == Invalid.
+			 */
+			struct Slot
+			{
+				Vec3i cell;
+				uint32 first;
+			};
+			/**
+			 * Entry of the list of objects of a cell.
+			 */
+			struct Entry
+			{
+				uint32 object;
+				uint32 next;
+			};
+
+			class PairTask : public ThreadPool::Task
+			{
+				public:
+					PairTask(const SpatialHashGrid &grid, size_t firstSlot,
+					         size_t lastSlot, std::vector<Pair> &pairs)
+						: grid(grid), firstSlot(firstSlot), lastSlot(lastSlot),
+						  pairs(pairs)
+					{
+					}
+					virtual void run(ThreadPool &pool, unsigned int thread)
+					{
+						std::vector<uint32> cellObjects;
+						grid.findPairs(firstSlot, lastSlot, pairs, cellObjects);
+					}
+				private:
+					const SpatialHashGrid &grid;
+					size_t firstSlot;
+					size_t lastSlot;
+					std::vector<Pair> &pairs;
+			};
+
+			void getCellRange(const BoundingBox &box, Vec3i &minCell, Vec3i &maxCell) const
+			{
+				minCell = getCell(box.minCorner);
+				maxCell = getCell(box.maxCorner);
+			}
+			static size_t getCellCount(const Vec3i &minCell, const Vec3i &maxCell)
+			{
+				return (size_t)(maxCell.x - minCell.x + 1)
+				     * (size_t)(maxCell.y - minCell.y + 1)
+				     * (size_t)(maxCell.z - minCell.z + 1);
+			}
+			/**
+			 * Returns whether cell is the shared cell with the smallest
+			 * coordinates of two cell ranges which both contain cell.
+			 */
+			static bool isFirstSharedCell(const Vec3i &cell,
+			                              const Vec3i &minCell1,
+			                              const Vec3i &minCell2)
+			{
+				return cell.x == std::max(minCell1.x, minCell2.x)
+				    && cell.y == std::max(minCell1.y, minCell2.y)
+				    && cell.z == std::max(minCell1.z, minCell2.z);
+			}
+			static uint32 hash(const Vec3i &cell)
+			{
+				uint32 h = (uint32)cell.x * 73856093u
+				         ^ (uint32)cell.y * 19349663u
+				         ^ (uint32)cell.z * 83492791u;
+				// The low bits are used as index, mix in the high bits
+				h ^= h >> 16;
+				h *= 0x85ebca6bu;
+				h ^= h >> 13;
+				return h;
+			}
+
+			void clearSlots()
+			{
+				for (size_t i = 0; i < slots.size(); i++)
+					slots[i].first = Invalid;
+				usedSlots = 0;
+			}
+			uint32 findSlot(const Vec3i &cell) const
+			{
+				size_t mask = slots.size() - 1;
+				for (size_t i = hash(cell) & mask; ; i = (i + 1) & mask)
+				{
+					if (slots[i].first == Invalid)
+						return Invalid;
+					if (slots[i].cell == cell)
+						return (uint32)i;
+				}
+			}
+			/**
+			 * Makes sure that the table can hold slotCount cells while being
+			 * at most half full.
+			 */
+			void reserveSlots(size_t slotCount)
+			{
+				size_t capacity = slots.size();
+				while (capacity < slotCount * 2)
+					capacity *= 2;
+				if (capacity == slots.size())
+					return;
+				std::vector<Slot> oldSlots(capacity);
+				oldSlots.swap(slots);
+				size_t mask = capacity - 1;
+				for (size_t i = 0; i < capacity; i++)
+					slots[i].first = Invalid;
+				for (size_t i = 0; i < oldSlots.size(); i++)
+				{
+					if (oldSlots[i].first == Invalid)
+						continue;
+					size_t j = hash(oldSlots[i].cell) & mask;
+					while (slots[j].first != Invalid)
+						j = (j + 1) & mask;
+					slots[j] = oldSlots[i];
+				}
+			}
+			uint32 add(const BoundingBox &box, const Vec3i &minCell, const Vec3i &maxCell)
+			{
+				uint32 object = (uint32)boxes.size();
+				boxes.push_back(box);
+				minCells.push_back(minCell);
+				size_t mask = slots.size() - 1;
+				Vec3i cell;
+				for (cell.z = minCell.z; cell.z <= maxCell.z; cell.z++)
+				{
+					for (cell.y = minCell.y; cell.y <= maxCell.y; cell.y++)
+					{
+						for (cell.x = minCell.x; cell.x <= maxCell.x; cell.x++)
+						{
+							size_t i = hash(cell) & mask;
+							while (slots[i].first != Invalid && !(slots[i].cell == cell))
+								i = (i + 1) & mask;
+							if (slots[i].first == Invalid)
+							{
+								slots[i].cell = cell;
+								usedSlots++;
+							}
+							Entry entry = {object, slots[i].first};
+							slots[i].first = (uint32)entries.size();
+							entries.push_back(entry);
+						}
+					}
+				}
+				return object;
+			}
+			void findPairs(size_t firstSlot,
+			               size_t lastSlot,
+			               std::vector<Pair> &pairs,
+			               std::vector<uint32> &cellObjects) const
+			{
+				for (size_t slot = firstSlot; slot < lastSlot; slot++)
+				{
+					if (slots[slot].first == Invalid)
+						continue;
+					const Vec3i &cell = slots[slot].cell;
+					cellObjects.clear();
+					for (uint32 i = slots[slot].first; i != Invalid; i = entries[i].next)
+						cellObjects.push_back(entries[i].object);
+					// The list is in reverse order of insertion
+					for (size_t i = cellObjects.size(); i-- > 0;)
+					{
+						uint32 a = cellObjects[i];
+						const BoundingBox &boxA = boxes[a];
+						const Vec3i &minCellA = minCells[a];
+						for (size_t j = i; j-- > 0;)
+						{
+							uint32 b = cellObjects[j];
+							if (isFirstSharedCell(cell, minCellA, minCells[b])
+							 && boxA.overlap(boxes[b]))
+							{
+								Pair pair = {a, b};
+								pairs.push_back(pair);
+							}
+						}
+					}
+				}
+			}
+
+			float invCellSize;
+			std::vector<BoundingBox> boxes;
+			/**
+			 * Cell which contains the minimum corner of each object.
+			 */
+			std::vector<Vec3i> minCells;
+			std::vector<Slot> slots;
+			size_t usedSlots;
+			std::vector<Entry> entries;
+	};
+}
+
+#endif
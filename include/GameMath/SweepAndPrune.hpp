@@ -0,0 +1,371 @@
+/*
+Copyright (C) 2011, Mathias Gottschlag
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef GAMEMATH_SWEEPANDPRUNE_HPP_INCLUDED
+#define GAMEMATH_SWEEPANDPRUNE_HPP_INCLUDED
+
+#include "BoundingBox.hpp"
+#include "SpatialHashGrid.hpp"
+#include "Types.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <vector>
+
+namespace math
+{
+	/**
+	 * Sweep-and-prune broad-phase collision detection.
+	 *
+	 * The minimum and maximum coordinates of all boxes along one axis (the
+	 * endpoints) are kept in a persistent sorted array. As objects usually
+	 * move only a little between two frames, the array is nearly sorted
+	 * and insertion sort updates it in close to linear time. A sweep over
+	 * the array then finds all pairs of objects which overlap along the axis
+	 * and tests them on the other two axes.
+	 *
+	 * The sweep axis is the axis along which the centers of the boxes have
+	 * the largest variance, as this minimizes the number of pairs which
+	 * only overlap along the sweep axis.
+	 *
+	 * Changes are applied with update(), which also computes the pairs which
+	 * started or stopped overlapping since the last call, so that the
+	 * narrow phase only has to process the changes.
+	 */
+	class SweepAndPrune
+	{
+		public:
+			typedef SpatialHashGrid::Pair Pair;
+
+			SweepAndPrune()
+				: axis(0)
+			{
+			}
+
+			/**
+			 * Adds an object. The object is included in the pairs after the
+			 * next call to update().
+			 * @param box Bounding box of the object.
+			 * @return Handle of the object.
+			 */
+			uint32 insert(const BoundingBox &box)
+			{
+				uint32 object;
+				if (!freeObjects.empty())
+				{
+					object = freeObjects.back();
+					freeObjects.pop_back();
+					boxes[object] = box;
+					alive[object] = true;
+				}
+				else
+				{
+					object = (uint32)boxes.size();
+					boxes.push_back(box);
+					alive.push_back(true);
+					activePositions.push_back(0);
+				}
+				newEndpoints.push_back(Endpoint(getMin(box), object, false));
+				newEndpoints.push_back(Endpoint(getMax(box), object, true));
+				return object;
+			}
+			/**
+			 * Removes an object. Its pairs are reported as removed during the
+			 * next call to update(), the handle is reused after that.
+			 */
+			void remove(uint32 object)
+			{
+				alive[object] = false;
+				removedObjects.push_back(object);
+			}
+			/**
+			 * Changes the bounding box of an object. The change is applied
+			 * during the next call to update().
+			 */
+			void setBounds(uint32 object, const BoundingBox &box)
+			{
+				boxes[object] = box;
+			}
+			const BoundingBox &getBounds(uint32 object) const
+			{
+				return boxes[object];
+			}
+
+			/**
+			 * Sorts the endpoints and recomputes the overlapping pairs.
+			 * Afterwards, getAddedPairs() and getRemovedPairs() contain the
+			 * differences to the pairs of the last call.
+			 */
+			void update()
+			{
+				// Remove the endpoints of removed objects
+				if (!removedObjects.empty())
+				{
+					size_t count = 0;
+					for (size_t i = 0; i < endpoints.size(); i++)
+					{
+						if (alive[endpoints[i].getObject()])
+							endpoints[count++] = endpoints[i];
+					}
+					endpoints.resize(count);
+					count = 0;
+					for (size_t i = 0; i < newEndpoints.size(); i++)
+					{
+						if (alive[newEndpoints[i].getObject()])
+							newEndpoints[count++] = newEndpoints[i];
+					}
+					newEndpoints.resize(count);
+				}
+				bool axisChanged = selectAxis();
+				// Update the values of the endpoints, the array is usually
+				// nearly sorted afterwards
+				for (size_t i = 0; i < endpoints.size(); i++)
+				{
+					const BoundingBox &box = boxes[endpoints[i].getObject()];
+					endpoints[i].value = endpoints[i].isMax() ? getMax(box) : getMin(box);
+				}
+				if (axisChanged)
+					std::sort(endpoints.begin(), endpoints.end());
+				else
+					insertionSort();
+				// New objects are sorted separately and then merged
+				if (!newEndpoints.empty())
+				{
+					for (size_t i = 0; i < newEndpoints.size(); i++)
+					{
+						const BoundingBox &box = boxes[newEndpoints[i].getObject()];
+						newEndpoints[i].value = newEndpoints[i].isMax() ? getMax(box) : getMin(box);
+					}
+					std::sort(newEndpoints.begin(), newEndpoints.end());
+					size_t oldSize = endpoints.size();
+					endpoints.insert(endpoints.end(), newEndpoints.begin(), newEndpoints.end());
+					std::inplace_merge(endpoints.begin(), endpoints.begin() + oldSize,
+					                   endpoints.end());
+					newEndpoints.clear();
+				}
+				// Compute the new pairs and the differences to the old pairs
+				previousPairs.swap(pairs);
+				sweep();
+				addedPairs.clear();
+				removedPairs.clear();
+				std::set_difference(pairs.begin(), pairs.end(),
+				                    previousPairs.begin(), previousPairs.end(),
+				                    std::back_inserter(addedPairs));
+				std::set_difference(previousPairs.begin(), previousPairs.end(),
+				                    pairs.begin(), pairs.end(),
+				                    std::back_inserter(removedPairs));
+				freeObjects.insert(freeObjects.end(), removedObjects.begin(),
+				                   removedObjects.end());
+				removedObjects.clear();
+			}
+
+			/**
+			 * Returns all overlapping pairs as of the last call to update(),
+			 * sorted by the handles of the objects.
+			 */
+			const std::vector<Pair> &getPairs() const
+			{
+				return pairs;
+			}
+			/**
+			 * Returns the pairs which started overlapping during the last
+			 * call to update().
+			 */
+			const std::vector<Pair> &getAddedPairs() const
+			{
+				return addedPairs;
+			}
+			/**
+			 * Returns the pairs which stopped overlapping (or whose objects
+			 * were removed) during the last call to update().
+			 */
+			const std::vector<Pair> &getRemovedPairs() const
+			{
+				return removedPairs;
+			}
+			/**
+			 * Returns the current sweep axis (0 = x, 1 = y, 2 = z).
+			 */
+			unsigned int getSweepAxis() const
+			{
+				return axis;
+			}
+		private:
+			/**
+			 * Minimum or maximum coordinate of a box along the sweep axis.
+			 * Minimum endpoints are sorted in front of maximum endpoints with
+			 * the same value, so that touching boxes overlap.
+			 */
+			struct Endpoint
+			{
+				Endpoint()
+				{
+				}
+				Endpoint(float value, uint32 object, bool isMax)
+					: value(value), data((object << 1) | (isMax ? 1 : 0))
+				{
+				}
+
+				uint32 getObject() const
+				{
+					return data >> 1;
+				}
+				bool isMax() const
+				{
+					return (data & 1) != 0;
+				}
+				bool operator<(const Endpoint &other) const
+				{
+					return value < other.value
+					    || (value == other.value && (data & 1) < (other.data & 1));
+				}
+
+				float value;
+				uint32 data;
+			};
+
+			float getMin(const BoundingBox &box) const
+			{
+				return (&box.minCorner.x)[axis];
+			}
+			float getMax(const BoundingBox &box) const
+			{
+				return (&box.maxCorner.x)[axis];
+			}
+
+			/**
+			 * Selects the axis with the largest variance of the box centers.
+			 * The axis is only changed if the variance is significantly
+			 * larger than along the current axis, so that the endpoints do
+			 * not have to be sorted again whenever two axes are similar.
+			 * @return True if the axis was changed.
+			 */
+			bool selectAxis()
+			{
+				double sum[3] = {0, 0, 0};
+				double sumSq[3] = {0, 0, 0};
+				size_t count = 0;
+				for (size_t i = 0; i < boxes.size(); i++)
+				{
+					if (!alive[i])
+						continue;
+					Vec3f center = boxes[i].getCenter();
+					for (unsigned int j = 0; j < 3; j++)
+					{
+						double c = (&center.x)[j];
+						sum[j] += c;
+						sumSq[j] += c * c;
+					}
+					count++;
+				}
+				if (count == 0)
+					return false;
+				double variance[3];
+				for (unsigned int j = 0; j < 3; j++)
+					variance[j] = sumSq[j] / count - (sum[j] / count) * (sum[j] / count);
+				unsigned int best = axis;
+				for (unsigned int j = 0; j < 3; j++)
+				{
+					if (variance[j] > variance[best] * 1.5)
+						best = j;
+				}
+				if (best == axis)
+					return false;
+				axis = best;
+				return true;
+			}
+			void insertionSort()
+			{
+				for (size_t i = 1; i < endpoints.size(); i++)
+				{
+					Endpoint endpoint = endpoints[i];
+					size_t j = i;
+					while (j > 0 && endpoint < endpoints[j - 1])
+					{
+						endpoints[j] = endpoints[j - 1];
+						j--;
+					}
+					endpoints[j] = endpoint;
+				}
+			}
+			/**
+			 * Sweeps over the sorted endpoints and collects the overlapping
+			 * pairs.
+			 */
+			void sweep()
+			{
+				pairs.clear();
+				active.clear();
+				for (size_t i = 0; i < endpoints.size(); i++)
+				{
+					uint32 object = endpoints[i].getObject();
+					if (endpoints[i].isMax())
+					{
+						// Remove the object from the active list
+						uint32 position = activePositions[object];
+						active[position] = active.back();
+						activePositions[active[position]] = position;
+						active.pop_back();
+						continue;
+					}
+					const BoundingBox &box = boxes[object];
+					for (size_t j = 0; j < active.size(); j++)
+					{
+						uint32 other = active[j];
+						if (box.overlap(boxes[other]))
+						{
+							Pair pair = {std::min(object, other), std::max(object, other)};
+							pairs.push_back(pair);
+						}
+					}
+					activePositions[object] = (uint32)active.size();
+					active.push_back(object);
+				}
+				std::sort(pairs.begin(), pairs.end());
+			}
+
+			unsigned int axis;
+			std::vector<BoundingBox> boxes;
+			std::vector<bool> alive;
+			std::vector<uint32> freeObjects;
+			/**
+			 * Objects which were removed since the last update(), their
+			 * handles must not be reused before their pairs are reported as
+			 * removed.
+			 */
+			std::vector<uint32> removedObjects;
+			std::vector<Endpoint> endpoints;
+			/**
+			 * Endpoints of objects which were inserted since the last
+			 * update().
+			 */
+			std::vector<Endpoint> newEndpoints;
+			std::vector<uint32> active;
+			std::vector<uint32> activePositions;
+			std::vector<Pair> pairs;
+			std::vector<Pair> previousPairs;
+			std::vector<Pair> addedPairs;
+			std::vector<Pair> removedPairs;
+	};
+}
+
+#endif
@@ -0,0 +1,454 @@
+/*
+Copyright (C) 2011, Mathias Gottschlag
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef GAMEMATH_THREADPOOL_HPP_INCLUDED
+#define GAMEMATH_THREADPOOL_HPP_INCLUDED
+
+#include "Platform.hpp"
+
+#include <deque>
+#include <vector>
+
+#if defined(GAMEMATH_WINDOWS)
+	#if !defined(NOMINMAX)
+		#define NOMINMAX
+	#endif
+	#include <windows.h>
+	#include <intrin.h>
+#else
+	#include <pthread.h>
+	#include <sched.h>
+	#include <unistd.h>
+#endif
+
+namespace math
+{
+	/**
+	 * Integer which can be modified by multiple threads at once.
+	 */
+	class AtomicCounter
+	{
+		public:
+			AtomicCounter(int value = 0)
+				: value(value)
+			{
+			}
+
+			/**
+			 * Adds delta to the value.
+			 * @return New value.
+			 */
+			int add(int delta)
+			{
+#if defined(GAMEMATH_MSVC)
+				return (int)_InterlockedExchangeAdd(&value, delta) + delta;
+#else
+				return __sync_add_and_fetch(&value, delta);
+#endif
+			}
+			int get()
+			{
+				return add(0);
+			}
+		private:
+#if defined(GAMEMATH_MSVC)
+			volatile long value;
+#else
+			volatile int value;
+#endif
+	};
+
+	/**
+	 * Small thread pool for fork-join parallelism.
+	 *
+	 * Every thread has its own task queue. Tasks spawned by a thread are
+	 * added to the back of its queue and are taken from there again by the
+	 * same thread, idle threads steal tasks from the front of the queues of
+	 * other threads (which for recursively split work are the largest
+	 * ones).
+	 *
+	 * The thread which created the pool has the index 0 and takes part in
+	 * executing tasks while it waits for a task group, so the pool only
+	 * creates getThreadCount() - 1 additional threads. The pool must only be
+	 * used by one external thread at a time.
+	 */
+	class ThreadPool
+	{
+		public:
+			/**
+			 * Unit of work which is executed by the pool.
+			 */
+			class Task
+			{
+				public:
+					virtual ~Task()
+					{
+					}
+					/**
+					 * Executes the task.
+					 * @param pool Thread pool, can be used to spawn more tasks.
+					 * @param thread Index of the executing thread, has to be
+					 * passed to ThreadPool::spawn() and ThreadPool::wait().
+					 */
+					virtual void run(ThreadPool &pool, unsigned int thread) = 0;
+			};
+			/**
+			 * Set of tasks which can be waited for.
+			 */
+			class TaskGroup
+			{
+				public:
+					TaskGroup()
+						: pending(0)
+					{
+					}
+				private:
+					friend class ThreadPool;
+					AtomicCounter pending;
+			};
+
+			/**
+			 * Constructor.
+			 * @param threadCount Number of threads including the calling
+			 * thread. If 0, one thread per processor is used.
+			 */
+			explicit ThreadPool(unsigned int threadCount = 0)
+				: stop(false), queuedTasks(0)
+			{
+				if (threadCount == 0)
+					threadCount = getProcessorCount();
+				queues.resize(threadCount);
+				for (unsigned int i = 0; i < threadCount; i++)
+					queues[i] = new Queue;
+				createSync();
+				threads.resize(threadCount - 1);
+				workerParams.resize(threadCount - 1);
+				for (unsigned int i = 1; i < threadCount; i++)
+				{
+					workerParams[i - 1].pool = this;
+					workerParams[i - 1].thread = i;
+#if defined(GAMEMATH_WINDOWS)
+					threads[i - 1] = CreateThread(0, 0, workerEntry, &workerParams[i - 1], 0, 0);
+#else
+					pthread_create(&threads[i - 1], 0, workerEntry, &workerParams[i - 1]);
+#endif
+				}
+			}
+			~ThreadPool()
+			{
+				lockSleep();
+				stop = true;
+				wakeAll();
+				unlockSleep();
+				for (unsigned int i = 0; i < threads.size(); i++)
+				{
+#if defined(GAMEMATH_WINDOWS)
+					WaitForSingleObject(threads[i], INFINITE);
+					CloseHandle(threads[i]);
+#else
+					pthread_join(threads[i], 0);
+#endif
+				}
+				destroySync();
+				for (unsigned int i = 0; i < queues.size(); i++)
+					delete queues[i];
+			}
+
+			/**
+			 * Returns the number of threads including the thread which
+			 * created the pool.
+			 */
+			unsigned int getThreadCount() const
+			{
+				return (unsigned int)queues.size();
+			}
+			/**
+			 * Adds a task to the queue of the calling thread. The pool takes
+			 * ownership of the task and deletes it after it has been run.
+			 * @param task Task to execute.
+			 * @param group Group of the task, see wait().
+			 * @param thread Index of the calling thread.
+			 */
+			void spawn(Task *task, TaskGroup &group, unsigned int thread)
+			{
+				group.pending.add(1);
+				Queue &queue = *queues[thread];
+				queue.lock();
+				queue.tasks.push_back(Entry(task, &group));
+				queue.unlock();
+				queuedTasks.add(1);
+				lockSleep();
+				wakeOne();
+				unlockSleep();
+			}
+			/**
+			 * Executes tasks until all tasks of the group have finished.
+			 * @param group Group to wait for.
+			 * @param thread Index of the calling thread.
+			 */
+			void wait(TaskGroup &group, unsigned int thread)
+			{
+				while (group.pending.get() != 0)
+				{
+					if (!runTask(thread))
+						yield();
+				}
+			}
+
+			/**
+			 * Returns the number of processors available to the process.
+			 */
+			static unsigned int getProcessorCount()
+			{
+#if defined(GAMEMATH_WINDOWS)
+				SYSTEM_INFO info;
+				GetSystemInfo(&info);
+				unsigned int count = (unsigned int)info.dwNumberOfProcessors;
+#else
+				long count = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+				return count > 0 ? (unsigned int)count : 1;
+			}
+		private:
+			struct Entry
+			{
+				Entry(Task *task, TaskGroup *group)
+					: task(task), group(group)
+				{
+				}
+				Task *task;
+				TaskGroup *group;
+			};
+			/**
+			 * Task queue of a single thread, protected by a mutex.
+			 */
+			class Queue
+			{
+				public:
+					Queue()
+					{
+#if defined(GAMEMATH_WINDOWS)
+						InitializeCriticalSection(&mutex);
+#else
+						pthread_mutex_init(&mutex, 0);
+#endif
+					}
+					~Queue()
+					{
+#if defined(GAMEMATH_WINDOWS)
+						DeleteCriticalSection(&mutex);
+#else
+						pthread_mutex_destroy(&mutex);
+#endif
+					}
+					void lock()
+					{
+#if defined(GAMEMATH_WINDOWS)
+						EnterCriticalSection(&mutex);
+#else
+						pthread_mutex_lock(&mutex);
+#endif
+					}
+					void unlock()
+					{
+#if defined(GAMEMATH_WINDOWS)
+						LeaveCriticalSection(&mutex);
+#else
+						pthread_mutex_unlock(&mutex);
+#endif
+					}
+					std::deque<Entry> tasks;
+				private:
+#if defined(GAMEMATH_WINDOWS)
+					CRITICAL_SECTION mutex;
+#else
+					pthread_mutex_t mutex;
+#endif
+			};
+			struct WorkerParams
+			{
+				ThreadPool *pool;
+				unsigned int thread;
+			};
+
+			/**
+			 * Takes a task from the own queue or steals one from another
+			 * thread and executes it.
+			 * @return False if no task was found.
+			 */
+			bool runTask(unsigned int thread)
+			{
+				if (queuedTasks.get() == 0)
+					return false;
+				unsigned int count = (unsigned int)queues.size();
+				for (unsigned int i = 0; i < count; i++)
+				{
+					unsigned int victim = (thread + i) % count;
+					Queue &queue = *queues[victim];
+					queue.lock();
+					if (queue.tasks.empty())
+					{
+						queue.unlock();
+						continue;
+					}
+					Entry entry = queue.tasks.front();
+					if (victim == thread)
+					{
+						entry = queue.tasks.back();
+						queue.tasks.pop_back();
+					}
+					else
+					{
+						queue.tasks.pop_front();
+					}
+					queue.unlock();
+					queuedTasks.add(-1);
+					entry.task->run(*this, thread);
+					delete entry.task;
+					entry.group->pending.add(-1);
+					return true;
+				}
+				return false;
+			}
+			void workerMain(unsigned int thread)
+			{
+				while (true)
+				{
+					if (runTask(thread))
+						continue;
+					lockSleep();
+					while (!stop && queuedTasks.get() == 0)
+						sleep();
+					bool exit = stop;
+					unlockSleep();
+					if (exit)
+						return;
+				}
+			}
+#if defined(GAMEMATH_WINDOWS)
+			static DWORD WINAPI workerEntry(LPVOID param)
+			{
+				WorkerParams *params = (WorkerParams*)param;
+				params->pool->workerMain(params->thread);
+				return 0;
+			}
+#else
+			static void *workerEntry(void *param)
+			{
+				WorkerParams *params = (WorkerParams*)param;
+				params->pool->workerMain(params->thread);
+				return 0;
+			}
+#endif
+
+			// Synchronization for idle threads
+#if defined(GAMEMATH_WINDOWS)
+			void createSync()
+			{
+				InitializeCriticalSection(&sleepMutex);
+				InitializeConditionVariable(&sleepCondition);
+			}
+			void destroySync()
+			{
+				DeleteCriticalSection(&sleepMutex);
+			}
+			void lockSleep()
+			{
+				EnterCriticalSection(&sleepMutex);
+			}
+			void unlockSleep()
+			{
+				LeaveCriticalSection(&sleepMutex);
+			}
+			void sleep()
+			{
+				SleepConditionVariableCS(&sleepCondition, &sleepMutex, INFINITE);
+			}
+			void wakeOne()
+			{
+				WakeConditionVariable(&sleepCondition);
+			}
+			void wakeAll()
+			{
+				WakeAllConditionVariable(&sleepCondition);
+			}
+			static void yield()
+			{
+				SwitchToThread();
+			}
+#else
+			void createSync()
+			{
+				pthread_mutex_init(&sleepMutex, 0);
+				pthread_cond_init(&sleepCondition, 0);
+			}
+			void destroySync()
+			{
+				pthread_cond_destroy(&sleepCondition);
+				pthread_mutex_destroy(&sleepMutex);
+			}
+			void lockSleep()
+			{
+				pthread_mutex_lock(&sleepMutex);
+			}
+			void unlockSleep()
+			{
+				pthread_mutex_unlock(&sleepMutex);
+			}
+			void sleep()
+			{
+				pthread_cond_wait(&sleepCondition, &sleepMutex);
+			}
+			void wakeOne()
+			{
+				pthread_cond_signal(&sleepCondition);
+			}
+			void wakeAll()
+			{
+				pthread_cond_broadcast(&sleepCondition);
+			}
+			static void yield()
+			{
+				sched_yield();
+			}
+#endif
+
+			// Not copyable
+			ThreadPool(const ThreadPool &other);
+			ThreadPool &operator=(const ThreadPool &other);
+
+			std::vector<Queue*> queues;
+			std::vector<WorkerParams> workerParams;
+#if defined(GAMEMATH_WINDOWS)
+			std::vector<HANDLE> threads;
+			CRITICAL_SECTION sleepMutex;
+			CONDITION_VARIABLE sleepCondition;
+#else
+			std::vector<pthread_t> threads;
+			pthread_mutex_t sleepMutex;
+			pthread_cond_t sleepCondition;
+#endif
+			bool stop;
+			AtomicCounter queuedTasks;
+	};
+}
+
+#endif
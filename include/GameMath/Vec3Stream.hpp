@@ -0,0 +1,371 @@
+/*
+Copyright (C) 2011, Mathias Gottschlag
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef GAMEMATH_VEC3STREAM_HPP_INCLUDED
+#define GAMEMATH_VEC3STREAM_HPP_INCLUDED
+
+#include "Vec3.hpp"
+#include "Alignment.hpp"
+#include "Simd.hpp"
+
+#include <vector>
+#include <cstring>
+
+namespace math
+{
+	/**
+	 * Array of three-dimensional vectors in structure-of-arrays layout. The
+	 * x, y and z components are stored in three separate 16-byte aligned
+	 * arrays so that the bulk operations can process several vectors at once.
+	 *
+	 * The arrays are padded to a multiple of eight elements. The contents of
+	 * the padding are undefined.
+	 */
+	template<typename T> class Vec3Stream
+	{
+	public:
+		/**
+		 * Constructor. Creates an empty stream.
+		 */
+		Vec3Stream()
+			: x(0), y(0), z(0), count(0), capacity(0)
+		{
+		}
+		/**
+		 * Constructor. Creates a stream with uninitialized elements.
+		 * @param size Number of elements.
+		 */
+		explicit Vec3Stream(size_t size)
+			: x(0), y(0), z(0), count(0), capacity(0)
+		{
+			resize(size);
+		}
+		/**
+		 * Constructor. Creates a stream with the contents of the vector.
+		 */
+		explicit Vec3Stream(const std::vector<Vec3<T> > &vectors)
+			: x(0), y(0), z(0), count(0), capacity(0)
+		{
+			assign(vectors);
+		}
+		/**
+		 * Copy constructor.
+		 */
+		Vec3Stream(const Vec3Stream<T> &other)
+			: x(0), y(0), z(0), count(0), capacity(0)
+		{
+			*this = other;
+		}
+		~Vec3Stream()
+		{
+			free_aligned_16(x);
+		}
+
+		Vec3Stream<T> &operator=(const Vec3Stream<T> &other)
+		{
+			if (&other == this)
+				return *this;
+			resize(other.count);
+			memcpy(x, other.x, count * sizeof(T));
+			memcpy(y, other.y, count * sizeof(T));
+			memcpy(z, other.z, count * sizeof(T));
+			return *this;
+		}
+
+		/**
+		 * Changes the number of elements. Existing elements are kept, new
+		 * elements are uninitialized.
+		 */
+		void resize(size_t size)
+		{
+			if (size > capacity)
+			{
+				size_t newcapacity = (size + 7) & ~(size_t)7;
+				// All three arrays are placed in a single allocation
+				T *data = (T*)malloc_aligned_16(3 * newcapacity * sizeof(T));
+				memset(data, 0, 3 * newcapacity * sizeof(T));
+				if (x)
+				{
+					memcpy(data, x, count * sizeof(T));
+					memcpy(data + newcapacity, y, count * sizeof(T));
+					memcpy(data + 2 * newcapacity, z, count * sizeof(T));
+					free_aligned_16(x);
+				}
+				x = data;
+				y = data + newcapacity;
+				z = data + 2 * newcapacity;
+				capacity = newcapacity;
+			}
+			count = size;
+		}
+		/**
+		 * Returns the number of elements.
+		 */
+		size_t size() const
+		{
+			return count;
+		}
+
+		Vec3<T> get(size_t index) const
+		{
+			return Vec3<T>(x[index], y[index], z[index]);
+		}
+		void set(size_t index, const Vec3<T> &v)
+		{
+			x[index] = v.x;
+			y[index] = v.y;
+			z[index] = v.z;
+		}
+
+		/**
+		 * Replaces the contents of the stream with an array of vectors.
+		 */
+		void assign(const Vec3<T> *vectors, size_t size)
+		{
+			resize(size);
+			for (size_t i = 0; i < size; i++)
+				set(i, vectors[i]);
+		}
+		void assign(const std::vector<Vec3<T> > &vectors)
+		{
+			assign(vectors.empty() ? 0 : &vectors[0], vectors.size());
+		}
+		/**
+		 * Writes the contents of the stream into an array of vectors. The
+		 * array has to have room for size() elements.
+		 */
+		void copyTo(Vec3<T> *vectors) const
+		{
+			for (size_t i = 0; i < count; i++)
+				vectors[i] = get(i);
+		}
+		void copyTo(std::vector<Vec3<T> > &vectors) const
+		{
+			vectors.resize(count);
+			if (count != 0)
+				copyTo(&vectors[0]);
+		}
+		std::vector<Vec3<T> > toVector() const
+		{
+			std::vector<Vec3<T> > vectors;
+			copyTo(vectors);
+			return vectors;
+		}
+
+		/**
+		 * Computes the dot product of every element with the corresponding
+		 * element of another stream of the same size.
+		 * @param other Second operand.
+		 * @param result Array with room for size() values.
+		 */
+		void dot(const Vec3Stream<T> &other, T *result) const
+		{
+			for (size_t i = 0; i < count; i++)
+				result[i] = x[i] * other.x[i] + y[i] * other.y[i] + z[i] * other.z[i];
+		}
+		/**
+		 * Computes the squared length of every element.
+		 * @param result Array with room for size() values.
+		 */
+		void getSquaredLength(T *result) const
+		{
+			dot(*this, result);
+		}
+		/**
+		 * Computes the cross product of every element with the
+		 * corresponding element of another stream. result may be one of the
+		 * two operands.
+		 */
+		void cross(const Vec3Stream<T> &other, Vec3Stream<T> &result) const
+		{
+			result.resize(count);
+			for (size_t i = 0; i < count; i++)
+			{
+				T cx = y[i] * other.z[i] - z[i] * other.y[i];
+				T cy = z[i] * other.x[i] - x[i] * other.z[i];
+				T cz = x[i] * other.y[i] - y[i] * other.x[i];
+				result.x[i] = cx;
+				result.y[i] = cy;
+				result.z[i] = cz;
+			}
+		}
+		/**
+		 * Scales all elements so that they have the length 1.
+		 */
+		Vec3Stream<T> &normalize()
+		{
+			for (size_t i = 0; i < count; i++)
+			{
+				T length = sqrt(x[i] * x[i] + y[i] * y[i] + z[i] * z[i]);
+				x[i] /= length;
+				y[i] /= length;
+				z[i] /= length;
+			}
+			return *this;
+		}
+		/**
+		 * Sets all elements to the linear interpolation between the
+		 * corresponding elements of a and b, see Vec3::interpolate().
+		 */
+		Vec3Stream<T> &interpolate(const Vec3Stream<T> &a,
+		                           const Vec3Stream<T> &b,
+		                           float d)
+		{
+			resize(a.count);
+			for (size_t i = 0; i < count; i++)
+			{
+				x[i] = a.x[i] + (b.x[i] - a.x[i]) * d;
+				y[i] = a.y[i] + (b.y[i] - a.y[i]) * d;
+				z[i] = a.z[i] + (b.z[i] - a.z[i]) * d;
+			}
+			return *this;
+		}
+
+		/**
+		 * X components.
+		 */
+		T *x;
+		/**
+		 * Y components.
+		 */
+		T *y;
+		/**
+		 * Z components.
+		 */
+		T *z;
+	private:
+		size_t count;
+		size_t capacity;
+	};
+
+	typedef Vec3Stream<float> Vec3Streamf;
+	typedef Vec3Stream<double> Vec3Streamd;
+
+#if defined(GAMEMATH_SSE2)
+	// The float versions process SimdFloat::Width elements at once. As the
+	// arrays are padded, the padding is processed as well and only results
+	// which are written to external arrays need special handling.
+	template<> inline void Vec3Stream<float>::dot(const Vec3Stream<float> &other,
+	                                             float *result) const
+	{
+		for (size_t i = 0; i < count; i += SimdFloat::Width)
+		{
+			SimdFloat d = SimdFloat::load(x + i) * SimdFloat::load(other.x + i);
+			d = madd(SimdFloat::load(y + i), SimdFloat::load(other.y + i), d);
+			d = madd(SimdFloat::load(z + i), SimdFloat::load(other.z + i), d);
+			if (count - i >= SimdFloat::Width)
+				d.store(result + i);
+			else
+			{
+				float values[SimdFloat::Width];
+				d.store(values);
+				memcpy(result + i, values, (count - i) * sizeof(float));
+			}
+		}
+	}
+
+	template<> inline void Vec3Stream<float>::cross(const Vec3Stream<float> &other,
+	                                               Vec3Stream<float> &result) const
+	{
+		result.resize(count);
+		for (size_t i = 0; i < count; i += SimdFloat::Width)
+		{
+			SimdFloat ax = SimdFloat::load(x + i);
+			SimdFloat ay = SimdFloat::load(y + i);
+			SimdFloat az = SimdFloat::load(z + i);
+			SimdFloat bx = SimdFloat::load(other.x + i);
+			SimdFloat by = SimdFloat::load(other.y + i);
+			SimdFloat bz = SimdFloat::load(other.z + i);
+			(ay * bz - az * by).store(result.x + i);
+			(az * bx - ax * bz).store(result.y + i);
+			(ax * by - ay * bx).store(result.z + i);
+		}
+	}
+
+	template<> inline Vec3Stream<float> &Vec3Stream<float>::normalize()
+	{
+		for (size_t i = 0; i < count; i += SimdFloat::Width)
+		{
+			SimdFloat vx = SimdFloat::load(x + i);
+			SimdFloat vy = SimdFloat::load(y + i);
+			SimdFloat vz = SimdFloat::load(z + i);
+			SimdFloat length = sqrt(madd(vz, vz, madd(vy, vy, vx * vx)));
+			(vx / length).store(x + i);
+			(vy / length).store(y + i);
+			(vz / length).store(z + i);
+		}
+		return *this;
+	}
+
+	template<> inline Vec3Stream<float> &Vec3Stream<float>::interpolate(const Vec3Stream<float> &a,
+	                                                                   const Vec3Stream<float> &b,
+	                                                                   float d)
+	{
+		resize(a.count);
+		SimdFloat factor(d);
+		for (size_t i = 0; i < count; i += SimdFloat::Width)
+		{
+			SimdFloat ax = SimdFloat::load(a.x + i);
+			SimdFloat ay = SimdFloat::load(a.y + i);
+			SimdFloat az = SimdFloat::load(a.z + i);
+			madd(SimdFloat::load(b.x + i) - ax, factor, ax).store(x + i);
+			madd(SimdFloat::load(b.y + i) - ay, factor, ay).store(y + i);
+			madd(SimdFloat::load(b.z + i) - az, factor, az).store(z + i);
+		}
+		return *this;
+	}
+
+	template<> inline void Vec3Stream<float>::assign(const Vec3<float> *vectors,
+	                                                size_t size)
+	{
+		resize(size);
+		size_t simdCount = size & ~(size_t)3;
+		size_t i = 0;
+		for (; i < simdCount; i += 4)
+		{
+			Float4 vx, vy, vz;
+			loadInterleaved3(&vectors[i].x, vx, vy, vz);
+			vx.store(x + i);
+			vy.store(y + i);
+			vz.store(z + i);
+		}
+		for (; i < size; i++)
+			set(i, vectors[i]);
+	}
+
+	template<> inline void Vec3Stream<float>::copyTo(Vec3<float> *vectors) const
+	{
+		size_t simdCount = count & ~(size_t)3;
+		size_t i = 0;
+		for (; i < simdCount; i += 4)
+		{
+			storeInterleaved3(&vectors[i].x,
+			                  Float4::load(x + i),
+			                  Float4::load(y + i),
+			                  Float4::load(z + i));
+		}
+		for (; i < count; i++)
+			vectors[i] = get(i);
+	}
+#endif
+}
+
+#endif
@@ -0,0 +1,123 @@
+/*
+Copyright (C) 2011, Mathias Gottschlag
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "GameMath.hpp"
+
+#include <cmath>
+#include <iostream>
+
+using namespace math;
+
+static bool isSimilar(const Mat4f &a, const Mat4f &b)
+{
+	for (unsigned int i = 0; i < 16; i++)
+	{
+		if (std::fabs(a.m[i] - b.m[i]) > 0.0001f)
+			return false;
+	}
+	return true;
+}
+
+static bool isSimilar(const Vec3f &a, const Vec3f &b)
+{
+	return std::fabs(a.x - b.x) < 0.0001f
+	    && std::fabs(a.y - b.y) < 0.0001f
+	    && std::fabs(a.z - b.z) < 0.0001f;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int errors = 0;
+	Mat4f m1 = Mat4f::TransMat(1.5f, -2.25f, 3.0f)
+	         * Mat4f::EulerRotation(Vec3f(30, 45, -60))
+	         * Mat4f::ScaleMat(2.0f, 0.5f, 1.25f);
+	Mat4f m2 = Mat4f::TransMat(-0.75f, 4.0f, 0.5f)
+	         * Mat4f::EulerRotation(Vec3f(-10, 80, 15));
+	Affine3f a1(m1);
+	Affine3f a2(m2);
+	{
+		// Conversion
+		if (a1.toMatrix() != m1)
+		{
+			std::cout << "Conversion from/to Mat4 wrong." << std::endl;
+			errors++;
+		}
+		if (Affine3f::Identity().toMatrix() != Mat4f::Identity())
+		{
+			std::cout << "Identity wrong." << std::endl;
+			errors++;
+		}
+		if (Affine3f::TransMat(Vec3f(1, 2, 3)).toMatrix() != Mat4f::TransMat(1, 2, 3)
+		 || Affine3f::ScaleMat(Vec3f(1, 2, 3)).toMatrix() != Mat4f::ScaleMat(1, 2, 3))
+		{
+			std::cout << "TransMat/ScaleMat wrong." << std::endl;
+			errors++;
+		}
+	}
+	{
+		// Composition
+		if (!isSimilar((a1 * a2).toMatrix(), m1 * m2)
+		 || !isSimilar((a2 * a1).toMatrix(), m2 * m1))
+		{
+			std::cout << "Composition wrong." << std::endl;
+			errors++;
+		}
+		Affine3f a3 = a1;
+		a3 *= a2;
+		if (a3 != a1 * a2)
+		{
+			std::cout << "operator*= wrong." << std::endl;
+			errors++;
+		}
+	}
+	{
+		// Point and direction transformation
+		Vec3f v(0.3f, -1.7f, 2.9f);
+		Vec4f p = m1 * Vec4f(v.x, v.y, v.z, 1);
+		Vec4f d = m1 * Vec4f(v.x, v.y, v.z, 0);
+		if (!isSimilar(a1.transformPoint(v), Vec3f(p.x, p.y, p.z)))
+		{
+			std::cout << "transformPoint wrong." << std::endl;
+			errors++;
+		}
+		if (!isSimilar(a1.transformDirection(v), Vec3f(d.x, d.y, d.z)))
+		{
+			std::cout << "transformDirection wrong." << std::endl;
+			errors++;
+		}
+	}
+	{
+		// Inversion
+		if (!isSimilar((a1 * a1.inverse()).toMatrix(), Mat4f::Identity())
+		 || !isSimilar(a1.inverse().toMatrix(), m1.inverse()))
+		{
+			std::cout << "inverse wrong." << std::endl;
+			errors++;
+		}
+		if (!isSimilar(a2.inverseRigid().toMatrix(), a2.inverse().toMatrix()))
+		{
+			std::cout << "inverseRigid wrong." << std::endl;
+			errors++;
+		}
+	}
+	std::cout << errors << " errors." << std::endl;
+	return errors;
+}
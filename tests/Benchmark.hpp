@@ -0,0 +1,61 @@
+/*
+Copyright (C) 2011, Mathias Gottschlag
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef GAMEMATH_TESTS_BENCHMARK_HPP_INCLUDED
+#define GAMEMATH_TESTS_BENCHMARK_HPP_INCLUDED
+
+#include "GameMath/Platform.hpp"
+
+#if defined(GAMEMATH_WINDOWS)
+	#include <windows.h>
+#else
+	#include <time.h>
+#endif
+
+/**
+ * Returns a monotonic timestamp in nanoseconds.
+ */
+static inline double getTime()
+{
+#if defined(GAMEMATH_WINDOWS)
+	LARGE_INTEGER frequency, counter;
+	QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&counter);
+	return (double)counter.QuadPart * 1e9 / (double)frequency.QuadPart;
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+#endif
+}
+
+static volatile char benchmarkSink;
+
+/**
+ * Prevents the compiler from optimizing away the computation of a value which
+ * is not used otherwise.
+ */
+template<typename T> static inline void doNotOptimize(const T &value)
+{
+	benchmarkSink = *(const volatile char*)&value;
+}
+
+#endif
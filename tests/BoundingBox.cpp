@@ -0,0 +1,160 @@
+/*
+Copyright (C) 2011, Mathias Gottschlag
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "GameMath.hpp"
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+using namespace math;
+
+static float randomFloat(float min, float max)
+{
+	return min + (max - min) * (float)rand() / (float)RAND_MAX;
+}
+
+static bool isSimilar(const BoundingBox &a, const BoundingBox &b)
+{
+	const float *pa = &a.minCorner.x;
+	const float *pb = &b.minCorner.x;
+	for (unsigned int i = 0; i < 6; i++)
+	{
+		if (std::fabs(pa[i] - pb[i]) > 0.0001f * (1 + std::fabs(pb[i])))
+			return false;
+	}
+	return true;
+}
+
+/**
+ * Reference implementation which transforms all eight corners.
+ */
+static BoundingBox transformCorners(const BoundingBox &box, const Mat4f &m)
+{
+	Affine3f affine(m);
+	BoundingBox result(affine.transformPoint(box.getCorner(0)));
+	for (unsigned int i = 1; i < 8; i++)
+		result.insert(affine.transformPoint(box.getCorner(i)));
+	return result;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int errors = 0;
+	{
+		// Insertion
+		BoundingBox box(Vec3f(1, 2, 3));
+		box.insert(Vec3f(-1, 5, 3));
+		box.insert(Vec3f(2, 0, 4));
+		if (box.minCorner != Vec3f(-1, 0, 3) || box.maxCorner != Vec3f(2, 5, 4))
+		{
+			std::cout << "insert(Vec3f) wrong." << std::endl;
+			errors++;
+		}
+		box.insert(BoundingBox(Vec3f(-2, 1, 1), Vec3f(0, 6, 2)));
+		if (box.minCorner != Vec3f(-2, 0, 1) || box.maxCorner != Vec3f(2, 6, 4))
+		{
+			std::cout << "insert(BoundingBox) wrong." << std::endl;
+			errors++;
+		}
+	}
+	{
+		// Transformation
+		BoundingBox box(Vec3f(-1, -2, -3), Vec3f(1, 2, 3));
+		BoundingBox transformed = box.transform(Mat4f::TransMat(1, 2, 3)
+		                                        * Mat4f::ScaleMat(2, 2, 2));
+		if (transformed.minCorner != Vec3f(-1, -2, -3)
+		 || transformed.maxCorner != Vec3f(3, 6, 9))
+		{
+			std::cout << "transform() wrong (1)." << std::endl;
+			errors++;
+		}
+		Mat4f rotation = Mat4f::EulerRotation(Vec3f(0, 90, 0));
+		transformed = box.transform(rotation);
+		if (!isSimilar(transformed, BoundingBox(Vec3f(-3, -2, -1), Vec3f(3, 2, 1))))
+		{
+			std::cout << "transform() wrong (2)." << std::endl;
+			errors++;
+		}
+	}
+	{
+		// Random boxes and matrices against the corner transformation and
+		// batch versions against single boxes
+		const unsigned int count = 103;
+		BoundingBox boxes[count];
+		Mat4f matrices[count];
+		for (unsigned int i = 0; i < count; i++)
+		{
+			Vec3f center(randomFloat(-10, 10), randomFloat(-10, 10), randomFloat(-10, 10));
+			Vec3f size(randomFloat(0, 5), randomFloat(0, 5), randomFloat(0, 5));
+			boxes[i] = BoundingBox(center - size, center + size);
+			for (unsigned int j = 0; j < 16; j++)
+				matrices[i].m[j] = randomFloat(-2, 2);
+		}
+		unsigned int wrong = 0;
+		for (unsigned int i = 0; i < count; i++)
+		{
+			if (!isSimilar(boxes[i].transform(matrices[i]),
+			               transformCorners(boxes[i], matrices[i])))
+				wrong++;
+			Affine3f affine(matrices[i]);
+			if (!isSimilar(boxes[i].transform(affine),
+			               boxes[i].transform(matrices[i])))
+				wrong++;
+		}
+		if (wrong != 0)
+		{
+			std::cout << "transform() wrong for " << wrong << " boxes." << std::endl;
+			errors++;
+		}
+		BoundingBox result[count];
+		BoundingBox::transformBoxes(boxes, matrices[0], result, count);
+		wrong = 0;
+		for (unsigned int i = 0; i < count; i++)
+		{
+			if (!isSimilar(result[i], boxes[i].transform(matrices[0])))
+				wrong++;
+		}
+		BoundingBox::transformBoxes(boxes, matrices, result, count);
+		for (unsigned int i = 0; i < count; i++)
+		{
+			if (!isSimilar(result[i], boxes[i].transform(matrices[i])))
+				wrong++;
+		}
+		// In-place transformation
+		BoundingBox inplace[count];
+		for (unsigned int i = 0; i < count; i++)
+			inplace[i] = boxes[i];
+		BoundingBox::transformBoxes(inplace, matrices, inplace, count);
+		for (unsigned int i = 0; i < count; i++)
+		{
+			if (!isSimilar(inplace[i], result[i]))
+				wrong++;
+		}
+		if (wrong != 0)
+		{
+			std::cout << "transformBoxes() wrong for " << wrong << " boxes." << std::endl;
+			errors++;
+		}
+	}
+	std::cout << errors << " errors." << std::endl;
+	return errors;
+}
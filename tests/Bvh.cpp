@@ -0,0 +1,309 @@
+/*
+Copyright (C) 2011, Mathias Gottschlag
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "GameMath.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+using namespace math;
+
+static float randomFloat(float min, float max)
+{
+	return min + (max - min) * (float)rand() / (float)RAND_MAX;
+}
+
+static Vec3f randomVec3(float min, float max)
+{
+	return Vec3f(randomFloat(min, max), randomFloat(min, max),
+	             randomFloat(min, max));
+}
+
+static void randomBoxes(std::vector<BoundingBox> &boxes)
+{
+	for (unsigned int i = 0; i < boxes.size(); i++)
+	{
+		Vec3f center = randomVec3(-100, 100);
+		Vec3f size = randomVec3(0.1f, 5);
+		boxes[i] = BoundingBox(center - size, center + size);
+	}
+}
+
+static bool intersectRay(const BoundingBox &box, const Vec3f &origin,
+                         const Vec3f &direction, float maxDistance)
+{
+	float tmin = 0;
+	float tmax = maxDistance;
+	for (unsigned int i = 0; i < 3; i++)
+	{
+		float t1 = ((&box.minCorner.x)[i] - (&origin.x)[i]) / (&direction.x)[i];
+		float t2 = ((&box.maxCorner.x)[i] - (&origin.x)[i]) / (&direction.x)[i];
+		tmin = std::max(tmin, std::min(t1, t2));
+		tmax = std::min(tmax, std::max(t1, t2));
+	}
+	return tmin <= tmax;
+}
+
+/**
+ * Sorts the query result and compares it against the expected result.
+ */
+static bool compare(std::vector<uint32> &result, const std::vector<uint32> &expected)
+{
+	std::sort(result.begin(), result.end());
+	return result == expected;
+}
+
+/**
+ * Checks the structure of the tree: every primitive is referenced exactly
+ * once and every node contains its children/primitives.
+ */
+static bool checkStructure(const Bvh &bvh, const std::vector<BoundingBox> &boxes)
+{
+	const std::vector<Bvh::Node> &nodes = bvh.getNodes();
+	const std::vector<uint32> &indices = bvh.getPrimitiveIndices();
+	std::vector<unsigned int> references(boxes.size(), 0);
+	for (unsigned int i = 0; i < nodes.size(); i++)
+	{
+		const Bvh::Node &node = nodes[i];
+		if (node.isLeaf())
+		{
+			for (uint32 j = node.first; j < node.first + node.count; j++)
+			{
+				references[indices[j]]++;
+				BoundingBox box = node.bounds;
+				box.insert(boxes[indices[j]]);
+				if (box.minCorner != node.bounds.minCorner
+				 || box.maxCorner != node.bounds.maxCorner)
+					return false;
+			}
+		}
+		else
+		{
+			for (uint32 j = node.first; j < node.first + 2; j++)
+			{
+				if (j <= i || j >= nodes.size())
+					return false;
+				BoundingBox box = node.bounds;
+				box.insert(nodes[j].bounds);
+				if (box.minCorner != node.bounds.minCorner
+				 || box.maxCorner != node.bounds.maxCorner)
+					return false;
+			}
+		}
+	}
+	for (unsigned int i = 0; i < references.size(); i++)
+	{
+		if (references[i] != 1)
+			return false;
+	}
+	return true;
+}
+
+static bool isEqual(const Bvh &a, const Bvh &b)
+{
+	const std::vector<Bvh::Node> &nodesA = a.getNodes();
+	const std::vector<Bvh::Node> &nodesB = b.getNodes();
+	if (nodesA.size() != nodesB.size()
+	 || a.getPrimitiveIndices() != b.getPrimitiveIndices())
+		return false;
+	for (unsigned int i = 0; i < nodesA.size(); i++)
+	{
+		if (nodesA[i].first != nodesB[i].first
+		 || nodesA[i].count != nodesB[i].count
+		 || nodesA[i].bounds.minCorner != nodesB[i].bounds.minCorner
+		 || nodesA[i].bounds.maxCorner != nodesB[i].bounds.maxCorner)
+			return false;
+	}
+	return true;
+}
+
+static unsigned int testQueries(const Bvh &bvh, const std::vector<BoundingBox> &boxes)
+{
+	unsigned int wrong = 0;
+	std::vector<uint32> result;
+	std::vector<uint32> expected;
+	for (unsigned int i = 0; i < 50; i++)
+	{
+		// Box overlap
+		Vec3f center = randomVec3(-100, 100);
+		Vec3f size = randomVec3(1, 20);
+		BoundingBox query(center - size, center + size);
+		result.clear();
+		expected.clear();
+		for (unsigned int j = 0; j < boxes.size(); j++)
+		{
+			if (boxes[j].overlap(query))
+				expected.push_back(j);
+		}
+		if (bvh.queryOverlap(query, result) != expected.size()
+		 || !compare(result, expected))
+			wrong++;
+		// Point
+		Vec3f point = randomVec3(-100, 100);
+		result.clear();
+		expected.clear();
+		for (unsigned int j = 0; j < boxes.size(); j++)
+		{
+			if (boxes[j].isInside(point))
+				expected.push_back(j);
+		}
+		bvh.queryPoint(point, result);
+		if (!compare(result, expected))
+			wrong++;
+		// Ray
+		Vec3f origin = randomVec3(-120, 120);
+		Vec3f direction = randomVec3(-1, 1);
+		if (i == 0)
+			direction = Vec3f(0, 0, 1);
+		result.clear();
+		expected.clear();
+		for (unsigned int j = 0; j < boxes.size(); j++)
+		{
+			if (intersectRay(boxes[j], origin, direction, 150))
+				expected.push_back(j);
+		}
+		bvh.queryRay(origin, direction, 150, result);
+		if (!compare(result, expected))
+			wrong++;
+		// Frustum
+		Frustum frustum(Mat4f::PerspectiveFOV(randomFloat(30, 90), 1.333f, 1, 80)
+		                * Mat4f::EulerRotation(randomVec3(0, 360))
+		                * Mat4f::TransMat(randomVec3(-50, 50)));
+		result.clear();
+		expected.clear();
+		for (unsigned int j = 0; j < boxes.size(); j++)
+		{
+			if (frustum.isInside(boxes[j]))
+				expected.push_back(j);
+		}
+		bvh.queryFrustum(frustum, result);
+		if (!compare(result, expected))
+			wrong++;
+	}
+	return wrong;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int errors = 0;
+	{
+		// Empty tree
+		Bvh bvh;
+		bvh.build(0, 0);
+		std::vector<uint32> result;
+		if (bvh.queryPoint(Vec3f(0, 0, 0), result) != 0 || !bvh.getNodes().empty())
+		{
+			std::cout << "Empty tree wrong." << std::endl;
+			errors++;
+		}
+	}
+	{
+		// Identical boxes cannot be split by the SAH
+		std::vector<BoundingBox> boxes(100, BoundingBox(Vec3f(0, 0, 0), Vec3f(1, 1, 1)));
+		Bvh bvh;
+		bvh.build(&boxes[0], boxes.size());
+		std::vector<uint32> result;
+		if (!checkStructure(bvh, boxes)
+		 || bvh.queryPoint(Vec3f(0.5f, 0.5f, 0.5f), result) != 100)
+		{
+			std::cout << "Tree with identical boxes wrong." << std::endl;
+			errors++;
+		}
+	}
+	std::vector<BoundingBox> boxes(3000);
+	randomBoxes(boxes);
+	Bvh bvh;
+	bvh.build(&boxes[0], boxes.size());
+	{
+		// Structure and queries
+		if (!checkStructure(bvh, boxes))
+		{
+			std::cout << "Tree structure wrong." << std::endl;
+			errors++;
+		}
+		unsigned int wrong = testQueries(bvh, boxes);
+		if (wrong != 0)
+		{
+			std::cout << wrong << " queries wrong." << std::endl;
+			errors++;
+		}
+	}
+	{
+		// Refit after moving the boxes
+		randomBoxes(boxes);
+		bvh.refit(&boxes[0]);
+		if (!checkStructure(bvh, boxes))
+		{
+			std::cout << "Tree structure wrong after refit." << std::endl;
+			errors++;
+		}
+		unsigned int wrong = testQueries(bvh, boxes);
+		if (wrong != 0)
+		{
+			std::cout << wrong << " queries wrong after refit." << std::endl;
+			errors++;
+		}
+	}
+	{
+		// Morton code build
+		Bvh morton;
+		morton.build(&boxes[0], boxes.size(), 4, Bvh::Morton);
+		if (!checkStructure(morton, boxes))
+		{
+			std::cout << "Morton tree structure wrong." << std::endl;
+			errors++;
+		}
+		unsigned int wrong = testQueries(morton, boxes);
+		if (wrong != 0)
+		{
+			std::cout << wrong << " queries on the Morton tree wrong." << std::endl;
+			errors++;
+		}
+	}
+	{
+		// Parallel builds create the same tree as the single-threaded one
+		std::vector<BoundingBox> many(50000);
+		randomBoxes(many);
+		const unsigned int threadCounts[] = {1, 2, 3, 8};
+		for (unsigned int mode = 0; mode < 2; mode++)
+		{
+			Bvh::BuildMode buildMode = mode == 0 ? Bvh::BinnedSah : Bvh::Morton;
+			Bvh reference;
+			reference.build(&many[0], many.size(), 4, buildMode);
+			for (unsigned int i = 0; i < 4; i++)
+			{
+				ThreadPool pool(threadCounts[i]);
+				Bvh bvh;
+				bvh.build(pool, &many[0], many.size(), 4, buildMode);
+				if (!isEqual(bvh, reference))
+				{
+					std::cout << "Parallel build with " << threadCounts[i]
+						<< " threads differs (mode " << mode << ")." << std::endl;
+					errors++;
+				}
+			}
+		}
+	}
+	std::cout << errors << " errors." << std::endl;
+	return errors;
+}
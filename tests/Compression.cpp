@@ -0,0 +1,197 @@
+/*
+Copyright (C) 2011, Mathias Gottschlag
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "GameMath.hpp"
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+using namespace math;
+
+static float randomFloat(float min, float max)
+{
+	return min + (max - min) * (float)rand() / (float)RAND_MAX;
+}
+
+static Quaternion randomQuaternion()
+{
+	Quaternion q(randomFloat(-1, 1), randomFloat(-1, 1), randomFloat(-1, 1),
+	             randomFloat(-1, 1));
+	q.normalize();
+	return q;
+}
+
+/**
+ * Returns the rotation angle between two rotations in radians.
+ */
+static float angleBetween(const Quaternion &a, const Quaternion &b)
+{
+	float sign = a.dot(b) < 0.0f ? -1.0f : 1.0f;
+	Quaternion difference = a - b * sign;
+	double distance = std::sqrt((double)difference.dot(difference));
+	if (distance > 2.0)
+		distance = 2.0;
+	return (float)(4.0 * std::asin(distance * 0.5));
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int errors = 0;
+	srand(8);
+	{
+		// Half floats, every half has to survive the round trip
+		unsigned int wrong = 0;
+		for (uint32 i = 0; i < 0x10000; i++)
+		{
+			uint16 half = (uint16)i;
+			float value = halfToFloat(half);
+			bool nan = (half & 0x7c00) == 0x7c00 && (half & 0x3ff) != 0;
+			if (nan ? value == value : floatToHalf(value) != half)
+				wrong++;
+		}
+		if (floatToHalf(1.0f) != 0x3c00 || floatToHalf(-2.0f) != 0xc000
+		 || floatToHalf(65504.0f) != 0x7bff || floatToHalf(1e6f) != 0x7c00
+		 || floatToHalf(5.9604645e-08f) != 0x0001 || floatToHalf(0.0f) != 0
+		 || halfToFloat(0x3555) != 0.333251953125f)
+			wrong++;
+		// Rounding to nearest even
+		if (floatToHalf(1.0f + 1.0f / 2048.0f) != 0x3c00
+		 || floatToHalf(1.0f + 3.0f / 2048.0f) != 0x3c02)
+			wrong++;
+		// Bulk conversion and relative error, odd count to test the tail
+		const unsigned int count = 1001;
+		std::vector<float> values(count);
+		for (unsigned int i = 0; i < count; i++)
+			values[i] = randomFloat(-1, 1) * std::pow(2.0f, randomFloat(-14, 15));
+		std::vector<uint16> halves(count);
+		floatsToHalves(&values[0], &halves[0], count);
+		std::vector<float> decoded(count);
+		halvesToFloats(&halves[0], &decoded[0], count);
+		for (unsigned int i = 0; i < count; i++)
+		{
+			if (halves[i] != floatToHalf(values[i]))
+				wrong++;
+			// Relative error for normalized halves, absolute error for
+			// denormals
+			float maxError = std::fabs(values[i]) / 2048.0f;
+			if (maxError < 2.9802322e-08f)
+				maxError = 2.9802322e-08f;
+			if (std::fabs(decoded[i] - values[i]) > maxError)
+				wrong++;
+		}
+		if (wrong != 0)
+		{
+			std::cout << "Half floats: " << wrong << " wrong results." << std::endl;
+			errors++;
+		}
+	}
+	{
+		// Smallest-three quaternions
+		const unsigned int count = 20001;
+		std::vector<Quaternion> quaternions(count);
+		for (unsigned int i = 0; i < count; i++)
+			quaternions[i] = randomQuaternion();
+		quaternions[0] = Quaternion(0, 0, 0, -1);
+		quaternions[1] = Quaternion(0.5f, -0.5f, 0.5f, -0.5f);
+		std::vector<PackedQuaternion32> packed32(count);
+		std::vector<PackedQuaternion48> packed48(count);
+		PackedQuaternion32::pack(&quaternions[0], &packed32[0], count);
+		PackedQuaternion48::pack(&quaternions[0], &packed48[0], count);
+		std::vector<Quaternion> unpacked32(count);
+		std::vector<Quaternion> unpacked48(count);
+		PackedQuaternion32::unpack(&packed32[0], &unpacked32[0], count);
+		PackedQuaternion48::unpack(&packed48[0], &unpacked48[0], count);
+		float maxError32 = 0.0f;
+		float maxError48 = 0.0f;
+		unsigned int wrong = 0;
+		for (unsigned int i = 0; i < count; i++)
+		{
+			float error32 = angleBetween(quaternions[i], unpacked32[i]);
+			float error48 = angleBetween(quaternions[i], unpacked48[i]);
+			if (error32 > maxError32)
+				maxError32 = error32;
+			if (error48 > maxError48)
+				maxError48 = error48;
+			if (PackedQuaternion32(quaternions[i]).bits != packed32[i].bits
+			 || PackedQuaternion48(quaternions[i]).unpack() != unpacked48[i])
+				wrong++;
+			if (std::fabs(unpacked32[i].dot(unpacked32[i]) - 1.0f) > 1e-5f)
+				wrong++;
+		}
+		if (sizeof(PackedQuaternion48) != 6)
+			wrong++;
+		if (wrong != 0 || maxError32 > 0.005f || maxError48 > 0.00015f)
+		{
+			std::cout << "Smallest-three: " << wrong << " wrong results, "
+				<< "maximum error " << maxError32 << "/" << maxError48
+				<< std::endl;
+			errors++;
+		}
+	}
+	{
+		// Quantized positions
+		BoundingBox range(Vec3f(-100, 0, 5), Vec3f(100, 10, 5.5f));
+		Vec3Quantizer quantizer(range, 12);
+		const unsigned int count = 103;
+		std::vector<Vec3f> positions(count);
+		for (unsigned int i = 0; i < count; i++)
+		{
+			positions[i] = Vec3f(randomFloat(-100, 100), randomFloat(0, 10),
+			                     randomFloat(5, 5.5f));
+		}
+		positions[3] = range.minCorner;
+		positions[4] = range.maxCorner;
+		std::vector<QuantizedVec3> quantized(count);
+		quantizer.quantize(&positions[0], &quantized[0], count);
+		std::vector<Vec3f> dequantized(count);
+		quantizer.dequantize(&quantized[0], &dequantized[0], count);
+		Vec3f maxError = quantizer.getMaxError() * 1.001f;
+		unsigned int wrong = 0;
+		for (unsigned int i = 0; i < count; i++)
+		{
+			QuantizedVec3 single = quantizer.quantize(positions[i]);
+			if (single.x != quantized[i].x || single.y != quantized[i].y
+			 || single.z != quantized[i].z)
+				wrong++;
+			if (quantizer.dequantize(single) != dequantized[i])
+				wrong++;
+			Vec3f error = dequantized[i] - positions[i];
+			if (std::fabs(error.x) > maxError.x || std::fabs(error.y) > maxError.y
+			 || std::fabs(error.z) > maxError.z)
+				wrong++;
+		}
+		// Positions outside of the box are clamped
+		QuantizedVec3 clamped = quantizer.quantize(Vec3f(-200, 20, 5.25f));
+		if (clamped.x != 0 || clamped.y != 4095 || quantized[4].z != 4095)
+			wrong++;
+		if (wrong != 0)
+		{
+			std::cout << "Vec3Quantizer: " << wrong << " wrong results."
+				<< std::endl;
+			errors++;
+		}
+	}
+	std::cout << errors << " errors." << std::endl;
+	return errors;
+}
@@ -0,0 +1,133 @@
+/*
+Copyright (C) 2011, Mathias Gottschlag
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "GameMath.hpp"
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+using namespace math;
+
+static float randomFloat(float min, float max)
+{
+	return min + (max - min) * (float)rand() / (float)RAND_MAX;
+}
+
+static Vec3f randomVec3(float min, float max)
+{
+	return Vec3f(randomFloat(min, max), randomFloat(min, max),
+	             randomFloat(min, max));
+}
+
+static bool isEqual(const Mat4f &a, const Mat4f &b, float epsilon)
+{
+	for (unsigned int i = 0; i < 16; i++)
+	{
+		if (std::fabs(a.m[i] - b.m[i]) > epsilon)
+			return false;
+	}
+	return true;
+}
+
+static bool isEqual(const Vec3f &a, const Vec3f &b, float epsilon)
+{
+	return std::fabs(a.x - b.x) <= epsilon && std::fabs(a.y - b.y) <= epsilon
+	    && std::fabs(a.z - b.z) <= epsilon;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int errors = 0;
+	srand(4);
+	{
+		// Quaternion from matrix, covering all branches
+		unsigned int wrong = 0;
+		for (unsigned int i = 0; i < 100; i++)
+		{
+			Quaternion q(randomVec3(0, 360));
+			if (i < 4)
+			{
+				// Rotations by 180 degrees have a trace of -1
+				q = Quaternion(i == 0 ? 1.0f : 0.0f, i == 1 ? 1.0f : 0.0f,
+				               i == 2 ? 1.0f : 0.0f, i == 3 ? 1.0f : 0.0f);
+			}
+			Quaternion converted(q.toMatrix());
+			if (std::fabs(std::fabs(converted.dot(q)) - 1.0f) > 1e-5f)
+				wrong++;
+		}
+		if (wrong != 0)
+		{
+			std::cout << "Quaternion(Mat4f): " << wrong << " wrong results."
+				<< std::endl;
+			errors++;
+		}
+	}
+	{
+		// Conversion from rotation/translation and to matrices
+		unsigned int wrong = 0;
+		for (unsigned int i = 0; i < 50; i++)
+		{
+			Quaternion rotation(randomVec3(0, 360));
+			Vec3f translation = randomVec3(-10, 10);
+			DualQuaternion dq(rotation, translation);
+			Mat4f expected = Mat4f::TransMat(translation) * rotation.toMatrix();
+			if (!isEqual(dq.toMatrix(), expected, 1e-5f))
+				wrong++;
+			if (!isEqual(dq.getTranslation(), translation, 1e-5f))
+				wrong++;
+			DualQuaternion fromMatrix(expected);
+			if (!isEqual(fromMatrix.toMatrix(), expected, 1e-4f))
+				wrong++;
+			Vec3f point = randomVec3(-10, 10);
+			if (!isEqual(dq.transformPoint(point), expected.transformPoint(point), 1e-4f))
+				wrong++;
+			// Composition
+			DualQuaternion other(Quaternion(randomVec3(0, 360)), randomVec3(-10, 10));
+			if (!isEqual((dq * other).toMatrix(), expected * other.toMatrix(), 1e-4f))
+				wrong++;
+		}
+		if (wrong != 0)
+		{
+			std::cout << "Conversion: " << wrong << " wrong results." << std::endl;
+			errors++;
+		}
+	}
+	{
+		// Blending
+		DualQuaternion a(Quaternion(Vec3f(0, 0, 0)), Vec3f(2, 0, 0));
+		DualQuaternion b(Quaternion(Vec3f(0, 0, 90)), Vec3f(2, 0, 0));
+		// The sign of a quaternion must not change the result
+		DualQuaternion dqs[2] = {a, b * -1.0f};
+		float weights[2] = {0.5f, 0.5f};
+		DualQuaternion blended = DualQuaternion::blend(dqs, weights, 2);
+		Mat4f expected = Mat4f::TransMat(Vec3f(2, 0, 0))
+		               * Quaternion(Vec3f(0, 0, 45)).toMatrix();
+		if (!isEqual(blended.toMatrix(), expected, 1e-5f)
+		 || std::fabs(blended.real.dot(blended.dual)) > 1e-6f)
+		{
+			std::cout << "blend() wrong." << std::endl;
+			errors++;
+		}
+	}
+	std::cout << errors << " errors." << std::endl;
+	return errors;
+}
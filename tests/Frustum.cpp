@@ -0,0 +1,358 @@
+/*
+Copyright (C) 2011, Mathias Gottschlag
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "GameMath.hpp"
+
+#include <cmath>
+#include <iostream>
+#include <vector>
+#include <cstdlib>
+#include <algorithm>
+
+using namespace math;
+
+static const char *names[] = {"outside", "intersecting", "inside"};
+
+static unsigned int checkBox(const Frustum &frustum,
+                             const BoundingBox &box,
+                             Frustum::Intersection expected,
+                             const char *description)
+{
+	Frustum::Intersection result = frustum.classify(box);
+	if (result != expected)
+	{
+		std::cout << "classify(): " << description << ": " << names[result]
+			<< " (correct: " << names[expected] << ")" << std::endl;
+		return 1;
+	}
+	if (frustum.isInside(box) != (expected != Frustum::Outside))
+	{
+		std::cout << "isInside(): " << description << std::endl;
+		return 1;
+	}
+	return 0;
+}
+
+static float polygonArea(const Vec3f *vertices, unsigned int count)
+{
+	Vec3f sum(0, 0, 0);
+	for (unsigned int i = 2; i < count; i++)
+		sum += (vertices[i - 1] - vertices[0]).cross(vertices[i] - vertices[0]);
+	return sum.getLength() * 0.5f;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int errors = 0;
+	// The camera looks along the negative z axis, the far plane is at z=-100
+	Frustum frustum(Mat4f::Perspective(2, 2, 1, 100));
+	{
+		// Points
+		if (!frustum.isInside(Vec3f(0, 0, -10)))
+		{
+			std::cout << "Point inside not detected." << std::endl;
+			errors++;
+		}
+		if (frustum.isInside(Vec3f(0, 0, 10)) || frustum.isInside(Vec3f(0, 0, -0.5f))
+		 || frustum.isInside(Vec3f(0, 0, -101)) || frustum.isInside(Vec3f(11, 0, -10))
+		 || frustum.isInside(Vec3f(0, -11, -10)))
+		{
+			std::cout << "Point outside not detected." << std::endl;
+			errors++;
+		}
+		// All normals have to point inside
+		for (unsigned int i = 0; i < 6; i++)
+		{
+			if (frustum.planes[i].getDistance(Vec3f(0, 0, -10)) <= 0)
+			{
+				std::cout << "Plane " << i << " points outside." << std::endl;
+				errors++;
+			}
+		}
+	}
+	{
+		// Corners, each corner has to be on three planes
+		static const unsigned int cornerPlanes[8][3] = {
+			{0, 1, 2}, {0, 2, 3}, {0, 3, 4}, {0, 4, 1},
+			{5, 1, 2}, {5, 2, 3}, {5, 3, 4}, {5, 4, 1}
+		};
+		Vec3f corners[8];
+		frustum.getCorners(corners);
+		for (unsigned int i = 0; i < 8; i++)
+		{
+			for (unsigned int j = 0; j < 3; j++)
+			{
+				float distance = frustum.planes[cornerPlanes[i][j]].getDistance(corners[i]);
+				if (distance > 0.01f || distance < -0.01f)
+				{
+					std::cout << "Corner " << i << " not on plane "
+						<< cornerPlanes[i][j] << ": " << distance << std::endl;
+					errors++;
+				}
+			}
+		}
+		if ((corners[0] - Vec3f(-1, 1, -1)).getSquaredLength() > 0.0001f)
+		{
+			std::cout << "Wrong corner: " << corners[0].x << "/" << corners[0].y
+				<< "/" << corners[0].z << std::endl;
+			errors++;
+		}
+		// The planes have to be normalized
+		for (unsigned int i = 0; i < 6; i++)
+		{
+			float length = frustum.planes[i].normal.getLength();
+			if (length > 1.0001f || length < 0.9999f)
+			{
+				std::cout << "Plane " << i << " not normalized." << std::endl;
+				errors++;
+			}
+		}
+	}
+	{
+		// Boxes
+		errors += checkBox(frustum, BoundingBox(Vec3f(-1, -1, -11), Vec3f(1, 1, -9)),
+		                   Frustum::Inside, "small box");
+		errors += checkBox(frustum, BoundingBox(Vec3f(-1, -1, -2), Vec3f(1, 1, 0)),
+		                   Frustum::Intersecting, "near plane");
+		errors += checkBox(frustum, BoundingBox(Vec3f(-1, -1, -101), Vec3f(1, 1, -99)),
+		                   Frustum::Intersecting, "far plane");
+		errors += checkBox(frustum, BoundingBox(Vec3f(5, -1, -11), Vec3f(15, 1, -9)),
+		                   Frustum::Intersecting, "right plane");
+		errors += checkBox(frustum, BoundingBox(Vec3f(-200, -200, -200), Vec3f(200, 200, 200)),
+		                   Frustum::Intersecting, "enclosing box");
+		errors += checkBox(frustum, BoundingBox(Vec3f(-1, -1, 1), Vec3f(1, 1, 3)),
+		                   Frustum::Outside, "behind the camera");
+		errors += checkBox(frustum, BoundingBox(Vec3f(-1, 20, -11), Vec3f(1, 22, -9)),
+		                   Frustum::Outside, "above");
+		errors += checkBox(frustum, BoundingBox(Vec3f(-1, -1, -300), Vec3f(1, 1, -200)),
+		                   Frustum::Outside, "behind the far plane");
+	}
+	{
+		// Batch culling, the results have to match isInside()
+		const unsigned int count = 1003;
+		std::vector<BoundingBox> boxes;
+		Vec3Streamf minCorners(count);
+		Vec3Streamf maxCorners(count);
+		for (unsigned int i = 0; i < count; i++)
+		{
+			// The offset prevents boxes from touching the planes exactly, as
+			// FMA can round differently there
+			Vec3f center((float)(rand() % 400 - 200) * 0.5f + 0.0137f,
+			             (float)(rand() % 400 - 200) * 0.5f + 0.0213f,
+			             (float)(rand() % 300 - 250) * 0.5f + 0.0371f);
+			Vec3f size((float)(rand() % 100) * 0.1f,
+			           (float)(rand() % 100) * 0.1f,
+			           (float)(rand() % 100) * 0.1f);
+			boxes.push_back(BoundingBox(center - size, center + size));
+			minCorners.set(i, center - size);
+			maxCorners.set(i, center + size);
+		}
+		uint32 mask[(count + 31) / 32];
+		uint32 soamask[(count + 31) / 32];
+		frustum.cullBoxes(&boxes[0], count, mask);
+		frustum.cullBoxes(minCorners, maxCorners, soamask);
+		uint32 indices[count];
+		size_t visible = Frustum::getVisibleIndices(mask, count, indices);
+		size_t expectedVisible = 0;
+		for (unsigned int i = 0; i < count; i++)
+		{
+			bool expected = frustum.isInside(boxes[i]);
+			if (((mask[i / 32] >> (i % 32)) & 1) != (expected ? 1u : 0u))
+			{
+				std::cout << "cullBoxes(): " << i << std::endl;
+				errors++;
+			}
+			if (((soamask[i / 32] >> (i % 32)) & 1) != (expected ? 1u : 0u))
+			{
+				std::cout << "cullBoxes() (SoA): " << i << std::endl;
+				errors++;
+			}
+			if (expected)
+			{
+				if (expectedVisible >= visible || indices[expectedVisible] != i)
+				{
+					std::cout << "getVisibleIndices(): " << i << std::endl;
+					errors++;
+				}
+				expectedVisible++;
+			}
+		}
+		// Plane cache, evaluated twice to use the cached planes
+		std::vector<uint8> planeCache(count, 0);
+		for (unsigned int frame = 0; frame < 2; frame++)
+		{
+			uint32 cachedmask[(count + 31) / 32];
+			frustum.cullBoxes(&boxes[0], count, cachedmask, &planeCache[0]);
+			for (unsigned int i = 0; i < (count + 31) / 32; i++)
+			{
+				if (cachedmask[i] != mask[i])
+				{
+					std::cout << "cullBoxes() (plane cache): " << i << std::endl;
+					errors++;
+				}
+			}
+		}
+		// Hierarchical culling, every box is split into eight children
+		for (unsigned int i = 0; i < count; i++)
+		{
+			unsigned int childMask;
+			uint8 cache = 0;
+			if (frustum.classify(boxes[i], cache, Frustum::AllPlanes, &childMask) == Frustum::Outside)
+				continue;
+			Vec3f center = boxes[i].getCenter();
+			for (unsigned int j = 0; j < 8; j++)
+			{
+				BoundingBox child(center);
+				child.minCorner = Vec3f(std::min(center.x, boxes[i].getCorner(j).x),
+				                        std::min(center.y, boxes[i].getCorner(j).y),
+				                        std::min(center.z, boxes[i].getCorner(j).z));
+				child.maxCorner = Vec3f(std::max(center.x, boxes[i].getCorner(j).x),
+				                        std::max(center.y, boxes[i].getCorner(j).y),
+				                        std::max(center.z, boxes[i].getCorner(j).z));
+				uint8 childCache = 0;
+				if (frustum.classify(child, childCache, childMask) != frustum.classify(child))
+				{
+					std::cout << "classify() (plane mask): " << i << "/" << j << std::endl;
+					errors++;
+				}
+			}
+		}
+		if (visible != expectedVisible || (mask[count / 32] >> (count % 32)) != 0
+		 || (soamask[count / 32] >> (count % 32)) != 0)
+		{
+			std::cout << "getVisibleIndices(): Wrong count." << std::endl;
+			errors++;
+		}
+	}
+	{
+		// Polygon clipping, a large triangle at z=-10 is clipped to the
+		// cross section of the frustum
+		Vec3f triangle[3] = {
+			Vec3f(-100, -100, -10), Vec3f(100, -100, -10), Vec3f(0, 100, -10)
+		};
+		Vec3f result[9];
+		Vec3f scratch[9];
+		unsigned int count = frustum.clipPolygon(triangle, 3, result, scratch, 9);
+		if (count != 4 || std::fabs(polygonArea(result, count) - 400.0f) > 0.01f)
+		{
+			std::cout << "clipPolygon: Wrong result (" << count << " vertices)."
+				<< std::endl;
+			errors++;
+		}
+		Vec3f outside[3] = {
+			Vec3f(-1, -1, 5), Vec3f(1, -1, 5), Vec3f(0, 1, 5)
+		};
+		if (frustum.clipPolygon(outside, 3, result, scratch, 9) != 0)
+		{
+			std::cout << "clipPolygon: Polygon outside not removed." << std::endl;
+			errors++;
+		}
+	}
+	{
+		// Degenerate triangle at the corner of a frustum which rounding
+		// turns into a non-convex polygon during clipping
+		Frustum corner(Mat4f::Perspective(2, 2, 1, 100));
+		Vec3f triangle[3] = {
+			Vec3f(-0.999995887f, -1.00000226f, -0.999993682f),
+			Vec3f(-1.00000656f, -0.999998629f, -1.00000978f),
+			Vec3f(-1.0f, -1.00000083f, -0.99999994f)
+		};
+		std::vector<Vec3f> result;
+		unsigned int outputCount = corner.clipTriangles(triangle, 1, result);
+		bool inside = true;
+		for (unsigned int i = 0; i < result.size(); i++)
+		{
+			for (unsigned int j = 0; j < 6; j++)
+				inside = inside && corner.planes[j].getDistance(result[i]) > -1e-4f;
+		}
+		if (result.size() != 3 * outputCount || !inside)
+		{
+			std::cout << "clipTriangles: Degenerate triangle failed." << std::endl;
+			errors++;
+		}
+	}
+	{
+		// Batch triangle clipping, the results have to match clipPolygon()
+		const unsigned int triangleCount = 200;
+		std::vector<Vec3f> vertices(3 * triangleCount);
+		srand(11);
+		for (unsigned int i = 0; i < triangleCount; i++)
+		{
+			Vec3f center((float)(rand() % 301 - 150) / 10.0f,
+			             (float)(rand() % 301 - 150) / 10.0f,
+			             -(float)(rand() % 1100) / 10.0f);
+			for (unsigned int j = 0; j < 3; j++)
+			{
+				vertices[3 * i + j] = center
+					+ Vec3f((float)(rand() % 201 - 100) / 10.0f,
+					        (float)(rand() % 201 - 100) / 10.0f,
+					        (float)(rand() % 201 - 100) / 10.0f);
+			}
+		}
+		std::vector<Vec3f> result;
+		std::vector<uint32> sources;
+		unsigned int outputCount = frustum.clipTriangles(&vertices[0],
+		                                                 triangleCount,
+		                                                 result,
+		                                                 &sources);
+		std::vector<float> expectedArea(triangleCount, 0.0f);
+		unsigned int clipped = 0;
+		for (unsigned int i = 0; i < triangleCount; i++)
+		{
+			Vec3f polygon[Frustum::MaxClipVertices];
+			Vec3f scratch[Frustum::MaxClipVertices];
+			unsigned int count = frustum.clipPolygon(&vertices[3 * i], 3,
+			                                         polygon, scratch,
+			                                         Frustum::MaxClipVertices);
+			expectedArea[i] = polygonArea(polygon, count);
+			if (count != 0 && count != 3)
+				clipped++;
+		}
+		std::vector<float> area(triangleCount, 0.0f);
+		unsigned int wrong = 0;
+		for (unsigned int i = 0; i < outputCount && i < sources.size(); i++)
+		{
+			area[sources[i]] += polygonArea(&result[3 * i], 3);
+			for (unsigned int j = 0; j < 6; j++)
+			{
+				for (unsigned int k = 0; k < 3; k++)
+				{
+					if (frustum.planes[j].getDistance(result[3 * i + k]) < -1e-3f)
+						wrong++;
+				}
+			}
+		}
+		for (unsigned int i = 0; i < triangleCount; i++)
+		{
+			if (std::fabs(area[i] - expectedArea[i]) > 1e-3f * (1.0f + expectedArea[i]))
+				wrong++;
+		}
+		if (wrong != 0 || result.size() != 3 * outputCount
+			|| sources.size() != outputCount || clipped == 0)
+		{
+			std::cout << "clipTriangles: " << wrong << " wrong results."
+				<< std::endl;
+			errors++;
+		}
+	}
+	std::cout << errors << " errors." << std::endl;
+	return errors;
+}
@@ -0,0 +1,1146 @@
+/*
+Copyright (C) 2011, Mathias Gottschlag
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+ * Microbenchmark suite for the public GameMath operations. Every benchmark
+ * runs an operation on arrays of random input data and reports the time per
+ * operation. The results can be printed as text, CSV or JSON so that results
+ * of different versions can be compared. All formats record the SIMD
+ * configuration and the number of iterations along with the timings.
+ *
+ * Usage: GameMathBench [--iterations N] [--format text|csv|json] [filter]
+ * Only benchmarks containing the filter string in their name are run.
+ */
+
+#include "GameMath.hpp"
+#include "Benchmark.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace math;
+
+static const unsigned int count = 1024;
+
+static float randomFloat(float min, float max)
+{
+	return min + (max - min) * (float)rand() / (float)RAND_MAX;
+}
+
+static Vec3f randomVec3(float min, float max)
+{
+	return Vec3f(randomFloat(min, max), randomFloat(min, max),
+	             randomFloat(min, max));
+}
+
+/**
+ * Input data and output buffers shared by all benchmarks.
+ */
+struct BenchmarkData
+{
+	BenchmarkData()
+		: points(count), directions(count), pointStream(count),
+		directionStream(count), boxMin(count), boxMax(count),
+		triangleVertices(3 * count), triangle0(count), triangle1(count),
+		triangle2(count), boneIndices(4 * count), boneWeights(4 * count),
+		dualQuaternions(count),
+		octree(BoundingBox(Vec3f(-110, -110, -110), Vec3f(110, 110, 110))),
+		normalResults(count)
+	{
+		for (unsigned int i = 0; i < count; i++)
+		{
+			Mat4f rotation = Mat4f::EulerRotation(randomVec3(0, 360));
+			rigid[i] = Mat4f::TransMat(randomVec3(-10, 10)) * rotation;
+			for (unsigned int j = 0; j < 16; j++)
+				matrices[i].m[j] = randomFloat(-2, 2);
+			affine[i] = Affine3f(rigid[i]);
+			vectors[i] = Vec4f(randomFloat(-10, 10), randomFloat(-10, 10),
+			                   randomFloat(-10, 10), 1);
+			points[i] = randomVec3(-100, 100);
+			directions[i] = randomVec3(-1, 1);
+			euler[i] = randomVec3(0, 360);
+			quaternions[i] = Quaternion(euler[i]);
+			Vec3f normal = randomVec3(-1, 1);
+			normal.normalize();
+			planes[i] = Plane(normal, randomFloat(-10, 10));
+			Vec3f center = randomVec3(-100, 100);
+			Vec3f size = randomVec3(0.5f, 10);
+			boxes[i] = BoundingBox(center - size, center + size);
+			boxMin.set(i, boxes[i].minCorner);
+			boxMax.set(i, boxes[i].maxCorner);
+			for (unsigned int j = 0; j < 3; j++)
+				triangleVertices[3 * i + j] = center + randomVec3(-10, 10);
+			triangle0.set(i, triangleVertices[3 * i]);
+			triangle1.set(i, triangleVertices[3 * i + 1]);
+			triangle2.set(i, triangleVertices[3 * i + 2]);
+			dualQuaternions[i] = DualQuaternion(rigid[i]);
+			for (unsigned int j = 0; j < 4; j++)
+			{
+				boneIndices[4 * i + j] = (uint16)(rand() % count);
+				boneWeights[4 * i + j] = 0.25f;
+			}
+		}
+		pointStream.assign(points);
+		directionStream.assign(directions);
+		frustum.setProjectionMatrix(Mat4f::PerspectiveFOV(60, 1.333f, 1, 100)
+		                            * Mat4f::EulerRotation(Vec3f(10, 30, 0)));
+		bvh.build(boxes, count);
+		for (unsigned int i = 0; i < count; i++)
+			octree.insert(boxes[i]);
+	}
+
+	Mat4f matrices[count];
+	Mat4f rigid[count];
+	Affine3f affine[count];
+	Vec4f vectors[count];
+	std::vector<Vec3f> points;
+	std::vector<Vec3f> directions;
+	Vec3Streamf pointStream;
+	Vec3Streamf directionStream;
+	Vec3f euler[count];
+	Quaternion quaternions[count];
+	Plane planes[count];
+	BoundingBox boxes[count];
+	Vec3Streamf boxMin;
+	Vec3Streamf boxMax;
+	std::vector<Vec3f> triangleVertices;
+	Vec3Streamf triangle0;
+	Vec3Streamf triangle1;
+	Vec3Streamf triangle2;
+	std::vector<uint16> boneIndices;
+	std::vector<float> boneWeights;
+	std::vector<DualQuaternion> dualQuaternions;
+	Frustum frustum;
+	Bvh bvh;
+	LooseOctree octree;
+
+	Mat4f matrixResults[count];
+	Mat4f skinningResults[count];
+	Affine3f affineResults[count];
+	Vec3f vectorResults[count];
+	std::vector<Vec3f> normalResults;
+	uint16 halfResults[3 * count];
+	PackedQuaternion32 packedQuaternions[count];
+	QuantizedVec3 quantizedResults[count];
+	Quaternion quaternionResults[count];
+	BoundingBox boxResults[count];
+	Ray::TriangleHit triangleHits[count];
+	float floatResults[count];
+	uint8 sideResults[count];
+	uint32 mask[(count + 31) / 32];
+	std::vector<uint32> indexResults;
+	std::vector<Vec3f> clippedTriangles;
+	Vec3Streamf streamResult;
+};
+
+typedef double (*BenchmarkFunction)(BenchmarkData &data,
+                                    unsigned int iterations);
+
+/**
+ * Returns the time per operation for a measurement over count operations per
+ * iteration.
+ */
+static double perOperation(double start, unsigned int iterations)
+{
+	return (getTime() - start) / ((double)iterations * count);
+}
+
+static double benchMat4Mul(BenchmarkData &data, unsigned int iterations)
+{
+	double start = getTime();
+	for (unsigned int n = 0; n < iterations; n++)
+		for (unsigned int i = 0; i < count; i++)
+			data.matrixResults[i] = data.matrices[i] * data.matrices[(i + n) % count];
+	double time = perOperation(start, iterations);
+	doNotOptimize(data.matrixResults[count / 2]);
+	return time;
+}
+
+static double benchMat4MulVec4(BenchmarkData &data, unsigned int iterations)
+{
+	Vec4f sum;
+	double start = getTime();
+	for (unsigned int n = 0; n < iterations; n++)
+		for (unsigned int i = 0; i < count; i++)
+			sum += data.matrices[(i + n) % count] * data.vectors[i];
+	double time = perOperation(start, iterations);
+	doNotOptimize(sum);
+	return time;
+}
+
+static double benchMat4Inverse(BenchmarkData &data, unsigned int iterations)
+{
+	double start = getTime();
+	for (unsigned int n = 0; n < iterations; n++)
+		for (unsigned int i = 0; i < count; i++)
+			data.matrixResults[i] = data.matrices[(i + n) % count].inverse();
+	double time = perOperation(start, iterations);
+	doNotOptimize(data.matrixResults[count / 2]);
+	return time;
+}
+
+static double benchMat4InverseAffine(BenchmarkData &data, unsigned int iterations)
+{
+	double start = getTime();
+	for (unsigned int n = 0; n < iterations; n++)
+		for (unsigned int i = 0; i < count; i++)
+			data.matrixResults[i] = data.rigid[(i + n) % count].inverseAffine();
+	double time = perOperation(start, iterations);
+	doNotOptimize(data.matrixResults[count / 2]);
+	return time;
+}
+
+static double benchMat4InverseRigid(BenchmarkData &data, unsigned int iterations)
+{
+	double start = getTime();
+	for (unsigned int n = 0; n < iterations; n++)
+		for (unsigned int i = 0; i < count; i++)
+			data.matrixResults[i] = data.rigid[(i + n) % count].inverseRigid();
+	double time = perOperation(start, iterations);
+	doNotOptimize(data.matrixResults[count / 2]);
+	return time;
+}
+
+static double benchMat4Transpose(BenchmarkData &data, unsigned int iterations)
+{
+	double start = getTime();
+	for (unsigned int n = 0; n < iterations; n++)
+		for (unsigned int i = 0; i < count; i++)
+			data.matrixResults[i] = data.matrices[(i + n) % count].transposed();
+	double time = perOperation(start, iterations);
+	doNotOptimize(data.matrixResults[count / 2]);
+	return time;
+}
+
+static double benchMat4TransformPoint(BenchmarkData &data, unsigned int iterations)
+{
+	double start = getTime();
+	for (unsigned int n = 0; n < iterations; n++)
+	{
+		const Mat4f &m = data.matrices[n % count];
+		for (unsigned int i = 0; i < count; i++)
+			data.vectorResults[i] = m.transformPoint(data.points[i]);
+	}
+	double time = perOperation(start, iterations);
+	doNotOptimize(data.vectorResults[count / 2]);
+	return time;
+}
+
+static double benchMat4TransformPoints(BenchmarkData &data, unsigned int iterations)
+{
+	double start = getTime();
+	for (unsigned int n = 0; n < iterations; n++)
+		data.matrices[n % count].transformPoints(&data.points[0],
+		                                         data.vectorResults, count);
+	double time = perOperation(start, iterations);
+	doNotOptimize(data.vectorResults[count / 2]);
+	return time;
+}
+
+static double benchAffine3Mul(BenchmarkData &data, unsigned int iterations)
+{
+	double start = getTime();
+	for (unsigned int n = 0; n < iterations; n++)
+		for (unsigned int i = 0; i < count; i++)
+			data.affineResults[i] = data.affine[i] * data.affine[(i + n) % count];
+	double time = perOperation(start, iterations);
+	doNotOptimize(data.affineResults[count / 2]);
+	return time;
+}
+
+static double benchAffine3Inverse(BenchmarkData &data, unsigned int iterations)
+{
+	double start = getTime();
+	for (unsigned int n = 0; n < iterations; n++)
+		for (unsigned int i = 0; i < count; i++)
+			data.affineResults[i] = data.affine[(i + n) % count].inverse();
+	double time = perOperation(start, iterations);
+	doNotOptimize(data.affineResults[count / 2]);
+	return time;
+}
+
+static double benchVec3Add(BenchmarkData &data, unsigned int iterations)
+{
+	double start = getTime();
+	for (unsigned int n = 0; n < iterations; n++)
+		for (unsigned int i = 0; i < count; i++)
+			data.vectorResults[i] = data.points[i] + data.directions[(i + n) % count];
+	double time = perOperation(start, iterations);
+	doNotOptimize(data.vectorResults[count / 2]);
+	return time;
+}
+
+static double benchVec3Dot(BenchmarkData &data, unsigned int iterations)
+{
+	double start = getTime();
+	for (unsigned int n = 0; n < iterations; n++)
+		for (unsigned int i = 0; i < count; i++)
+			data.floatResults[i] = data.points[i].dot(data.directions[(i + n) % count]);
+	double time = perOperation(start, iterations);
+	doNotOptimize(data.floatResults[count / 2]);
+	return time;
+}
+
+static double benchVec3Cross(BenchmarkData &data, unsigned int iterations)
+{
+	double start = getTime();
+	for (unsigned int n = 0; n < iterations; n++)
+		for (unsigned int i = 0; i < count; i++)
+			data.vectorResults[i] = data.points[i].cross(data.directions[(i + n) % count]);
+	double time = perOperation(start, iterations);
+	doNotOptimize(data.vectorResults[count / 2]);
+	return time;
+}
+
+static double benchVec3Normalize(BenchmarkData &data, unsigned int iterations)
+{
+	double start = getTime();
+	for (unsigned int n = 0; n < iterations; n++)
+	{
+		for (unsigned int i = 0; i < count; i++)
+		{
+			data.vectorResults[i] = data.points[(i + n) % count];
+			data.vectorResults[i].normalize();
+		}
+	}
+	double time = perOperation(start, iterations);
+	doNotOptimize(data.vectorResults[count / 2]);
+	return time;
+}
+
+static double benchVec3StreamDot(BenchmarkData &data, unsigned int iterations)
+{
+	double start = getTime();
+	for (unsigned int n = 0; n < iterations; n++)
+		data.pointStream.dot(data.directionStream, data.floatResults);
+	double time = perOperation(start, iterations);
+	doNotOptimize(data.floatResults[count / 2]);
+	return time;
+}
+
+static double benchVec3StreamCross(BenchmarkData &data, unsigned int iterations)
+{
+	double start = getTime();
+	for (unsigned int n = 0; n < iterations; n++)
+		data.pointStream.cross(data.directionStream, data.streamResult);
+	double time = perOperation(start, iterations);
+	doNotOptimize(data.streamResult.x[count / 2]);
+	return time;
+}
+
+static double benchVec3StreamNormalize(BenchmarkData &data, unsigned int iterations)
+{
+	double start = getTime();
+	for (unsigned int n = 0; n < iterations; n++)
+	{
+		// The copy keeps the input from converging to unit vectors, it is
+		// included in the measured time
+		data.streamResult = data.pointStream;
+		data.streamResult.normalize();
+	}
+	double time = perOperation(start, iterations);
+	doNotOptimize(data.streamResult.x[count / 2]);
+	return time;
+}
+
+static double benchQuaternionFromEuler(BenchmarkData &data, unsigned int iterations)
+{
+	double start = getTime();
+	for (unsigned int n = 0; n < iterations; n++)
+		for (unsigned int i = 0; i < count; i++)
+			data.quaternionResults[i] = Quaternion(data.euler[(i + n) % count]);
+	double time = perOperation(start, iterations);
+	doNotOptimize(data.quaternionResults[count / 2]);
+	return time;
+}
+
+static double benchQuaternionToMatrix(BenchmarkData &data, unsigned int iterations)
+{
+	double start = getTime();
+	for (unsigned int n = 0; n < iterations; n++)
+		for (unsigned int i = 0; i < count; i++)
+			data.matrixResults[i] = data.quaternions[(i + n) % count].toMatrix();
+	double time = perOperation(start, iterations);
+	doNotOptimize(data.matrixResults[count / 2]);
+	return time;
+}
+
+static double benchQuaternionMul(BenchmarkData &data, unsigned int iterations)
+{
+	double start = getTime();
+	for (unsigned int n = 0; n < iterations; n++)
+		for (unsigned int i = 0; i < count; i++)
+			data.quaternionResults[i] = data.quaternions[i]
+			                          * data.quaternions[(i + n + 1) % count];
+	double time = perOperation(start, iterations);
+	doNotOptimize(data.quaternionResults[count / 2]);
+	return time;
+}
+
+static double benchQuaternionRotate(BenchmarkData &data, unsigned int iterations)
+{
+	double start = getTime();
+	for (unsigned int n = 0; n < iterations; n++)
+		for (unsigned int i = 0; i < count; i++)
+			data.vectorResults[i] = data.quaternions[(i + n) % count].rotate(data.points[i]);
+	double time = perOperation(start, iterations);
+	doNotOptimize(data.vectorResults[count / 2]);
+	return time;
+}
+
+static double benchQuaternionRotateArray(BenchmarkData &data, unsigned int iterations)
+{
+	double start = getTime();
+	for (unsigned int n = 0; n < iterations; n++)
+		data.quaternions[n % count].rotate(&data.points[0], data.vectorResults, count);
+	double time = perOperation(start, iterations);
+	doNotOptimize(data.vectorResults[count / 2]);
+	return time;
+}
+
+static double benchQuaternionSlerp(BenchmarkData &data, unsigned int iterations)
+{
+	double start = getTime();
+	for (unsigned int n = 0; n < iterations; n++)
+		for (unsigned int i = 0; i < count; i++)
+			data.quaternionResults[i].slerp(data.quaternions[i],
+			                                data.quaternions[(i + n + 1) % count],
+			                                0.3f);
+	double time = perOperation(start, iterations);
+	doNotOptimize(data.quaternionResults[count / 2]);
+	return time;
+}
+
+static double benchQuaternionNlerpArray(BenchmarkData &data, unsigned int iterations)
+{
+	double start = getTime();
+	for (unsigned int n = 0; n < iterations; n++)
+		Quaternion::nlerp(data.quaternions, data.quaternionResults, 0.3f,
+		                  data.quaternionResults, count);
+	double time = perOperation(start, iterations);
+	doNotOptimize(data.quaternionResults[count / 2]);
+	return time;
+}
+
+static double benchQuaternionFastSlerpArray(BenchmarkData &data, unsigned int iterations)
+{
+	double start = getTime();
+	for (unsigned int n = 0; n < iterations; n++)
+		Quaternion::fastSlerp(data.quaternions, data.quaternionResults, 0.3f,
+		                      data.quaternionResults, count);
+	double time = perOperation(start, iterations);
+	doNotOptimize(data.quaternionResults[count / 2]);
+	return time;
+}
+
+static double benchSkeletonComputePalettes(BenchmarkData &data, unsigned int iterations)
+{
+	// Skeletons with 64 bones, every bone has one of the previous 16 bones as
+	// its parent
+	std::vector<uint32> parents(count);
+	for (unsigned int i = 0; i < count; i++)
+		parents[i] = i % 64 == 0 ? Skeleton::NoParent : i - 1 - (i * 7) % (i % 64 < 16 ? i % 64 : 16);
+	Skeleton skeleton(&parents[0], data.rigid, count);
+	double start = getTime();
+	for (unsigned int n = 0; n < iterations; n++)
+		skeleton.computePalettes(data.quaternions, &data.points[0],
+		                         &data.directions[0], data.matrixResults,
+		                         data.skinningResults);
+	double time = perOperation(start, iterations);
+	doNotOptimize(data.skinningResults[count / 2]);
+	return time;
+}
+
+static double benchSkinLinear(BenchmarkData &data, unsigned int iterations)
+{
+	double start = getTime();
+	for (unsigned int n = 0; n < iterations; n++)
+		skinLinear(data.rigid, &data.boneIndices[0], &data.boneWeights[0],
+		           &data.points[0], data.vectorResults, count,
+		           &data.directions[0], &data.normalResults[0]);
+	double time = perOperation(start, iterations);
+	doNotOptimize(data.vectorResults[count / 2]);
+	return time;
+}
+
+static double benchSkinDualQuaternion(BenchmarkData &data, unsigned int iterations)
+{
+	double start = getTime();
+	for (unsigned int n = 0; n < iterations; n++)
+		skinDualQuaternion(&data.dualQuaternions[0], &data.boneIndices[0],
+		                   &data.boneWeights[0], &data.points[0],
+		                   data.vectorResults, count, &data.directions[0],
+		                   &data.normalResults[0]);
+	double time = perOperation(start, iterations);
+	doNotOptimize(data.vectorResults[count / 2]);
+	return time;
+}
+
+static double benchFloatsToHalves(BenchmarkData &data, unsigned int iterations)
+{
+	double start = getTime();
+	for (unsigned int n = 0; n < iterations; n++)
+		floatsToHalves(&data.points[0].x, data.halfResults, 3 * count);
+	double time = perOperation(start, iterations) / 3;
+	doNotOptimize(data.halfResults[count / 2]);
+	return time;
+}
+
+static double benchHalvesToFloats(BenchmarkData &data, unsigned int iterations)
+{
+	floatsToHalves(&data.points[0].x, data.halfResults, 3 * count);
+	double start = getTime();
+	for (unsigned int n = 0; n < iterations; n++)
+		halvesToFloats(data.halfResults, &data.vectorResults[0].x, 3 * count);
+	double time = perOperation(start, iterations) / 3;
+	doNotOptimize(data.vectorResults[count / 2]);
+	return time;
+}
+
+static double benchPackQuaternion32(BenchmarkData &data, unsigned int iterations)
+{
+	double start = getTime();
+	for (unsigned int n = 0; n < iterations; n++)
+		PackedQuaternion32::pack(data.quaternions, data.packedQuaternions, count);
+	double time = perOperation(start, iterations);
+	doNotOptimize(data.packedQuaternions[count / 2]);
+	return time;
+}
+
+static double benchUnpackQuaternion32(BenchmarkData &data, unsigned int iterations)
+{
+	PackedQuaternion32::pack(data.quaternions, data.packedQuaternions, count);
+	double start = getTime();
+	for (unsigned int n = 0; n < iterations; n++)
+		PackedQuaternion32::unpack(data.packedQuaternions, data.quaternionResults, count);
+	double time = perOperation(start, iterations);
+	doNotOptimize(data.quaternionResults[count / 2]);
+	return time;
+}
+
+static double benchVec3Quantize(BenchmarkData &data, unsigned int iterations)
+{
+	Vec3Quantizer quantizer(BoundingBox(Vec3f(-100, -100, -100), Vec3f(100, 100, 100)));
+	double start = getTime();
+	for (unsigned int n = 0; n < iterations; n++)
+		quantizer.quantize(&data.points[0], data.quantizedResults, count);
+	double time = perOperation(start, iterations);
+	doNotOptimize(data.quantizedResults[count / 2]);
+	return time;
+}
+
+static double benchVec3Dequantize(BenchmarkData &data, unsigned int iterations)
+{
+	Vec3Quantizer quantizer(BoundingBox(Vec3f(-100, -100, -100), Vec3f(100, 100, 100)));
+	quantizer.quantize(&data.points[0], data.quantizedResults, count);
+	double start = getTime();
+	for (unsigned int n = 0; n < iterations; n++)
+		quantizer.dequantize(data.quantizedResults, data.vectorResults, count);
+	double time = perOperation(start, iterations);
+	doNotOptimize(data.vectorResults[count / 2]);
+	return time;
+}
+
+static double benchPlaneDistance(BenchmarkData &data, unsigned int iterations)
+{
+	double start = getTime();
+	for (unsigned int n = 0; n < iterations; n++)
+		for (unsigned int i = 0; i < count; i++)
+			data.floatResults[i] = data.planes[(i + n) % count].getDistance(data.points[i]);
+	double time = perOperation(start, iterations);
+	doNotOptimize(data.floatResults[count / 2]);
+	return time;
+}
+
+static double benchPlaneClassifyPoints(BenchmarkData &data, unsigned int iterations)
+{
+	double start = getTime();
+	for (unsigned int n = 0; n < iterations; n++)
+		data.planes[n % count].classifyPoints(&data.points[0], count,
+		                                      data.floatResults,
+		                                      data.sideResults);
+	double time = perOperation(start, iterations);
+	doNotOptimize(data.sideResults[count / 2]);
+	return time;
+}
+
+static double benchPlaneIntersectWithLineSegments(BenchmarkData &data, unsigned int iterations)
+{
+	double start = getTime();
+	size_t hits = 0;
+	for (unsigned int n = 0; n < iterations; n++)
+		hits += data.planes[n % count].intersectWithLineSegments(&data.points[0],
+		                                                         &data.triangleVertices[0],
+		                                                         count,
+		                                                         data.vectorResults,
+		                                                         data.mask);
+	double time = perOperation(start, iterations);
+	doNotOptimize(hits);
+	return time;
+}
+
+static double benchBoundingBoxTransform(BenchmarkData &data, unsigned int iterations)
+{
+	double start = getTime();
+	for (unsigned int n = 0; n < iterations; n++)
+	{
+		const Mat4f &m = data.rigid[n % count];
+		for (unsigned int i = 0; i < count; i++)
+			data.boxResults[i] = data.boxes[i].transform(m);
+	}
+	double time = perOperation(start, iterations);
+	doNotOptimize(data.boxResults[count / 2]);
+	return time;
+}
+
+static double benchBoundingBoxTransformBoxes(BenchmarkData &data, unsigned int iterations)
+{
+	double start = getTime();
+	for (unsigned int n = 0; n < iterations; n++)
+		BoundingBox::transformBoxes(data.boxes, data.rigid[n % count],
+		                            data.boxResults, count);
+	double time = perOperation(start, iterations);
+	doNotOptimize(data.boxResults[count / 2]);
+	return time;
+}
+
+static double benchBoundingBoxTransformBoxesPerBox(BenchmarkData &data, unsigned int iterations)
+{
+	double start = getTime();
+	for (unsigned int n = 0; n < iterations; n++)
+		BoundingBox::transformBoxes(data.boxes, data.rigid, data.boxResults, count);
+	double time = perOperation(start, iterations);
+	doNotOptimize(data.boxResults[count / 2]);
+	return time;
+}
+
+static double benchFrustumIsInsidePoint(BenchmarkData &data, unsigned int iterations)
+{
+	unsigned int inside = 0;
+	double start = getTime();
+	for (unsigned int n = 0; n < iterations; n++)
+		for (unsigned int i = 0; i < count; i++)
+			inside += data.frustum.isInside(data.points[i]);
+	double time = perOperation(start, iterations);
+	doNotOptimize(inside);
+	return time;
+}
+
+static double benchFrustumClassify(BenchmarkData &data, unsigned int iterations)
+{
+	unsigned int visible = 0;
+	double start = getTime();
+	for (unsigned int n = 0; n < iterations; n++)
+		for (unsigned int i = 0; i < count; i++)
+			visible += data.frustum.classify(data.boxes[i]);
+	double time = perOperation(start, iterations);
+	doNotOptimize(visible);
+	return time;
+}
+
+static double benchFrustumCullBoxes(BenchmarkData &data, unsigned int iterations)
+{
+	double start = getTime();
+	for (unsigned int n = 0; n < iterations; n++)
+		data.frustum.cullBoxes(data.boxes, count, data.mask);
+	double time = perOperation(start, iterations);
+	doNotOptimize(data.mask[0]);
+	return time;
+}
+
+static double benchFrustumCullBoxesSoA(BenchmarkData &data, unsigned int iterations)
+{
+	double start = getTime();
+	for (unsigned int n = 0; n < iterations; n++)
+		data.frustum.cullBoxes(data.boxMin, data.boxMax, data.mask);
+	double time = perOperation(start, iterations);
+	doNotOptimize(data.mask[0]);
+	return time;
+}
+
+static double benchFrustumClipTriangles(BenchmarkData &data, unsigned int iterations)
+{
+	double start = getTime();
+	unsigned int triangles = 0;
+	for (unsigned int n = 0; n < iterations; n++)
+	{
+		data.clippedTriangles.clear();
+		triangles += data.frustum.clipTriangles(&data.triangleVertices[0], count,
+		                                        data.clippedTriangles);
+	}
+	double time = perOperation(start, iterations);
+	doNotOptimize(triangles);
+	return time;
+}
+
+static double benchRayIntersect(BenchmarkData &data, unsigned int iterations)
+{
+	Ray ray(data.points[0], data.directions[0]);
+	unsigned int hits = 0;
+	double start = getTime();
+	for (unsigned int n = 0; n < iterations; n++)
+	{
+		for (unsigned int i = 0; i < count; i++)
+			hits += ray.intersect(data.boxes[i], 1000.0f) ? 1 : 0;
+	}
+	double time = perOperation(start, iterations);
+	doNotOptimize(hits);
+	return time;
+}
+
+static double benchRayIntersectStream(BenchmarkData &data, unsigned int iterations)
+{
+	Ray ray(data.points[0], data.directions[0]);
+	double start = getTime();
+	for (unsigned int n = 0; n < iterations; n++)
+		ray.intersect(data.boxMin, data.boxMax, 1000.0f, data.mask);
+	double time = perOperation(start, iterations);
+	doNotOptimize(data.mask[0]);
+	return time;
+}
+
+static double benchRayPacketIntersect(BenchmarkData &data, unsigned int iterations)
+{
+	Ray rays[SimdFloat::Width];
+	for (unsigned int i = 0; i < SimdFloat::Width; i++)
+		rays[i] = Ray(data.points[0], data.directions[i]);
+	RayPacket<SimdFloat> packet(rays);
+	SimdFloat maxDistance(1000.0f);
+	int hits = 0;
+	double start = getTime();
+	for (unsigned int n = 0; n < iterations; n++)
+	{
+		for (unsigned int i = 0; i < count; i++)
+			hits |= packet.intersect(data.boxes[i], maxDistance);
+	}
+	double time = perOperation(start, iterations);
+	doNotOptimize(hits);
+	return time;
+}
+
+static double benchRayTriangle(BenchmarkData &data, unsigned int iterations)
+{
+	Ray ray(data.points[0], data.directions[0] * 100.0f);
+	unsigned int hits = 0;
+	double start = getTime();
+	for (unsigned int n = 0; n < iterations; n++)
+	{
+		const Vec3f *v = &data.triangleVertices[0];
+		for (unsigned int i = 0; i < count; i++)
+			hits += ray.intersectTriangle(v[3 * i], v[3 * i + 1], v[3 * i + 2], 1.0f) ? 1 : 0;
+	}
+	double time = perOperation(start, iterations);
+	doNotOptimize(hits);
+	return time;
+}
+
+static double benchRayTriangleWatertight(BenchmarkData &data, unsigned int iterations)
+{
+	Ray ray(data.points[0], data.directions[0] * 100.0f);
+	unsigned int hits = 0;
+	double start = getTime();
+	for (unsigned int n = 0; n < iterations; n++)
+	{
+		const Vec3f *v = &data.triangleVertices[0];
+		for (unsigned int i = 0; i < count; i++)
+			hits += ray.intersectTriangleWatertight(v[3 * i], v[3 * i + 1], v[3 * i + 2], 1.0f) ? 1 : 0;
+	}
+	double time = perOperation(start, iterations);
+	doNotOptimize(hits);
+	return time;
+}
+
+static double benchRayTriangleStream(BenchmarkData &data, unsigned int iterations)
+{
+	Ray ray(data.points[0], data.directions[0] * 100.0f);
+	double start = getTime();
+	for (unsigned int n = 0; n < iterations; n++)
+	{
+		ray.intersectTriangles(data.triangle0, data.triangle1, data.triangle2, 1.0f,
+		                       data.mask, data.triangleHits);
+	}
+	double time = perOperation(start, iterations);
+	doNotOptimize(data.mask[0]);
+	return time;
+}
+
+static double benchRayTriangleStreamWatertight(BenchmarkData &data, unsigned int iterations)
+{
+	Ray ray(data.points[0], data.directions[0] * 100.0f);
+	double start = getTime();
+	for (unsigned int n = 0; n < iterations; n++)
+	{
+		ray.intersectTriangles(data.triangle0, data.triangle1, data.triangle2, 1.0f,
+		                       data.mask, data.triangleHits, true);
+	}
+	double time = perOperation(start, iterations);
+	doNotOptimize(data.mask[0]);
+	return time;
+}
+
+static double benchBvhBuild(BenchmarkData &data, unsigned int iterations)
+{
+	Bvh bvh;
+	double start = getTime();
+	for (unsigned int n = 0; n < iterations; n++)
+		bvh.build(data.boxes, count);
+	double time = perOperation(start, iterations);
+	doNotOptimize(bvh.getNodes()[0]);
+	return time;
+}
+
+static double benchBvhBuildMorton(BenchmarkData &data, unsigned int iterations)
+{
+	Bvh bvh;
+	double start = getTime();
+	for (unsigned int n = 0; n < iterations; n++)
+		bvh.build(data.boxes, count, 4, Bvh::Morton);
+	double time = perOperation(start, iterations);
+	doNotOptimize(bvh.getNodes()[0]);
+	return time;
+}
+
+static double benchBvhRefit(BenchmarkData &data, unsigned int iterations)
+{
+	double start = getTime();
+	for (unsigned int n = 0; n < iterations; n++)
+		data.bvh.refit(data.boxes);
+	double time = perOperation(start, iterations);
+	doNotOptimize(data.bvh.getNodes()[0]);
+	return time;
+}
+
+static double benchBvhQueryOverlap(BenchmarkData &data, unsigned int iterations)
+{
+	size_t found = 0;
+	double start = getTime();
+	for (unsigned int n = 0; n < iterations; n++)
+	{
+		for (unsigned int i = 0; i < count; i++)
+		{
+			data.indexResults.clear();
+			found += data.bvh.queryOverlap(data.boxes[(i + n) % count], data.indexResults);
+		}
+	}
+	double time = perOperation(start, iterations);
+	doNotOptimize(found);
+	return time;
+}
+
+static double benchBvhQueryRay(BenchmarkData &data, unsigned int iterations)
+{
+	size_t found = 0;
+	double start = getTime();
+	for (unsigned int n = 0; n < iterations; n++)
+	{
+		for (unsigned int i = 0; i < count; i++)
+		{
+			data.indexResults.clear();
+			found += data.bvh.queryRay(data.points[i], data.directions[(i + n) % count],
+			                           100, data.indexResults);
+		}
+	}
+	double time = perOperation(start, iterations);
+	doNotOptimize(found);
+	return time;
+}
+
+static double benchBvhQueryFrustum(BenchmarkData &data, unsigned int iterations)
+{
+	size_t found = 0;
+	double start = getTime();
+	for (unsigned int n = 0; n < iterations; n++)
+	{
+		data.indexResults.clear();
+		found += data.bvh.queryFrustum(data.frustum, data.indexResults);
+	}
+	// Reported per box in the tree to be comparable to Frustum::cullBoxes()
+	double time = perOperation(start, iterations);
+	doNotOptimize(found);
+	return time;
+}
+
+static double benchLooseOctreeMove(BenchmarkData &data, unsigned int iterations)
+{
+	// Alternates between two positions, most objects stay in their cell
+	Vec3f offset(0.05f, 0.05f, 0.05f);
+	double start = getTime();
+	for (unsigned int n = 0; n < iterations; n++)
+	{
+		Vec3f o = (n & 1) ? Vec3f(0, 0, 0) : offset;
+		for (unsigned int i = 0; i < count; i++)
+		{
+			data.octree.move(i, BoundingBox(data.boxes[i].minCorner + o,
+			                                data.boxes[i].maxCorner + o));
+		}
+	}
+	double time = perOperation(start, iterations);
+	doNotOptimize(data.octree.getNodeCount());
+	return time;
+}
+
+static double benchLooseOctreeQueryBox(BenchmarkData &data, unsigned int iterations)
+{
+	size_t found = 0;
+	double start = getTime();
+	for (unsigned int n = 0; n < iterations; n++)
+	{
+		for (unsigned int i = 0; i < count; i++)
+		{
+			data.indexResults.clear();
+			found += data.octree.queryBox(data.boxes[(i + n) % count], data.indexResults);
+		}
+	}
+	double time = perOperation(start, iterations);
+	doNotOptimize(found);
+	return time;
+}
+
+static double benchLooseOctreeQueryFrustum(BenchmarkData &data, unsigned int iterations)
+{
+	size_t found = 0;
+	double start = getTime();
+	for (unsigned int n = 0; n < iterations; n++)
+	{
+		data.indexResults.clear();
+		found += data.octree.queryFrustum(data.frustum, data.indexResults);
+	}
+	double time = perOperation(start, iterations);
+	doNotOptimize(found);
+	return time;
+}
+
+static double benchSpatialHashGridPairs(BenchmarkData &data, unsigned int iterations)
+{
+	SpatialHashGrid grid(20.0f);
+	std::vector<SpatialHashGrid::Pair> pairs;
+	double start = getTime();
+	for (unsigned int n = 0; n < iterations; n++)
+	{
+		grid.clear();
+		grid.insert(data.boxes, count);
+		pairs.clear();
+		grid.findPairs(pairs);
+	}
+	double time = perOperation(start, iterations);
+	doNotOptimize(pairs.size());
+	return time;
+}
+
+static double benchSweepAndPruneUpdate(BenchmarkData &data, unsigned int iterations)
+{
+	SweepAndPrune sap;
+	for (unsigned int i = 0; i < count; i++)
+		sap.insert(data.boxes[i]);
+	sap.update();
+	// Small movements, the endpoints stay nearly sorted
+	double start = getTime();
+	for (unsigned int n = 0; n < iterations; n++)
+	{
+		Vec3f offset = (n & 1) ? Vec3f(0, 0, 0) : Vec3f(0.1f, 0.1f, 0.1f);
+		for (unsigned int i = 0; i < count; i++)
+		{
+			Vec3f o = (i & 1) ? offset : -offset;
+			sap.setBounds(i, BoundingBox(data.boxes[i].minCorner + o,
+			                             data.boxes[i].maxCorner + o));
+		}
+		sap.update();
+	}
+	double time = perOperation(start, iterations);
+	doNotOptimize(sap.getPairs().size());
+	return time;
+}
+
+struct Benchmark
+{
+	const char *name;
+	BenchmarkFunction function;
+};
+
+static const Benchmark benchmarks[] =
+{
+	{"Mat4f::operator*(Mat4f)", benchMat4Mul},
+	{"Mat4f::operator*(Vec4f)", benchMat4MulVec4},
+	{"Mat4f::inverse()", benchMat4Inverse},
+	{"Mat4f::inverseAffine()", benchMat4InverseAffine},
+	{"Mat4f::inverseRigid()", benchMat4InverseRigid},
+	{"Mat4f::transposed()", benchMat4Transpose},
+	{"Mat4f::transformPoint()", benchMat4TransformPoint},
+	{"Mat4f::transformPoints()", benchMat4TransformPoints},
+	{"Affine3f::operator*(Affine3f)", benchAffine3Mul},
+	{"Affine3f::inverse()", benchAffine3Inverse},
+	{"Vec3f::operator+()", benchVec3Add},
+	{"Vec3f::dot()", benchVec3Dot},
+	{"Vec3f::cross()", benchVec3Cross},
+	{"Vec3f::normalize()", benchVec3Normalize},
+	{"Vec3Streamf::dot()", benchVec3StreamDot},
+	{"Vec3Streamf::cross()", benchVec3StreamCross},
+	{"Vec3Streamf::normalize()", benchVec3StreamNormalize},
+	{"Quaternion::Quaternion(Vec3f)", benchQuaternionFromEuler},
+	{"Quaternion::toMatrix()", benchQuaternionToMatrix},
+	{"Quaternion::operator*(Quaternion)", benchQuaternionMul},
+	{"Quaternion::rotate()", benchQuaternionRotate},
+	{"Quaternion::rotate(Vec3f*)", benchQuaternionRotateArray},
+	{"Quaternion::slerp()", benchQuaternionSlerp},
+	{"Quaternion::nlerp(Quaternion*)", benchQuaternionNlerpArray},
+	{"Quaternion::fastSlerp(Quaternion*)", benchQuaternionFastSlerpArray},
+	{"Skeleton::computePalettes() (per bone)", benchSkeletonComputePalettes},
+	{"skinLinear() with normals (per vertex)", benchSkinLinear},
+	{"skinDualQuaternion() with normals (per vertex)", benchSkinDualQuaternion},
+	{"floatsToHalves() (per value)", benchFloatsToHalves},
+	{"halvesToFloats() (per value)", benchHalvesToFloats},
+	{"PackedQuaternion32::pack()", benchPackQuaternion32},
+	{"PackedQuaternion32::unpack()", benchUnpackQuaternion32},
+	{"Vec3Quantizer::quantize()", benchVec3Quantize},
+	{"Vec3Quantizer::dequantize()", benchVec3Dequantize},
+	{"Plane::getDistance()", benchPlaneDistance},
+	{"Plane::classifyPoints() (per point)", benchPlaneClassifyPoints},
+	{"Plane::intersectWithLineSegments() (per segment)", benchPlaneIntersectWithLineSegments},
+	{"BoundingBox::transform()", benchBoundingBoxTransform},
+	{"BoundingBox::transformBoxes(Mat4f)", benchBoundingBoxTransformBoxes},
+	{"BoundingBox::transformBoxes(Mat4f*)", benchBoundingBoxTransformBoxesPerBox},
+	{"Frustum::isInside(Vec3f)", benchFrustumIsInsidePoint},
+	{"Frustum::classify(BoundingBox)", benchFrustumClassify},
+	{"Frustum::cullBoxes(BoundingBox*)", benchFrustumCullBoxes},
+	{"Frustum::cullBoxes(Vec3Streamf)", benchFrustumCullBoxesSoA},
+	{"Frustum::clipTriangles() (per triangle)", benchFrustumClipTriangles},
+	{"Ray::intersect(BoundingBox)", benchRayIntersect},
+	{"Ray::intersect(Vec3Streamf) (per box)", benchRayIntersectStream},
+	{"RayPacket<SimdFloat>::intersect() (per packet)", benchRayPacketIntersect},
+	{"Ray::intersectTriangle()", benchRayTriangle},
+	{"Ray::intersectTriangleWatertight()", benchRayTriangleWatertight},
+	{"Ray::intersectTriangles(Vec3Streamf) (per triangle)", benchRayTriangleStream},
+	{"Ray::intersectTriangles(Vec3Streamf) watertight (per triangle)", benchRayTriangleStreamWatertight},
+	{"Bvh::build() (per box)", benchBvhBuild},
+	{"Bvh::build() Morton (per box)", benchBvhBuildMorton},
+	{"Bvh::refit() (per box)", benchBvhRefit},
+	{"Bvh::queryOverlap()", benchBvhQueryOverlap},
+	{"Bvh::queryRay()", benchBvhQueryRay},
+	{"Bvh::queryFrustum() (per box)", benchBvhQueryFrustum},
+	{"LooseOctree::move() (per box)", benchLooseOctreeMove},
+	{"LooseOctree::queryBox()", benchLooseOctreeQueryBox},
+	{"LooseOctree::queryFrustum() (per box)", benchLooseOctreeQueryFrustum},
+	{"SpatialHashGrid insert + findPairs() (per box)", benchSpatialHashGridPairs},
+	{"SweepAndPrune::update() (per box)", benchSweepAndPruneUpdate},
+};
+
+static const char *getSimdName()
+{
+#if defined(GAMEMATH_AVX) && defined(GAMEMATH_FMA)
+	return "AVX+FMA";
+#elif defined(GAMEMATH_AVX)
+	return "AVX";
+#elif defined(GAMEMATH_SSE2)
+	return "SSE2";
+#else
+	return "none";
+#endif
+}
+
+static void usage(const char *program)
+{
+	std::cerr << "Usage: " << program
+		<< " [--iterations N] [--format text|csv|json] [filter]" << std::endl;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int iterations = 200;
+	std::string format = "text";
+	std::string filter;
+	for (int i = 1; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "--iterations") && i + 1 < argc)
+		{
+			iterations = atoi(argv[++i]);
+		}
+		else if (!strcmp(argv[i], "--format") && i + 1 < argc)
+		{
+			format = argv[++i];
+		}
+		else if (argv[i][0] != '-')
+		{
+			filter = argv[i];
+		}
+		else
+		{
+			usage(argv[0]);
+			return 1;
+		}
+	}
+	if (iterations == 0
+	 || (format != "text" && format != "csv" && format != "json"))
+	{
+		usage(argv[0]);
+		return 1;
+	}
+
+	srand(42);
+	BenchmarkData *data = new BenchmarkData;
+	unsigned int benchmarkCount = sizeof(benchmarks) / sizeof(benchmarks[0]);
+	if (format == "csv")
+		std::cout << "name,simd,iterations,operations_per_iteration,"
+			<< "ns_per_op,ops_per_s" << std::endl;
+	else if (format == "json")
+		std::cout << "{\n\t\"simd\": \"" << getSimdName()
+			<< "\",\n\t\"iterations\": " << iterations
+			<< ",\n\t\"operations_per_iteration\": " << count
+			<< ",\n\t\"results\": [";
+	else
+		std::cout << "SIMD: " << getSimdName() << ", " << iterations
+			<< " iterations of " << count << " operations" << std::endl;
+	bool first = true;
+	for (unsigned int i = 0; i < benchmarkCount; i++)
+	{
+		const Benchmark &benchmark = benchmarks[i];
+		if (std::string(benchmark.name).find(filter) == std::string::npos)
+			continue;
+		// Warm up caches and branch predictors before measuring
+		benchmark.function(*data, 1);
+		double time = benchmark.function(*data, iterations);
+		double opsPerSecond = 1e9 / time;
+		if (format == "csv")
+		{
+			std::cout << "\"" << benchmark.name << "\"," << getSimdName() << ","
+				<< iterations << "," << count << "," << time << ","
+				<< opsPerSecond << std::endl;
+		}
+		else if (format == "json")
+		{
+			std::cout << (first ? "\n" : ",\n") << "\t\t{\"name\": \""
+				<< benchmark.name << "\", \"ns_per_op\": " << time
+				<< ", \"ops_per_s\": " << opsPerSecond << "}";
+		}
+		else
+		{
+			std::cout << benchmark.name << ": " << time << " ns/op, "
+				<< opsPerSecond << " ops/s" << std::endl;
+		}
+		first = false;
+	}
+	if (format == "json")
+		std::cout << "\n\t]\n}" << std::endl;
+	delete data;
+	return 0;
+}
@@ -0,0 +1,249 @@
+/*
+Copyright (C) 2011, Mathias Gottschlag
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "GameMath.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+using namespace math;
+
+static float randomFloat(float min, float max)
+{
+	return min + (max - min) * (float)rand() / (float)RAND_MAX;
+}
+
+static Vec3f randomVec3(float min, float max)
+{
+	return Vec3f(randomFloat(min, max), randomFloat(min, max),
+	             randomFloat(min, max));
+}
+
+/**
+ * Creates a random box, some of the boxes are large or outside of the area
+ * covered by the tree.
+ */
+static BoundingBox randomBox()
+{
+	Vec3f center = randomVec3(-120, 120);
+	Vec3f size = randomVec3(0, 3);
+	if (rand() % 20 == 0)
+		size = randomVec3(0, 60);
+	return BoundingBox(center - size, center + size);
+}
+
+static bool overlapSphere(const BoundingBox &box, const Vec3f &center, float radius)
+{
+	Vec3f closest(std::max(box.minCorner.x, std::min(center.x, box.maxCorner.x)),
+	              std::max(box.minCorner.y, std::min(center.y, box.maxCorner.y)),
+	              std::max(box.minCorner.z, std::min(center.z, box.maxCorner.z)));
+	return (closest - center).getSquaredLength() <= radius * radius;
+}
+
+/**
+ * Sorts the query result and compares it against the expected result.
+ */
+static bool compare(std::vector<uint32> &result, const std::vector<uint32> &expected)
+{
+	std::sort(result.begin(), result.end());
+	return result == expected;
+}
+
+/**
+ * Compares the queries of the tree against brute force tests of all live
+ * objects.
+ */
+static unsigned int testQueries(const LooseOctree &octree,
+                                const std::vector<BoundingBox> &boxes,
+                                const std::vector<bool> &alive)
+{
+	unsigned int wrong = 0;
+	std::vector<uint32> result;
+	std::vector<uint32> expected;
+	for (unsigned int i = 0; i < 30; i++)
+	{
+		// Box
+		Vec3f center = randomVec3(-110, 110);
+		Vec3f size = randomVec3(1, 20);
+		BoundingBox query(center - size, center + size);
+		result.clear();
+		expected.clear();
+		for (unsigned int j = 0; j < boxes.size(); j++)
+		{
+			if (alive[j] && boxes[j].overlap(query))
+				expected.push_back(j);
+		}
+		if (octree.queryBox(query, result) != expected.size()
+		 || !compare(result, expected))
+			wrong++;
+		// Sphere
+		float radius = randomFloat(0, 30);
+		result.clear();
+		expected.clear();
+		for (unsigned int j = 0; j < boxes.size(); j++)
+		{
+			if (alive[j] && overlapSphere(boxes[j], center, radius))
+				expected.push_back(j);
+		}
+		if (octree.querySphere(center, radius, result) != expected.size()
+		 || !compare(result, expected))
+			wrong++;
+		// Frustum
+		Frustum frustum(Mat4f::PerspectiveFOV(randomFloat(30, 90), 1.333f, 1, 80)
+		                * Mat4f::EulerRotation(randomVec3(0, 360))
+		                * Mat4f::TransMat(randomVec3(-50, 50)));
+		result.clear();
+		expected.clear();
+		for (unsigned int j = 0; j < boxes.size(); j++)
+		{
+			if (alive[j] && frustum.isInside(boxes[j]))
+				expected.push_back(j);
+		}
+		if (octree.queryFrustum(frustum, result) != expected.size()
+		 || !compare(result, expected))
+			wrong++;
+	}
+	return wrong;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int errors = 0;
+	LooseOctree octree(BoundingBox(Vec3f(-100, -100, -100), Vec3f(100, 100, 100)), 6);
+	std::vector<BoundingBox> boxes;
+	std::vector<bool> alive;
+	{
+		// Empty tree
+		std::vector<uint32> result;
+		if (octree.queryBox(BoundingBox(Vec3f(-200, -200, -200), Vec3f(200, 200, 200)), result) != 0
+		 || octree.getNodeCount() != 1)
+		{
+			std::cout << "Empty tree wrong." << std::endl;
+			errors++;
+		}
+	}
+	{
+		// Insertion, handles are assigned consecutively
+		for (unsigned int i = 0; i < 2000; i++)
+		{
+			BoundingBox box = randomBox();
+			if (octree.insert(box) != i)
+			{
+				std::cout << "Wrong handle." << std::endl;
+				errors++;
+				break;
+			}
+			boxes.push_back(box);
+			alive.push_back(true);
+		}
+		// Degenerate boxes
+		Vec3f degenerate[] = {Vec3f(100, 100, 100), Vec3f(-100, -100, -100),
+		                      Vec3f(0, 0, 0), Vec3f(1000, 0, 0)};
+		for (unsigned int i = 0; i < 4; i++)
+		{
+			boxes.push_back(BoundingBox(degenerate[i]));
+			alive.push_back(true);
+			octree.insert(boxes.back());
+		}
+		unsigned int wrong = testQueries(octree, boxes, alive);
+		if (wrong != 0 || octree.getObjectCount() != boxes.size())
+		{
+			std::cout << wrong << " queries wrong after insertion." << std::endl;
+			errors++;
+		}
+	}
+	{
+		// Small movements mostly stay in the same cell
+		unsigned int relocated = 0;
+		for (unsigned int i = 0; i < boxes.size(); i++)
+		{
+			Vec3f offset = randomVec3(-0.01f, 0.01f);
+			boxes[i] = BoundingBox(boxes[i].minCorner + offset,
+			                       boxes[i].maxCorner + offset);
+			if (octree.move(i, boxes[i]))
+				relocated++;
+			if (octree.getBounds(i).minCorner != boxes[i].minCorner)
+				errors++;
+		}
+		if (relocated > boxes.size() / 10)
+		{
+			std::cout << relocated << " objects relocated by small movements." << std::endl;
+			errors++;
+		}
+		// Large movements
+		for (unsigned int i = 0; i < boxes.size(); i += 2)
+		{
+			boxes[i] = randomBox();
+			octree.move(i, boxes[i]);
+		}
+		unsigned int wrong = testQueries(octree, boxes, alive);
+		if (wrong != 0)
+		{
+			std::cout << wrong << " queries wrong after moving." << std::endl;
+			errors++;
+		}
+	}
+	{
+		// Removal, freed handles are reused
+		for (unsigned int i = 0; i < boxes.size(); i += 3)
+		{
+			octree.remove(i);
+			alive[i] = false;
+		}
+		unsigned int wrong = testQueries(octree, boxes, alive);
+		if (wrong != 0)
+		{
+			std::cout << wrong << " queries wrong after removal." << std::endl;
+			errors++;
+		}
+		uint32 handle = octree.insert(boxes[0]);
+		if (handle % 3 != 0 || alive[handle])
+		{
+			std::cout << "Handle not reused." << std::endl;
+			errors++;
+		}
+		boxes[handle] = boxes[0];
+		alive[handle] = true;
+		wrong = testQueries(octree, boxes, alive);
+		if (wrong != 0)
+		{
+			std::cout << wrong << " queries wrong after reinsertion." << std::endl;
+			errors++;
+		}
+	}
+	{
+		// All nodes except for the root are freed when the tree is empty
+		for (unsigned int i = 0; i < boxes.size(); i++)
+		{
+			if (alive[i])
+				octree.remove(i);
+		}
+		if (octree.getObjectCount() != 0 || octree.getNodeCount() != 1)
+		{
+			std::cout << "Nodes not freed: " << octree.getNodeCount() << std::endl;
+			errors++;
+		}
+	}
+	std::cout << errors << " errors." << std::endl;
+	return errors;
+}
@@ -22,9 +22,28 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "GameMath.hpp"
 
 #include <iostream>
+#include <cmath>
 
 using namespace math;
 
+template<typename T> static bool isIdentity(const Mat4<T> &m)
+{
+	Mat4<T> identity = Mat4<T>::Identity();
+	for (unsigned int i = 0; i < 16; i++)
+	{
+		if (std::fabs(m.m[i] - identity.m[i]) > (T)1e-5)
+			return false;
+	}
+	return true;
+}
+
+static bool isEqual(const Vec3f &a, const Vec3f &b, float epsilon)
+{
+	return std::fabs(a.x - b.x) <= epsilon
+	    && std::fabs(a.y - b.y) <= epsilon
+	    && std::fabs(a.z - b.z) <= epsilon;
+}
+
 int main(int argc, char **argv)
 {
 	unsigned int errors = 0;
@@ -66,6 +85,35 @@ int main(int argc, char **argv)
 			errors++;
 		}
 	}
+	{
+		// Mat4f * Mat4f (non-integer values, has to match Mat4d)
+		Mat4f m1(0.5f, 1.25f, -3.0f, 0.75f,
+		         2.0f, -0.5f, 1.5f, 4.0f,
+		         -1.0f, 0.25f, 2.5f, -2.0f,
+		         0.0f, 0.0f, 0.0f, 1.0f);
+		Mat4f m2(1.5f, -2.0f, 0.5f, 3.0f,
+		         0.25f, 1.0f, -1.5f, 2.0f,
+		         -0.75f, 0.5f, 2.0f, -1.0f,
+		         0.0f, 0.0f, 0.0f, 1.0f);
+		Mat4f m3 = m1 * m2;
+		Mat4d m4 = Mat4d(0.5f, 1.25f, -3.0f, 0.75f,
+		                 2.0f, -0.5f, 1.5f, 4.0f,
+		                 -1.0f, 0.25f, 2.5f, -2.0f,
+		                 0.0f, 0.0f, 0.0f, 1.0f)
+		         * Mat4d(1.5f, -2.0f, 0.5f, 3.0f,
+		                 0.25f, 1.0f, -1.5f, 2.0f,
+		                 -0.75f, 0.5f, 2.0f, -1.0f,
+		                 0.0f, 0.0f, 0.0f, 1.0f);
+		for (unsigned int i = 0; i < 16; i++)
+		{
+			if (m3.m[i] != (float)m4.m[i])
+			{
+				std::cout << "Mat4f * Mat4f (non-integer): " << i << ": "
+					<< m3.m[i] << " (correct: " << m4.m[i] << ")" << std::endl;
+				errors++;
+			}
+		}
+	}
 	{
 		// Identity
 		Mat4f m = Mat4f::Identity();
@@ -167,6 +215,163 @@ int main(int argc, char **argv)
 			errors++;
 		}
 	}
+	{
+		// Batched point transformation
+		Mat4f m = Mat4f::TransMat(Vec3f(1, 2, 3)) * Mat4f::ScaleMat(Vec3f(2, 2, 2));
+		Mat4f proj = Mat4f::Perspective(2, 2, 1, 100) * m;
+		// Interleaved position/normal buffer
+		Vec3f vertices[14];
+		for (unsigned int i = 0; i < 7; i++)
+		{
+			vertices[2 * i] = Vec3f((float)i, (float)i * 0.5f, -(float)i - 2);
+			vertices[2 * i + 1] = Vec3f(0, 1, 0);
+		}
+		Vec3f points[7];
+		Vec3f directions[7];
+		Vec3f projected[7];
+		m.transformPointsAffine(vertices, points, 7, 2 * sizeof(Vec3f));
+		m.transformDirections(vertices + 1, directions, 7, 2 * sizeof(Vec3f));
+		proj.transformPoints(vertices, projected, 7, 2 * sizeof(Vec3f));
+		for (unsigned int i = 0; i < 7; i++)
+		{
+			Vec3f expected = vertices[2 * i] * 2.0f + Vec3f(1, 2, 3);
+			if (points[i] != expected)
+			{
+				std::cout << "transformPointsAffine(): " << i << std::endl;
+				errors++;
+			}
+			if (directions[i] != Vec3f(0, 2, 0))
+			{
+				std::cout << "transformDirections(): " << i << std::endl;
+				errors++;
+			}
+			if (projected[i] != proj.transformPoint(vertices[2 * i]))
+			{
+				std::cout << "transformPoints(): " << i << std::endl;
+				errors++;
+			}
+		}
+		// In-place transformation
+		proj.transformPoints(vertices, vertices, 7, 2 * sizeof(Vec3f), 2 * sizeof(Vec3f));
+		for (unsigned int i = 0; i < 7; i++)
+		{
+			if (vertices[2 * i] != projected[i]
+			 || vertices[2 * i + 1] != Vec3f(0, 1, 0))
+			{
+				std::cout << "transformPoints() (in-place): " << i << std::endl;
+				errors++;
+			}
+		}
+	}
+	{
+		// Batched transformation of packed arrays
+		Mat4f m = Mat4f::TransMat(Vec3f(1, 2, 3))
+		        * Mat4f::EulerRotation(Vec3f(30, 45, 60))
+		        * Mat4f::ScaleMat(Vec3f(2, 3, 4));
+		Mat4f proj = Mat4f::Perspective(2, 2, 1, 100) * m;
+		const unsigned int count = 11;
+		Vec3f vertices[count];
+		for (unsigned int i = 0; i < count; i++)
+			vertices[i] = Vec3f((float)i, (float)i * 0.5f - 2, -(float)i - 2);
+		Vec3f points[count];
+		Vec3f directions[count];
+		Vec3f projected[count];
+		m.transformPointsAffine(vertices, points, count);
+		m.transformDirections(vertices, directions, count);
+		proj.transformPoints(vertices, projected, count);
+		Vec3f inPlacePoints[count];
+		Vec3f inPlaceDirections[count];
+		Vec3f inPlaceProjected[count];
+		for (unsigned int i = 0; i < count; i++)
+		{
+			inPlacePoints[i] = vertices[i];
+			inPlaceDirections[i] = vertices[i];
+			inPlaceProjected[i] = vertices[i];
+		}
+		m.transformPointsAffine(inPlacePoints, inPlacePoints, count);
+		m.transformDirections(inPlaceDirections, inPlaceDirections, count);
+		proj.transformPoints(inPlaceProjected, inPlaceProjected, count);
+		for (unsigned int i = 0; i < count; i++)
+		{
+			Vec3f expectedPoint = m.transformPoint(vertices[i]);
+			Vec3f expectedDirection = m.transformPoint(vertices[i])
+			                        - m.transformPoint(Vec3f(0, 0, 0));
+			Vec3f expectedProjected = proj.transformPoint(vertices[i]);
+			if (!isEqual(points[i], expectedPoint, 1e-4f)
+			 || !isEqual(inPlacePoints[i], expectedPoint, 1e-4f))
+			{
+				std::cout << "transformPointsAffine() (packed): " << i << std::endl;
+				errors++;
+			}
+			if (!isEqual(directions[i], expectedDirection, 1e-4f)
+			 || !isEqual(inPlaceDirections[i], expectedDirection, 1e-4f))
+			{
+				std::cout << "transformDirections() (packed): " << i << std::endl;
+				errors++;
+			}
+			if (!isEqual(projected[i], expectedProjected, 1e-5f)
+			 || !isEqual(inPlaceProjected[i], expectedProjected, 1e-5f))
+			{
+				std::cout << "transformPoints() (packed): " << i << std::endl;
+				errors++;
+			}
+		}
+	}
+	{
+		// Inverse (non-integer values)
+		Mat4f m(0.5f, 1.25f, -3.0f, 0.75f,
+		        2.0f, -0.5f, 1.5f, 4.0f,
+		        -1.0f, 0.25f, 2.5f, -2.0f,
+		        0.5f, 1.0f, -0.25f, 1.0f);
+		if (!isIdentity(m * m.inverse()) || !isIdentity(m.inverse() * m))
+		{
+			std::cout << "Inverse (non-integer)" << std::endl;
+			errors++;
+		}
+	}
+	{
+		// Inverse (generic implementation)
+		Mat4d m(0.5, 1.25, -3.0, 0.75,
+		        2.0, -0.5, 1.5, 4.0,
+		        -1.0, 0.25, 2.5, -2.0,
+		        0.5, 1.0, -0.25, 1.0);
+		if (!isIdentity(m * m.inverse()) || !isIdentity(m.inverse() * m))
+		{
+			std::cout << "Inverse (Mat4d)" << std::endl;
+			errors++;
+		}
+		Mat4d m1(0, 0, 0, 1,
+		         2, 0, 1, 0,
+		         0, 1, 1, 0,
+		         1, 0, 0, 3);
+		Mat4d m2(-3, 0, 0, 1,
+		         -6, -1, 1, 2,
+		         6, 1, 0, -2,
+		         1, 0, 0, 0);
+		if (m1.inverse() != m2)
+		{
+			std::cout << "Inverse (Mat4d, integer)" << std::endl;
+			errors++;
+		}
+	}
+	{
+		// Affine and rigid inverse
+		Mat4f rigid = Mat4f::TransMat(Vec3f(1, -2, 3))
+		            * Mat4f::EulerRotation(Vec3f(30, 45, 60));
+		Mat4f affine = rigid * Mat4f::ScaleMat(Vec3f(2, 0.5f, 3));
+		if (!isIdentity(affine * affine.inverseAffine())
+		 || !isIdentity(affine.inverseAffine() * affine))
+		{
+			std::cout << "inverseAffine()" << std::endl;
+			errors++;
+		}
+		if (!isIdentity(rigid * rigid.inverseRigid())
+		 || !isIdentity(rigid.inverseRigid() * rigid))
+		{
+			std::cout << "inverseRigid()" << std::endl;
+			errors++;
+		}
+	}
 	std::cout << errors << " errors." << std::endl;
 	return errors;
 }
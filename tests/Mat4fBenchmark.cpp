@@ -0,0 +1,277 @@
+/*
+Copyright (C) 2011, Mathias Gottschlag
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "GameMath.hpp"
+#include "Benchmark.hpp"
+
+#include <iostream>
+#include <cstdlib>
+
+using namespace math;
+
+/**
+ * Scalar reference implementations, these are the generic Mat4<T> versions.
+ */
+static Mat4f multiplyScalar(const Mat4f &m, const Mat4f &o)
+{
+	Mat4f out;
+	for (unsigned int row = 0; row < 4; row++)
+	{
+		for (unsigned int column = 0; column < 4; column++)
+		{
+			out(row, column) = m(row, 0) * o(0, column)
+			                 + m(row, 1) * o(1, column)
+			                 + m(row, 2) * o(2, column)
+			                 + m(row, 3) * o(3, column);
+		}
+	}
+	return out;
+}
+static Vec4f multiplyScalar(const Mat4f &m, const Vec4f &v)
+{
+	return Vec4f(v.x * m(0, 0) + v.y * m(0, 1) + v.z * m(0, 2) + v.w * m(0, 3),
+	             v.x * m(1, 0) + v.y * m(1, 1) + v.z * m(1, 2) + v.w * m(1, 3),
+	             v.x * m(2, 0) + v.y * m(2, 1) + v.z * m(2, 2) + v.w * m(2, 3),
+	             v.x * m(3, 0) + v.y * m(3, 1) + v.z * m(3, 2) + v.w * m(3, 3));
+}
+
+static Mat4f inverseScalar(const Mat4f &m)
+{
+	// Previous version of Mat4::inverse(), using a separate determinant()
+	Mat4f out;
+	float d = m.determinant();
+	if (d == 0)
+		return out;
+	d = 1 / d;
+	out(0, 0) = d * (m(1, 1) * (m(2, 2) * m(3, 3) - m(2, 3) * m(3, 2)) +
+	                 m(1, 2) * (m(2, 3) * m(3, 1) - m(2, 1) * m(3, 3)) +
+	                 m(1, 3) * (m(2, 1) * m(3, 2) - m(2, 2) * m(3, 1)));
+	out(0, 1) = d * (m(2, 1) * (m(0, 2) * m(3, 3) - m(0, 3) * m(3, 2)) +
+	                 m(2, 2) * (m(0, 3) * m(3, 1) - m(0, 1) * m(3, 3)) +
+	                 m(2, 3) * (m(0, 1) * m(3, 2) - m(0, 2) * m(3, 1)));
+	out(0, 2) = d * (m(3, 1) * (m(0, 2) * m(1, 3) - m(0, 3) * m(1, 2)) +
+	                 m(3, 2) * (m(0, 3) * m(1, 1) - m(0, 1) * m(1, 3)) +
+	                 m(3, 3) * (m(0, 1) * m(1, 2) - m(0, 2) * m(1, 1)));
+	out(0, 3) = d * (m(0, 1) * (m(1, 3) * m(2, 2) - m(1, 2) * m(2, 3)) +
+	                 m(0, 2) * (m(1, 1) * m(2, 3) - m(1, 3) * m(2, 1)) +
+	                 m(0, 3) * (m(1, 2) * m(2, 1) - m(1, 1) * m(2, 2)));
+	out(1, 0) = d * (m(1, 2) * (m(2, 0) * m(3, 3) - m(2, 3) * m(3, 0)) +
+	                 m(1, 3) * (m(2, 2) * m(3, 0) - m(2, 0) * m(3, 2)) +
+	                 m(1, 0) * (m(2, 3) * m(3, 2) - m(2, 2) * m(3, 3)));
+	out(1, 1) = d * (m(2, 2) * (m(0, 0) * m(3, 3) - m(0, 3) * m(3, 0)) +
+	                 m(2, 3) * (m(0, 2) * m(3, 0) - m(0, 0) * m(3, 2)) +
+	                 m(2, 0) * (m(0, 3) * m(3, 2) - m(0, 2) * m(3, 3)));
+	out(1, 2) = d * (m(3, 2) * (m(0, 0) * m(1, 3) - m(0, 3) * m(1, 0)) +
+	                 m(3, 3) * (m(0, 2) * m(1, 0) - m(0, 0) * m(1, 2)) +
+	                 m(3, 0) * (m(0, 3) * m(1, 2) - m(0, 2) * m(1, 3)));
+	out(1, 3) = d * (m(0, 2) * (m(1, 3) * m(2, 0) - m(1, 0) * m(2, 3)) +
+	                 m(0, 3) * (m(1, 0) * m(2, 2) - m(1, 2) * m(2, 0)) +
+	                 m(0, 0) * (m(1, 2) * m(2, 3) - m(1, 3) * m(2, 2)));
+	out(2, 0) = d * (m(1, 3) * (m(2, 0) * m(3, 1) - m(2, 1) * m(3, 0)) +
+	                 m(1, 0) * (m(2, 1) * m(3, 3) - m(2, 3) * m(3, 1)) +
+	                 m(1, 1) * (m(2, 3) * m(3, 0) - m(2, 0) * m(3, 3)));
+	out(2, 1) = d * (m(2, 3) * (m(0, 0) * m(3, 1) - m(0, 1) * m(3, 0)) +
+	                 m(2, 0) * (m(0, 1) * m(3, 3) - m(0, 3) * m(3, 1)) +
+	                 m(2, 1) * (m(0, 3) * m(3, 0) - m(0, 0) * m(3, 3)));
+	out(2, 2) = d * (m(3, 3) * (m(0, 0) * m(1, 1) - m(0, 1) * m(1, 0)) +
+	                 m(3, 0) * (m(0, 1) * m(1, 3) - m(0, 3) * m(1, 1)) +
+	                 m(3, 1) * (m(0, 3) * m(1, 0) - m(0, 0) * m(1, 3)));
+	out(2, 3) = d * (m(0, 3) * (m(1, 1) * m(2, 0) - m(1, 0) * m(2, 1)) +
+	                 m(0, 0) * (m(1, 3) * m(2, 1) - m(1, 1) * m(2, 3)) +
+	                 m(0, 1) * (m(1, 0) * m(2, 3) - m(1, 3) * m(2, 0)));
+	out(3, 0) = d * (m(1, 0) * (m(2, 2) * m(3, 1) - m(2, 1) * m(3, 2)) +
+	                 m(1, 1) * (m(2, 0) * m(3, 2) - m(2, 2) * m(3, 0)) +
+	                 m(1, 2) * (m(2, 1) * m(3, 0) - m(2, 0) * m(3, 1)));
+	out(3, 1) = d * (m(2, 0) * (m(0, 2) * m(3, 1) - m(0, 1) * m(3, 2)) +
+	                 m(2, 1) * (m(0, 0) * m(3, 2) - m(0, 2) * m(3, 0)) +
+	                 m(2, 2) * (m(0, 1) * m(3, 0) - m(0, 0) * m(3, 1)));
+	out(3, 2) = d * (m(3, 0) * (m(0, 2) * m(1, 1) - m(0, 1) * m(1, 2)) +
+	                 m(3, 1) * (m(0, 0) * m(1, 2) - m(0, 2) * m(1, 0)) +
+	                 m(3, 2) * (m(0, 1) * m(1, 0) - m(0, 0) * m(1, 1)));
+	out(3, 3) = d * (m(0, 0) * (m(1, 1) * m(2, 2) - m(1, 2) * m(2, 1)) +
+	                 m(0, 1) * (m(1, 2) * m(2, 0) - m(1, 0) * m(2, 2)) +
+	                 m(0, 2) * (m(1, 0) * m(2, 1) - m(1, 1) * m(2, 0)));
+	return out;
+}
+
+static float randomFloat(float min, float max)
+{
+	return min + (max - min) * (float)rand() / (float)RAND_MAX;
+}
+
+static void report(const char *name, double reference, double optimized)
+{
+	std::cout << name << ": reference " << reference << " ns/op, optimized "
+		<< optimized << " ns/op, speedup " << reference / optimized << "x"
+		<< std::endl;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int iterations = 200;
+	if (argc > 1)
+		iterations = atoi(argv[1]);
+	const unsigned int count = 1024;
+	Mat4f *matrices = new Mat4f[count];
+	Mat4f *results = new Mat4f[count];
+	Vec4f *vectors = new Vec4f[count];
+	for (unsigned int i = 0; i < count; i++)
+	{
+		for (unsigned int j = 0; j < 16; j++)
+			matrices[i].m[j] = randomFloat(-2, 2);
+		vectors[i] = Vec4f(randomFloat(-10, 10), randomFloat(-10, 10),
+		                   randomFloat(-10, 10), 1);
+	}
+	unsigned int mismatches = 0;
+	for (unsigned int i = 0; i < count; i++)
+	{
+		const Mat4f &a = matrices[i];
+		const Mat4f &b = matrices[(i + 1) % count];
+		if (a * b != multiplyScalar(a, b))
+			mismatches++;
+		if (a * vectors[i] != multiplyScalar(a, vectors[i]))
+			mismatches++;
+	}
+	std::cout << "Results differing from the scalar code: " << mismatches
+		<< std::endl;
+
+	double operations = (double)iterations * count;
+	// Mat4f * Mat4f
+	double start = getTime();
+	for (unsigned int n = 0; n < iterations; n++)
+		for (unsigned int i = 0; i < count; i++)
+			results[i] = multiplyScalar(matrices[i], matrices[(i + n) % count]);
+	double scalar = (getTime() - start) / operations;
+	doNotOptimize(results[count / 2]);
+	start = getTime();
+	for (unsigned int n = 0; n < iterations; n++)
+		for (unsigned int i = 0; i < count; i++)
+			results[i] = matrices[i] * matrices[(i + n) % count];
+	double simd = (getTime() - start) / operations;
+	doNotOptimize(results[count / 2]);
+	report("Mat4f * Mat4f", scalar, simd);
+	// Mat4f * Vec4f
+	Vec4f sum;
+	start = getTime();
+	for (unsigned int n = 0; n < iterations; n++)
+		for (unsigned int i = 0; i < count; i++)
+			sum += multiplyScalar(matrices[(i + n) % count], vectors[i]);
+	scalar = (getTime() - start) / operations;
+	doNotOptimize(sum);
+	start = getTime();
+	for (unsigned int n = 0; n < iterations; n++)
+		for (unsigned int i = 0; i < count; i++)
+			sum += matrices[(i + n) % count] * vectors[i];
+	simd = (getTime() - start) / operations;
+	doNotOptimize(sum);
+	report("Mat4f * Vec4f", scalar, simd);
+
+	// Inverse
+	start = getTime();
+	for (unsigned int n = 0; n < iterations; n++)
+		for (unsigned int i = 0; i < count; i++)
+			results[i] = inverseScalar(matrices[(i + n) % count]);
+	scalar = (getTime() - start) / operations;
+	doNotOptimize(results[count / 2]);
+	start = getTime();
+	for (unsigned int n = 0; n < iterations; n++)
+		for (unsigned int i = 0; i < count; i++)
+			results[i] = matrices[(i + n) % count].inverse();
+	simd = (getTime() - start) / operations;
+	doNotOptimize(results[count / 2]);
+	report("Mat4f::inverse()", scalar, simd);
+	// The affine and rigid inverses are compared to the old inverse()
+	Mat4f *rigid = new Mat4f[count];
+	for (unsigned int i = 0; i < count; i++)
+	{
+		rigid[i] = Mat4f::TransMat(vectors[i].x, vectors[i].y, vectors[i].z)
+		         * Mat4f::EulerRotation(Vec3f(randomFloat(0, 360),
+		                                      randomFloat(0, 360),
+		                                      randomFloat(0, 360)));
+	}
+	start = getTime();
+	for (unsigned int n = 0; n < iterations; n++)
+		for (unsigned int i = 0; i < count; i++)
+			results[i] = inverseScalar(rigid[(i + n) % count]);
+	scalar = (getTime() - start) / operations;
+	doNotOptimize(results[count / 2]);
+	start = getTime();
+	for (unsigned int n = 0; n < iterations; n++)
+		for (unsigned int i = 0; i < count; i++)
+			results[i] = rigid[(i + n) % count].inverseAffine();
+	simd = (getTime() - start) / operations;
+	doNotOptimize(results[count / 2]);
+	report("Mat4f::inverseAffine()", scalar, simd);
+	start = getTime();
+	for (unsigned int n = 0; n < iterations; n++)
+		for (unsigned int i = 0; i < count; i++)
+			results[i] = rigid[(i + n) % count].inverseRigid();
+	simd = (getTime() - start) / operations;
+	doNotOptimize(results[count / 2]);
+	report("Mat4f::inverseRigid()", scalar, simd);
+	delete[] rigid;
+
+	// Mat4f::transformPoint() vs. Mat4f::transformPoints()
+	Vec3f *points = new Vec3f[count];
+	Vec3f *transformed = new Vec3f[count];
+	for (unsigned int i = 0; i < count; i++)
+		points[i] = Vec3f(vectors[i].x, vectors[i].y, vectors[i].z);
+	start = getTime();
+	for (unsigned int n = 0; n < iterations; n++)
+		for (unsigned int i = 0; i < count; i++)
+			transformed[i] = matrices[n % count].transformPoint(points[i]);
+	scalar = (getTime() - start) / operations;
+	doNotOptimize(transformed[count / 2]);
+	start = getTime();
+	for (unsigned int n = 0; n < iterations; n++)
+		matrices[n % count].transformPoints(points, transformed, count);
+	simd = (getTime() - start) / operations;
+	doNotOptimize(transformed[count / 2]);
+	report("Mat4f::transformPoints()", scalar, simd);
+	delete[] points;
+	delete[] transformed;
+
+	// Mat4f * Mat4f vs. Affine3f * Affine3f
+	Affine3f *affine = new Affine3f[count];
+	Affine3f *affineResults = new Affine3f[count];
+	for (unsigned int i = 0; i < count; i++)
+		affine[i] = Affine3f(matrices[i]);
+	start = getTime();
+	for (unsigned int n = 0; n < iterations; n++)
+		for (unsigned int i = 0; i < count; i++)
+			results[i] = matrices[i] * matrices[(i + n) % count];
+	scalar = (getTime() - start) / operations;
+	doNotOptimize(results[count / 2]);
+	start = getTime();
+	for (unsigned int n = 0; n < iterations; n++)
+		for (unsigned int i = 0; i < count; i++)
+			affineResults[i] = affine[i] * affine[(i + n) % count];
+	simd = (getTime() - start) / operations;
+	doNotOptimize(affineResults[count / 2]);
+	report("Affine3f * Affine3f", scalar, simd);
+	delete[] affine;
+	delete[] affineResults;
+
+	delete[] matrices;
+	delete[] results;
+	delete[] vectors;
+	return 0;
+}
@@ -21,10 +21,21 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #include "GameMath.hpp"
 
+#include <cmath>
+#include <cstdlib>
 #include <iostream>
+#include <vector>
 
 using namespace math;
 
+static float polygonArea(const Vec3f *vertices, unsigned int count)
+{
+	Vec3f sum(0, 0, 0);
+	for (unsigned int i = 2; i < count; i++)
+		sum += (vertices[i - 1] - vertices[0]).cross(vertices[i] - vertices[0]);
+	return sum.getLength() * 0.5f;
+}
+
 int main(int argc, char **argv)
 {
 	unsigned int errors = 0;
@@ -99,6 +110,240 @@ int main(int argc, char **argv)
 			errors++;
 		}
 	}
+	{
+		// Batch classification, odd count to test the scalar tail
+		Plane plane(Vec3f(0.48f, 0.6f, 0.64f), 0.25f);
+		const unsigned int count = 103;
+		std::vector<Vec3f> points(count);
+		srand(5);
+		for (unsigned int i = 0; i < count; i++)
+		{
+			points[i] = Vec3f((float)(rand() % 2001 - 1000) / 500.0f,
+			                  (float)(rand() % 2001 - 1000) / 500.0f,
+			                  (float)(rand() % 2001 - 1000) / 500.0f);
+		}
+		// Some points exactly on the plane
+		points[7] = Vec3f(0, 0, 0.25f / 0.64f);
+		points[101] = plane.normal * 0.25f;
+		const float epsilon = 0.001f;
+		std::vector<float> distances(count);
+		std::vector<uint8> sides(count);
+		plane.classifyPoints(&points[0], count, &distances[0], &sides[0], epsilon);
+		std::vector<uint32> front;
+		std::vector<uint32> back;
+		std::vector<uint32> on;
+		plane.classifyPoints(&points[0], count, 0, front, back, on, epsilon);
+		unsigned int wrongDistance = 0;
+		unsigned int wrongSide = 0;
+		std::vector<uint32> expected[3];
+		for (unsigned int i = 0; i < count; i++)
+		{
+			float distance = plane.getDistance(points[i]);
+			if (std::fabs(distances[i] - distance) > 1e-5f)
+				wrongDistance++;
+			Plane::Side side = Plane::On;
+			if (distance > epsilon)
+				side = Plane::Front;
+			else if (distance < -epsilon)
+				side = Plane::Back;
+			if (sides[i] != side)
+				wrongSide++;
+			expected[side].push_back(i);
+		}
+		if (wrongDistance != 0 || wrongSide != 0)
+		{
+			std::cout << "classifyPoints: " << wrongDistance
+				<< " wrong distances, " << wrongSide << " wrong sides."
+				<< std::endl;
+			errors++;
+		}
+		if (front != expected[Plane::Front] || back != expected[Plane::Back]
+			|| on != expected[Plane::On] || on.size() < 2)
+		{
+			std::cout << "classifyPoints: Wrong index lists." << std::endl;
+			errors++;
+		}
+	}
+	{
+		// Batch segment intersection
+		Plane plane(Vec3f(0, 0.6f, 0.8f), 0.5f);
+		const unsigned int count = 61;
+		std::vector<Vec3f> points1(count);
+		std::vector<Vec3f> points2(count);
+		srand(9);
+		for (unsigned int i = 0; i < count; i++)
+		{
+			points1[i] = Vec3f((float)(rand() % 2001 - 1000) / 500.0f,
+			                   (float)(rand() % 2001 - 1000) / 500.0f,
+			                   (float)(rand() % 2001 - 1000) / 500.0f);
+			points2[i] = Vec3f((float)(rand() % 2001 - 1000) / 500.0f,
+			                   (float)(rand() % 2001 - 1000) / 500.0f,
+			                   (float)(rand() % 2001 - 1000) / 500.0f);
+		}
+		// Parallel segments on and off the plane
+		points1[2] = Vec3f(1, 0, 0.625f);
+		points2[2] = Vec3f(-1, 0, 0.625f);
+		points1[3] = Vec3f(1, 0, 1);
+		points2[3] = Vec3f(-1, 0, 1);
+		points1[60] = Vec3f(0, 0, 0.625f);
+		points2[60] = Vec3f(2, 0, 0.625f);
+		std::vector<Vec3f> intersections(count);
+		std::vector<uint32> hitMask((count + 31) / 32);
+		size_t hits = plane.intersectWithLineSegments(&points1[0],
+		                                              &points2[0],
+		                                              count,
+		                                              &intersections[0],
+		                                              &hitMask[0]);
+		unsigned int expectedHits = 0;
+		unsigned int wrong = 0;
+		for (unsigned int i = 0; i < count; i++)
+		{
+			Vec3f expected;
+			bool hit = plane.intersectWithLineSegment(points1[i], points2[i], &expected);
+			bool batchHit = ((hitMask[i / 32] >> (i % 32)) & 1) != 0;
+			if (hit)
+				expectedHits++;
+			if (hit != batchHit)
+				wrong++;
+			else if (hit && (intersections[i] - expected).getSquaredLength() > 1e-8f)
+				wrong++;
+		}
+		if (wrong != 0 || hits != expectedHits
+			|| (hitMask[0] & 0xc) != 0x4 || (hitMask[1] & (1u << 28)) == 0)
+		{
+			std::cout << "intersectWithLineSegments: " << wrong
+				<< " wrong results, " << hits << "/" << expectedHits
+				<< " hits." << std::endl;
+			errors++;
+		}
+	}
+	{
+		// Polygon clipping
+		Plane plane(Vec3f(0, 0, 1), 0);
+		Vec3f square[4] = {
+			Vec3f(-1, -1, -1), Vec3f(1, -1, -1), Vec3f(1, 1, 1), Vec3f(-1, 1, 1)
+		};
+		Vec3f result[5];
+		unsigned int count = plane.clipPolygon(square, 4, result, 5);
+		bool inFront = true;
+		for (unsigned int i = 0; i < count; i++)
+			inFront = inFront && plane.getDistance(result[i]) >= 0.0f;
+		if (count != 4 || !inFront
+			|| std::fabs(polygonArea(result, count) - 2.0f * std::sqrt(2.0f)) > 1e-5f)
+		{
+			std::cout << "clipPolygon: Wrong result (" << count << " vertices)."
+				<< std::endl;
+			errors++;
+		}
+		if (Plane(Vec3f(0, 0, 1), -2).clipPolygon(square, 4, result, 5) != 4
+			|| Plane(Vec3f(0, 0, 1), 2).clipPolygon(square, 4, result, 5) != 0)
+		{
+			std::cout << "clipPolygon: Trivial cases failed." << std::endl;
+			errors++;
+		}
+	}
+	{
+		// Polygon clipping of a degenerate triangle at the corner of a
+		// frustum, the first clip leaves a slightly non-convex polygon
+		// which gains two vertices at the second plane (the exact result
+		// depends on the rounding, e.g., whether FMA is used)
+		Frustum frustum(Mat4f::Perspective(2, 2, 1, 100));
+		Vec3f triangle[3] = {
+			Vec3f(-0.999995887f, -1.00000226f, -0.999993682f),
+			Vec3f(-1.00000656f, -0.999998629f, -1.00000978f),
+			Vec3f(-1.0f, -1.00000083f, -0.99999994f)
+		};
+		Vec3f first[4];
+		Vec3f second[8];
+		unsigned int firstCount = frustum.planes[0].clipPolygon(triangle, 3,
+		                                                        first, 4);
+		// The result must not be written beyond maxCount
+		Vec3f guard(12345, 0, 0);
+		second[firstCount + 1] = guard;
+		unsigned int tooSmall = frustum.planes[1].clipPolygon(first, firstCount,
+		                                                      second,
+		                                                      firstCount + 1);
+		bool guardIntact = second[firstCount + 1] == guard;
+		unsigned int secondCount = frustum.planes[1].clipPolygon(first, firstCount,
+		                                                         second,
+		                                                         2 * firstCount);
+		bool fits = secondCount <= firstCount + 1;
+		if (firstCount < 3 || firstCount > 4 || !guardIntact
+			|| secondCount > 2 * firstCount
+			|| tooSmall != (fits ? secondCount : 0))
+		{
+			std::cout << "clipPolygon: Degenerate case failed (" << firstCount
+				<< ", " << tooSmall << ", " << secondCount << " vertices)."
+				<< std::endl;
+			errors++;
+		}
+	}
+	{
+		// Batch triangle clipping
+		Plane plane(Vec3f(0.6f, 0, 0.8f), 0.1f);
+		const unsigned int triangleCount = 50;
+		std::vector<Vec3f> vertices(3 * triangleCount);
+		srand(3);
+		for (unsigned int i = 0; i < 3 * triangleCount; i++)
+		{
+			vertices[i] = Vec3f((float)(rand() % 2001 - 1000) / 500.0f,
+			                    (float)(rand() % 2001 - 1000) / 500.0f,
+			                    (float)(rand() % 2001 - 1000) / 500.0f);
+		}
+		// Two triangles sharing an edge which crosses the plane
+		vertices[0] = Vec3f(-1, 0, -1);
+		vertices[1] = Vec3f(1, 0.3f, 1);
+		vertices[2] = Vec3f(-1, 1, 0.5f);
+		vertices[3] = vertices[1];
+		vertices[4] = vertices[0];
+		vertices[5] = Vec3f(0, -1, 0);
+		std::vector<Vec3f> result;
+		std::vector<uint32> sources;
+		unsigned int outputCount = plane.clipTriangles(&vertices[0],
+		                                               triangleCount,
+		                                               result,
+		                                               &sources);
+		float expectedArea = 0.0f;
+		for (unsigned int i = 0; i < triangleCount; i++)
+		{
+			Vec3f polygon[4];
+			unsigned int count = plane.clipPolygon(&vertices[3 * i], 3, polygon, 4);
+			expectedArea += polygonArea(polygon, count);
+		}
+		float area = 0.0f;
+		bool inFront = true;
+		for (unsigned int i = 0; i < result.size(); i++)
+			inFront = inFront && plane.getDistance(result[i]) > -1e-5f;
+		for (unsigned int i = 0; i < outputCount; i++)
+			area += polygonArea(&result[3 * i], 3);
+		if (result.size() != 3 * outputCount || sources.size() != outputCount
+			|| !inFront || std::fabs(area - expectedArea) > 1e-3f)
+		{
+			std::cout << "clipTriangles: Wrong result (area " << area
+				<< ", expected " << expectedArea << ")." << std::endl;
+			errors++;
+		}
+		// The shared edge has to be clipped at exactly the same point
+		Vec3f first[4];
+		Vec3f second[4];
+		unsigned int firstCount = plane.clipPolygon(&vertices[0], 3, first, 4);
+		unsigned int secondCount = plane.clipPolygon(&vertices[3], 3, second, 4);
+		unsigned int shared = 0;
+		for (unsigned int i = 0; i < firstCount; i++)
+		{
+			for (unsigned int j = 0; j < secondCount; j++)
+			{
+				if (first[i] == second[j])
+					shared++;
+			}
+		}
+		if (firstCount == 0 || secondCount == 0 || shared != 2)
+		{
+			std::cout << "clipTriangles: Shared edge clipped differently."
+				<< std::endl;
+			errors++;
+		}
+	}
 	std::cout << errors << " errors." << std::endl;
 	return errors;
 }
@@ -0,0 +1,277 @@
+/*
+Copyright (C) 2011, Mathias Gottschlag
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "GameMath.hpp"
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+using namespace math;
+
+static float randomFloat(float min, float max)
+{
+	return min + (max - min) * (float)rand() / (float)RAND_MAX;
+}
+
+static Quaternion randomQuaternion()
+{
+	return Quaternion(Vec3f(randomFloat(0, 360), randomFloat(0, 360),
+	                        randomFloat(0, 360)));
+}
+
+/**
+ * Returns the rotation angle between two rotations in radians.
+ */
+static float angleBetween(const Quaternion &a, const Quaternion &b)
+{
+	// acos() is inaccurate for small angles, so the angle is computed from
+	// the distance between the quaternions instead
+	float sign = a.dot(b) < 0.0f ? -1.0f : 1.0f;
+	Quaternion difference = a - b * sign;
+	double distance = std::sqrt((double)difference.dot(difference));
+	if (distance > 2.0)
+		distance = 2.0;
+	return (float)(4.0 * std::asin(distance * 0.5));
+}
+
+static bool isEqual(const Quaternion &a, const Quaternion &b, float epsilon)
+{
+	return std::fabs(a.x - b.x) <= epsilon && std::fabs(a.y - b.y) <= epsilon
+	    && std::fabs(a.z - b.z) <= epsilon && std::fabs(a.w - b.w) <= epsilon;
+}
+
+static bool isEqual(const Mat4f &a, const Mat4f &b, float epsilon)
+{
+	for (unsigned int i = 0; i < 16; i++)
+	{
+		if (std::fabs(a.m[i] - b.m[i]) > epsilon)
+			return false;
+	}
+	return true;
+}
+
+static bool isEqual(const Vec3f &a, const Vec3f &b, float epsilon)
+{
+	return std::fabs(a.x - b.x) <= epsilon && std::fabs(a.y - b.y) <= epsilon
+	    && std::fabs(a.z - b.z) <= epsilon;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int errors = 0;
+	srand(1);
+	{
+		// Multiplication has to match the matrix product
+		unsigned int wrong = 0;
+		for (unsigned int i = 0; i < 50; i++)
+		{
+			Quaternion a = randomQuaternion();
+			Quaternion b = randomQuaternion();
+			if (!isEqual((a * b).toMatrix(), a.toMatrix() * b.toMatrix(), 1e-5f))
+				wrong++;
+			Quaternion c = a;
+			c *= b;
+			if (!isEqual(c, a * b, 1e-6f))
+				wrong++;
+		}
+		if (wrong != 0)
+		{
+			std::cout << "operator*: " << wrong << " wrong results." << std::endl;
+			errors++;
+		}
+	}
+	{
+		// Conjugate and inverse
+		Quaternion a = randomQuaternion();
+		Quaternion identity;
+		if (!isEqual(a * a.conjugate(), identity, 1e-6f)
+		 || !isEqual(a.conjugate() * a, identity, 1e-6f))
+		{
+			std::cout << "conjugate() wrong." << std::endl;
+			errors++;
+		}
+		Quaternion b = a * 3.0f;
+		if (!isEqual(b * b.inverse(), identity, 1e-6f)
+		 || !isEqual(b.inverse(), a.conjugate() / 3.0f, 1e-6f))
+		{
+			std::cout << "inverse() wrong." << std::endl;
+			errors++;
+		}
+	}
+	{
+		// Vector rotation has to match the rotation matrix, odd count to
+		// test the scalar tail
+		const unsigned int count = 23;
+		Quaternion q = randomQuaternion();
+		Mat4f matrix = q.toMatrix();
+		std::vector<Vec3f> vectors(count);
+		for (unsigned int i = 0; i < count; i++)
+		{
+			vectors[i] = Vec3f(randomFloat(-10, 10), randomFloat(-10, 10),
+			                   randomFloat(-10, 10));
+		}
+		std::vector<Vec3f> rotated(count);
+		q.rotate(&vectors[0], &rotated[0], count);
+		unsigned int wrong = 0;
+		for (unsigned int i = 0; i < count; i++)
+		{
+			Vec3f expected = matrix.transformPoint(vectors[i]);
+			if (!isEqual(q.rotate(vectors[i]), expected, 1e-4f))
+				wrong++;
+			if (!isEqual(rotated[i], expected, 1e-4f))
+				wrong++;
+		}
+		if (!isEqual(Quaternion(Vec3f(0, 0, 90)).rotate(Vec3f(1, 0, 0)),
+		             Vec3f(0, 1, 0), 1e-6f))
+			wrong++;
+		if (wrong != 0)
+		{
+			std::cout << "rotate(): " << wrong << " wrong results." << std::endl;
+			errors++;
+		}
+	}
+	{
+		// nlerp
+		Quaternion a(Vec3f(0, 0, 0));
+		Quaternion b(Vec3f(0, 0, 90));
+		Quaternion result;
+		if (!isEqual(result.nlerp(a, b, 0.0f), a, 1e-6f)
+		 || !isEqual(result.nlerp(a, b, 1.0f), b, 1e-6f))
+		{
+			std::cout << "nlerp: Wrong end points." << std::endl;
+			errors++;
+		}
+		// The shortest path has to be used for negated quaternions
+		Quaternion expected;
+		expected.nlerp(a, b, 0.3f);
+		result.nlerp(a, b * -1.0f, 0.3f);
+		if (!isEqual(result, expected, 1e-6f)
+		 || std::fabs(result.dot(result) - 1.0f) > 1e-5f)
+		{
+			std::cout << "nlerp: Wrong hemisphere." << std::endl;
+			errors++;
+		}
+	}
+	{
+		// slerp, the angular velocity has to be constant
+		Quaternion a(Vec3f(0, 0, 0));
+		Quaternion b(Vec3f(0, 0, 120));
+		Quaternion result;
+		result.slerp(a, b, 0.5f);
+		if (!isEqual(result, Quaternion(Vec3f(0, 0, 60)), 1e-5f))
+		{
+			std::cout << "slerp: Wrong result." << std::endl;
+			errors++;
+		}
+		unsigned int wrong = 0;
+		for (unsigned int i = 0; i < 100; i++)
+		{
+			a = randomQuaternion();
+			b = randomQuaternion();
+			if (i % 4 == 0)
+				b = b * -1.0f;
+			float angle = angleBetween(a, b);
+			float d = randomFloat(0, 1);
+			result.slerp(a, b, d);
+			if (std::fabs(angleBetween(a, result) - d * angle) > 1e-3f
+			 || std::fabs(angleBetween(result, b) - (1.0f - d) * angle) > 1e-3f)
+				wrong++;
+		}
+		// Nearly identical quaternions
+		result.slerp(a, a, 0.5f);
+		if (!isEqual(result, a, 1e-6f))
+			wrong++;
+		if (wrong != 0)
+		{
+			std::cout << "slerp: " << wrong << " wrong results." << std::endl;
+			errors++;
+		}
+	}
+	{
+		// fastSlerp has to be close to slerp
+		float maxError = 0.0f;
+		for (unsigned int i = 0; i < 1000; i++)
+		{
+			Quaternion a = randomQuaternion();
+			Quaternion b = randomQuaternion();
+			float d = (float)(i % 11) / 10.0f;
+			Quaternion exact;
+			exact.slerp(a, b, d);
+			Quaternion approximate;
+			approximate.fastSlerp(a, b, d);
+			float error = angleBetween(exact, approximate);
+			if (error > maxError)
+				maxError = error;
+		}
+		if (maxError > 1e-3f)
+		{
+			std::cout << "fastSlerp: Error too large: " << maxError << std::endl;
+			errors++;
+		}
+	}
+	{
+		// Batch blending has to match the single versions, odd count to
+		// test the scalar tail
+		const unsigned int count = 37;
+		std::vector<Quaternion> a(count);
+		std::vector<Quaternion> b(count);
+		std::vector<float> weights(count);
+		for (unsigned int i = 0; i < count; i++)
+		{
+			a[i] = randomQuaternion();
+			b[i] = randomQuaternion();
+			weights[i] = randomFloat(0, 1);
+		}
+		std::vector<Quaternion> nlerpResult(count);
+		std::vector<Quaternion> nlerpWeighted(count);
+		std::vector<Quaternion> fastResult(count);
+		std::vector<Quaternion> fastWeighted(b);
+		Quaternion::nlerp(&a[0], &b[0], 0.25f, &nlerpResult[0], count);
+		Quaternion::nlerp(&a[0], &b[0], &weights[0], &nlerpWeighted[0], count);
+		Quaternion::fastSlerp(&a[0], &b[0], 0.25f, &fastResult[0], count);
+		// In-place blending
+		Quaternion::fastSlerp(&a[0], &fastWeighted[0], &weights[0],
+		                      &fastWeighted[0], count);
+		unsigned int wrong = 0;
+		for (unsigned int i = 0; i < count; i++)
+		{
+			Quaternion expected;
+			if (!isEqual(nlerpResult[i], expected.nlerp(a[i], b[i], 0.25f), 1e-5f))
+				wrong++;
+			if (!isEqual(nlerpWeighted[i], expected.nlerp(a[i], b[i], weights[i]), 1e-5f))
+				wrong++;
+			if (!isEqual(fastResult[i], expected.fastSlerp(a[i], b[i], 0.25f), 1e-5f))
+				wrong++;
+			if (!isEqual(fastWeighted[i], expected.fastSlerp(a[i], b[i], weights[i]), 1e-5f))
+				wrong++;
+		}
+		if (wrong != 0)
+		{
+			std::cout << "Batch blending: " << wrong << " wrong results."
+				<< std::endl;
+			errors++;
+		}
+	}
+	std::cout << errors << " errors." << std::endl;
+	return errors;
+}
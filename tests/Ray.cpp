@@ -0,0 +1,520 @@
+/*
+Copyright (C) 2011, Mathias Gottschlag
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "GameMath.hpp"
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+using namespace math;
+
+static float randomFloat(float min, float max)
+{
+	return min + (max - min) * (float)rand() / (float)RAND_MAX;
+}
+
+static Vec3f randomVec3(float min, float max)
+{
+	return Vec3f(randomFloat(min, max), randomFloat(min, max),
+	             randomFloat(min, max));
+}
+
+static BoundingBox randomBox()
+{
+	Vec3f center = randomVec3(-10, 10);
+	Vec3f size = randomVec3(0.1f, 4);
+	return BoundingBox(center - size, center + size);
+}
+
+static Ray randomRay()
+{
+	Vec3f direction = randomVec3(-1, 1);
+	// Some rays are parallel to the axes
+	if (rand() % 8 == 0)
+		direction.x = 0;
+	if (rand() % 8 == 0)
+		direction.y = 0;
+	return Ray(randomVec3(-15, 15), direction);
+}
+
+/**
+ * Reference implementation which clips the ray against the slabs with
+ * branches.
+ */
+static bool intersectReference(const Ray &ray, const BoundingBox &box, float maxDistance)
+{
+	float tmin = 0;
+	float tmax = maxDistance;
+	for (unsigned int i = 0; i < 3; i++)
+	{
+		float o = (&ray.origin.x)[i];
+		float d = (&ray.getDirection().x)[i];
+		float min = (&box.minCorner.x)[i];
+		float max = (&box.maxCorner.x)[i];
+		if (d == 0)
+		{
+			if (o < min || o > max)
+				return false;
+			continue;
+		}
+		float t1 = (min - o) / d;
+		float t2 = (max - o) / d;
+		if (t1 > t2)
+			std::swap(t1, t2);
+		tmin = std::max(tmin, t1);
+		tmax = std::min(tmax, t2);
+	}
+	return tmin <= tmax;
+}
+
+static Vec3f randomTriangleVertex()
+{
+	return randomVec3(-10, 10);
+}
+
+/**
+ * Möller-Trumbore in double precision. Returns 0 if the ray misses the
+ * triangle, 1 if it hits it and 2 if the result is too close to an edge or
+ * the end of the ray to be reliable in single precision.
+ */
+static int intersectReference(const Ray &ray, const Vec3f *triangle, float maxDistance)
+{
+	double v0[3], edge1[3], edge2[3], o[3], d[3];
+	for (unsigned int i = 0; i < 3; i++)
+	{
+		v0[i] = (&triangle[0].x)[i];
+		edge1[i] = (&triangle[1].x)[i] - v0[i];
+		edge2[i] = (&triangle[2].x)[i] - v0[i];
+		o[i] = (&ray.origin.x)[i] - v0[i];
+		d[i] = (&ray.getDirection().x)[i];
+	}
+	double p[3] = {d[1] * edge2[2] - d[2] * edge2[1],
+	               d[2] * edge2[0] - d[0] * edge2[2],
+	               d[0] * edge2[1] - d[1] * edge2[0]};
+	double q[3] = {o[1] * edge1[2] - o[2] * edge1[1],
+	               o[2] * edge1[0] - o[0] * edge1[2],
+	               o[0] * edge1[1] - o[1] * edge1[0]};
+	double det = edge1[0] * p[0] + edge1[1] * p[1] + edge1[2] * p[2];
+	if (std::fabs(det) < 1e-3)
+		return 2;
+	double u = (o[0] * p[0] + o[1] * p[1] + o[2] * p[2]) / det;
+	double v = (d[0] * q[0] + d[1] * q[1] + d[2] * q[2]) / det;
+	double t = (edge2[0] * q[0] + edge2[1] * q[1] + edge2[2] * q[2]) / det;
+	const double epsilon = 1e-3;
+	if (std::fabs(u) < epsilon || std::fabs(v) < epsilon
+	 || std::fabs(u + v - 1) < epsilon || std::fabs(t) < epsilon
+	 || std::fabs(t - maxDistance) < epsilon)
+		return 2;
+	return u >= 0 && v >= 0 && u + v <= 1 && t >= 0 && t <= maxDistance;
+}
+
+static bool isClose(const Ray::TriangleHit &a, float distance, float u, float v)
+{
+	return std::fabs(a.distance - distance) < 1e-3f * std::max(1.0f, distance)
+	    && std::fabs(a.u - u) < 1e-3f && std::fabs(a.v - v) < 1e-3f;
+}
+
+static unsigned int testTriangles()
+{
+	unsigned int wrong = 0;
+	for (unsigned int i = 0; i < 10000; i++)
+	{
+		Ray ray = randomRay();
+		Vec3f triangle[3] = {randomTriangleVertex(), randomTriangleVertex(),
+		                     randomTriangleVertex()};
+		int expected = intersectReference(ray, triangle, 30.0f);
+		Ray::TriangleHit hit1 = {0, 0, 0};
+		Ray::TriangleHit hit2 = {0, 0, 0};
+		bool hit = ray.intersectTriangle(triangle[0], triangle[1], triangle[2], 30.0f, &hit1);
+		bool watertightHit = ray.intersectTriangleWatertight(triangle[0], triangle[1],
+		                                                     triangle[2], 30.0f, &hit2);
+		if (expected == 2)
+			continue;
+		if (hit != (expected == 1) || watertightHit != (expected == 1))
+			wrong++;
+		else if (hit && !isClose(hit1, hit2.distance, hit2.u, hit2.v))
+			wrong++;
+	}
+	return wrong;
+}
+
+/**
+ * Shoots rays at the shared edges and vertices of a triangulated height
+ * field, the watertight test has to hit at least one triangle for every
+ * ray. The rays are steeper than the height field, otherwise a ray could
+ * graze a silhouette edge and legitimately miss both triangles.
+ */
+static unsigned int testWatertight()
+{
+	std::vector<Vec3f> vertices;
+	for (unsigned int y = 0; y < 4; y++)
+	{
+		for (unsigned int x = 0; x < 4; x++)
+		{
+			vertices.push_back(Vec3f(x * 0.37f + 0.1f, y * 0.29f - 0.3f,
+			                         randomFloat(-0.03f, 0.03f)));
+		}
+	}
+	std::vector<unsigned int> indices;
+	for (unsigned int y = 0; y < 3; y++)
+	{
+		for (unsigned int x = 0; x < 3; x++)
+		{
+			unsigned int i = y * 4 + x;
+			unsigned int quad[6] = {i, i + 1, i + 5, i, i + 5, i + 4};
+			indices.insert(indices.end(), quad, quad + 6);
+		}
+	}
+	unsigned int triangleCount = (unsigned int)indices.size() / 3;
+	Vec3Streamf v0(triangleCount);
+	Vec3Streamf v1(triangleCount);
+	Vec3Streamf v2(triangleCount);
+	for (unsigned int i = 0; i < triangleCount; i++)
+	{
+		v0.set(i, vertices[indices[3 * i]]);
+		v1.set(i, vertices[indices[3 * i + 1]]);
+		v2.set(i, vertices[indices[3 * i + 2]]);
+	}
+	unsigned int misses = 0;
+	for (unsigned int i = 0; i < 2000; i++)
+	{
+		// Target a point on an inner edge or an inner vertex
+		unsigned int x = 1 + rand() % 2;
+		unsigned int y = 1 + rand() % 2;
+		const Vec3f &corner = vertices[y * 4 + x];
+		Vec3f target = corner;
+		float f = randomFloat(0, 1);
+		switch (rand() % 4)
+		{
+			case 0:
+				target = corner + (vertices[y * 4 + x + 1] - corner) * f;
+				break;
+			case 1:
+				target = corner + (vertices[y * 4 + x + 4] - corner) * f;
+				break;
+			case 2:
+				target = corner + (vertices[y * 4 + x + 5] - corner) * f;
+				break;
+			default:
+				break;
+		}
+		Vec3f origin(randomFloat(-0.5f, 1.5f), randomFloat(-0.5f, 1.5f),
+		             randomFloat(2, 3) * (rand() % 2 == 0 ? 1 : -1));
+		Ray ray(origin, target - origin);
+		bool hit = false;
+		for (unsigned int j = 0; j < triangleCount; j++)
+		{
+			hit = hit || ray.intersectTriangleWatertight(v0.get(j), v1.get(j), v2.get(j), 2.0f);
+		}
+		uint32 hitMask[1];
+		ray.intersectTriangles(v0, v1, v2, 2.0f, hitMask, 0, true);
+		if (!hit || hitMask[0] == 0)
+			misses++;
+	}
+	return misses;
+}
+
+template<typename F> static unsigned int testSoa()
+{
+	unsigned int wrong = 0;
+	const unsigned int width = F::Width;
+	for (unsigned int i = 0; i < 200; i++)
+	{
+		Ray ray = randomRay();
+		BoundingBox boxes[width];
+		float values[6][width];
+		for (unsigned int j = 0; j < width; j++)
+		{
+			boxes[j] = randomBox();
+			values[0][j] = boxes[j].minCorner.x;
+			values[1][j] = boxes[j].minCorner.y;
+			values[2][j] = boxes[j].minCorner.z;
+			values[3][j] = boxes[j].maxCorner.x;
+			values[4][j] = boxes[j].maxCorner.y;
+			values[5][j] = boxes[j].maxCorner.z;
+		}
+		F distance;
+		int mask = ray.intersect(F::load(values[0]), F::load(values[1]),
+		                         F::load(values[2]), F::load(values[3]),
+		                         F::load(values[4]), F::load(values[5]),
+		                         30.0f, &distance);
+		for (unsigned int j = 0; j < width; j++)
+		{
+			float expectedDistance;
+			bool hit = ray.intersect(boxes[j], 30.0f, &expectedDistance);
+			if (hit != ((mask >> j) & 1) || (hit && distance.get(j) != expectedDistance))
+				wrong++;
+		}
+		// Packets
+		Ray rays[width];
+		for (unsigned int j = 0; j < width; j++)
+			rays[j] = randomRay();
+		RayPacket<F> packet(rays);
+		mask = packet.intersect(boxes[0], F(30.0f), &distance);
+		for (unsigned int j = 0; j < width; j++)
+		{
+			float expectedDistance;
+			bool hit = rays[j].intersect(boxes[0], 30.0f, &expectedDistance);
+			if (hit != ((mask >> j) & 1) || (hit && distance.get(j) != expectedDistance))
+				wrong++;
+		}
+		// Triangles
+		Vec3f triangles[width][3];
+		F vertices[3][3];
+		for (unsigned int k = 0; k < 3; k++)
+		{
+			float values[3][width];
+			for (unsigned int j = 0; j < width; j++)
+			{
+				triangles[j][k] = randomTriangleVertex();
+				values[0][j] = triangles[j][k].x;
+				values[1][j] = triangles[j][k].y;
+				values[2][j] = triangles[j][k].z;
+			}
+			for (unsigned int l = 0; l < 3; l++)
+				vertices[k][l] = F::load(values[l]);
+		}
+		F u;
+		F v;
+		for (unsigned int watertight = 0; watertight < 2; watertight++)
+		{
+			if (watertight)
+				mask = ray.intersectTrianglesWatertight(vertices[0], vertices[1], vertices[2],
+				                                        30.0f, &distance, &u, &v);
+			else
+				mask = ray.intersectTriangles(vertices[0], vertices[1], vertices[2],
+				                              30.0f, &distance, &u, &v);
+			for (unsigned int j = 0; j < width; j++)
+			{
+				// Results close to the edges can differ under FMA
+				if (intersectReference(ray, triangles[j], 30.0f) == 2)
+					continue;
+				Ray::TriangleHit expectedHit = {0, 0, 0};
+				bool hit;
+				if (watertight)
+					hit = ray.intersectTriangleWatertight(triangles[j][0], triangles[j][1],
+					                                      triangles[j][2], 30.0f, &expectedHit);
+				else
+					hit = ray.intersectTriangle(triangles[j][0], triangles[j][1],
+					                            triangles[j][2], 30.0f, &expectedHit);
+				if (hit != ((mask >> j) & 1)
+				 || (hit && !isClose(expectedHit, distance.get(j), u.get(j), v.get(j))))
+					wrong++;
+			}
+		}
+	}
+	return wrong;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int errors = 0;
+	{
+		// Single box
+		unsigned int wrong = 0;
+		for (unsigned int i = 0; i < 10000; i++)
+		{
+			Ray ray = randomRay();
+			BoundingBox box = randomBox();
+			if (ray.intersect(box, 30.0f) != intersectReference(ray, box, 30.0f))
+				wrong++;
+		}
+		if (wrong != 0)
+		{
+			std::cout << wrong << " single ray tests wrong." << std::endl;
+			errors++;
+		}
+	}
+	{
+		// Special cases
+		BoundingBox box(Vec3f(-1, -1, -1), Vec3f(1, 1, 1));
+		float distance;
+		if (!Ray(Vec3f(0, 0, -5), Vec3f(0, 0, 1)).intersect(box, 10, &distance)
+		 || distance != 4.0f)
+		{
+			std::cout << "Entry distance wrong." << std::endl;
+			errors++;
+		}
+		if (!Ray(Vec3f(0, 0, 0), Vec3f(0, 1, 0)).intersect(box, 10, &distance)
+		 || distance != 0.0f)
+		{
+			std::cout << "Origin inside of the box wrong." << std::endl;
+			errors++;
+		}
+		if (Ray(Vec3f(0, 0, -5), Vec3f(0, 0, 1)).intersect(box, 3.9f)
+		 || Ray(Vec3f(0, 0, -5), Vec3f(0, 0, -1)).intersect(box, 10))
+		{
+			std::cout << "Ray length or direction ignored." << std::endl;
+			errors++;
+		}
+		// Parallel to the sides of the box, in the plane of a side
+		if (!Ray(Vec3f(1, 0, -5), Vec3f(0, 0, 1)).intersect(box, 10)
+		 || !Ray(Vec3f(1, 1, -5), Vec3f(0, 0, 1)).intersect(box, 10)
+		 || Ray(Vec3f(1.01f, 0, -5), Vec3f(0, 0, 1)).intersect(box, 10))
+		{
+			std::cout << "Axis-parallel ray wrong." << std::endl;
+			errors++;
+		}
+		if (!(Ray(Vec3f(1, 2, 3), Vec3f(0, 0, 2)).getPoint(1.5f) == Vec3f(1, 2, 6)))
+		{
+			std::cout << "getPoint() wrong." << std::endl;
+			errors++;
+		}
+	}
+	{
+		// Triangles
+		Ray::TriangleHit hit = {0, 0, 0};
+		Vec3f v0(0, 0, 0);
+		Vec3f v1(1, 0, 0);
+		Vec3f v2(0, 1, 0);
+		Ray ray(Vec3f(0.25f, 0.5f, -1), Vec3f(0, 0, 1));
+		if (!ray.intersectTriangle(v0, v1, v2, 10, &hit)
+		 || hit.distance != 1.0f || hit.u != 0.25f || hit.v != 0.5f
+		 || !ray.intersectTriangleWatertight(v0, v1, v2, 10, &hit)
+		 || hit.distance != 1.0f || hit.u != 0.25f || hit.v != 0.5f)
+		{
+			std::cout << "Triangle hit wrong." << std::endl;
+			errors++;
+		}
+		// Back side, too short and parallel
+		Ray back(Vec3f(0.25f, 0.5f, 1), Vec3f(0, 0, -1));
+		Ray parallel(Vec3f(0.25f, 0.5f, 0), Vec3f(1, 0, 0));
+		if (!back.intersectTriangle(v0, v1, v2, 10)
+		 || !back.intersectTriangleWatertight(v0, v1, v2, 10)
+		 || ray.intersectTriangle(v0, v1, v2, 0.9f)
+		 || ray.intersectTriangleWatertight(v0, v1, v2, 0.9f)
+		 || parallel.intersectTriangle(v0, v1, v2, 10)
+		 || parallel.intersectTriangleWatertight(v0, v1, v2, 10))
+		{
+			std::cout << "Triangle special cases wrong." << std::endl;
+			errors++;
+		}
+		unsigned int wrong = testTriangles();
+		if (wrong != 0)
+		{
+			std::cout << wrong << " triangle tests wrong." << std::endl;
+			errors++;
+		}
+		unsigned int misses = testWatertight();
+		if (misses != 0)
+		{
+			std::cout << misses << " rays passed through a closed mesh." << std::endl;
+			errors++;
+		}
+	}
+	{
+		// Triangle streams
+		const unsigned int count = 53;
+		std::vector<Vec3f> vertices(3 * count);
+		Vec3Streamf v0(count);
+		Vec3Streamf v1(count);
+		Vec3Streamf v2(count);
+		for (unsigned int i = 0; i < count; i++)
+		{
+			for (unsigned int j = 0; j < 3; j++)
+				vertices[3 * i + j] = randomTriangleVertex();
+			v0.set(i, vertices[3 * i]);
+			v1.set(i, vertices[3 * i + 1]);
+			v2.set(i, vertices[3 * i + 2]);
+		}
+		unsigned int wrong = 0;
+		for (unsigned int i = 0; i < 200; i++)
+		{
+			Ray ray = randomRay();
+			uint32 hitMask[(count + 31) / 32];
+			std::vector<Ray::TriangleHit> hits(count);
+			bool watertight = i % 2 == 0;
+			ray.intersectTriangles(v0, v1, v2, 30.0f, hitMask, &hits[0], watertight);
+			for (unsigned int j = 0; j < (count + 31) / 32 * 32; j++)
+			{
+				bool hit = (((hitMask[j / 32] >> (j % 32)) & 1) != 0);
+				if (j >= count)
+				{
+					if (hit)
+						wrong++;
+					continue;
+				}
+				if (intersectReference(ray, &vertices[3 * j], 30.0f) == 2)
+					continue;
+				Ray::TriangleHit expectedHit = {0, 0, 0};
+				bool expected;
+				if (watertight)
+					expected = ray.intersectTriangleWatertight(vertices[3 * j], vertices[3 * j + 1],
+					                                           vertices[3 * j + 2], 30.0f, &expectedHit);
+				else
+					expected = ray.intersectTriangle(vertices[3 * j], vertices[3 * j + 1],
+					                                 vertices[3 * j + 2], 30.0f, &expectedHit);
+				if (hit != expected
+				 || (hit && !isClose(expectedHit, hits[j].distance, hits[j].u, hits[j].v)))
+					wrong++;
+			}
+		}
+		if (wrong != 0)
+		{
+			std::cout << wrong << " triangle stream tests wrong." << std::endl;
+			errors++;
+		}
+	}
+	{
+		// SoA boxes and packets
+		unsigned int wrong = testSoa<Float4>() + testSoa<Float8>();
+		if (wrong != 0)
+		{
+			std::cout << wrong << " SIMD tests wrong." << std::endl;
+			errors++;
+		}
+	}
+	{
+		// Box streams
+		const unsigned int count = 107;
+		std::vector<BoundingBox> boxes(count);
+		Vec3Streamf minCorners(count);
+		Vec3Streamf maxCorners(count);
+		for (unsigned int i = 0; i < count; i++)
+		{
+			boxes[i] = randomBox();
+			minCorners.set(i, boxes[i].minCorner);
+			maxCorners.set(i, boxes[i].maxCorner);
+		}
+		unsigned int wrong = 0;
+		for (unsigned int i = 0; i < 100; i++)
+		{
+			Ray ray = randomRay();
+			uint32 hitMask[(count + 31) / 32];
+			ray.intersect(minCorners, maxCorners, 30.0f, hitMask);
+			for (unsigned int j = 0; j < (count + 31) / 32 * 32; j++)
+			{
+				bool hit = j < count && ray.intersect(boxes[j], 30.0f);
+				if (hit != (((hitMask[j / 32] >> (j % 32)) & 1) != 0))
+					wrong++;
+			}
+		}
+		if (wrong != 0)
+		{
+			std::cout << wrong << " stream tests wrong." << std::endl;
+			errors++;
+		}
+	}
+	std::cout << errors << " errors." << std::endl;
+	return errors;
+}
@@ -0,0 +1,186 @@
+/*
+Copyright (C) 2011, Mathias Gottschlag
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "GameMath.hpp"
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+using namespace math;
+
+static float randomFloat(float min, float max)
+{
+	return min + (max - min) * (float)rand() / (float)RAND_MAX;
+}
+
+static Vec3f randomVec3(float min, float max)
+{
+	return Vec3f(randomFloat(min, max), randomFloat(min, max),
+	             randomFloat(min, max));
+}
+
+static bool isEqual(const Mat4f &a, const Mat4f &b, float epsilon)
+{
+	for (unsigned int i = 0; i < 16; i++)
+	{
+		if (std::fabs(a.m[i] - b.m[i]) > epsilon)
+			return false;
+	}
+	return true;
+}
+
+/**
+ * Random local pose of a skeleton.
+ */
+struct LocalPose
+{
+	LocalPose(unsigned int boneCount)
+		: rotations(boneCount), translations(boneCount), scales(boneCount)
+	{
+		for (unsigned int i = 0; i < boneCount; i++)
+		{
+			rotations[i] = Quaternion(randomVec3(0, 360));
+			translations[i] = randomVec3(-2, 2);
+			scales[i] = randomVec3(0.5f, 1.5f);
+		}
+	}
+
+	std::vector<Quaternion> rotations;
+	std::vector<Vec3f> translations;
+	std::vector<Vec3f> scales;
+};
+
+int main(int argc, char **argv)
+{
+	unsigned int errors = 0;
+	srand(2);
+	// Odd bone count to test the scalar tail, bones 0 and 5 are roots
+	const unsigned int boneCount = 11;
+	std::vector<uint32> parents(boneCount);
+	std::vector<Mat4f> inverseBindPose(boneCount);
+	for (unsigned int i = 0; i < boneCount; i++)
+	{
+		parents[i] = i == 0 || i == 5 ? Skeleton::NoParent : (uint32)(rand() % i);
+		inverseBindPose[i] = (Mat4f::TransMat(randomVec3(-5, 5))
+		                   * Quaternion(randomVec3(0, 360)).toMatrix()).inverse();
+	}
+	Skeleton skeleton(&parents[0], &inverseBindPose[0], boneCount);
+	Mat4f root = Mat4f::TransMat(Vec3f(1, 2, 3)) * Mat4f::EulerRotation(Vec3f(0, 90, 0));
+	{
+		// Local matrices
+		LocalPose pose(boneCount);
+		std::vector<Mat4f> local(boneCount);
+		Skeleton::composeLocal(&pose.rotations[0], &pose.translations[0],
+		                       &pose.scales[0], &local[0], boneCount);
+		unsigned int wrong = 0;
+		for (unsigned int i = 0; i < boneCount; i++)
+		{
+			Mat4f expected = Mat4f::TransMat(pose.translations[i])
+			               * pose.rotations[i].toMatrix()
+			               * Mat4f::ScaleMat(pose.scales[i]);
+			if (!isEqual(local[i], expected, 1e-5f))
+				wrong++;
+		}
+		if (wrong != 0)
+		{
+			std::cout << "composeLocal(): " << wrong << " wrong matrices."
+				<< std::endl;
+			errors++;
+		}
+	}
+	{
+		// Palettes have to match the product of the individual matrices
+		LocalPose pose(boneCount);
+		std::vector<Mat4f> world(boneCount);
+		std::vector<Mat4f> skinning(boneCount);
+		skeleton.computePalettes(&pose.rotations[0], &pose.translations[0],
+		                         &pose.scales[0], &world[0], &skinning[0],
+		                         &root);
+		std::vector<Mat4f> expectedWorld(boneCount);
+		unsigned int wrong = 0;
+		for (unsigned int i = 0; i < boneCount; i++)
+		{
+			Mat4f local = Mat4f::TransMat(pose.translations[i])
+			            * pose.rotations[i].toMatrix()
+			            * Mat4f::ScaleMat(pose.scales[i]);
+			if (parents[i] == Skeleton::NoParent)
+				expectedWorld[i] = root * local;
+			else
+				expectedWorld[i] = expectedWorld[parents[i]] * local;
+			if (!isEqual(world[i], expectedWorld[i], 1e-4f))
+				wrong++;
+			if (!isEqual(skinning[i], expectedWorld[i] * inverseBindPose[i], 1e-4f))
+				wrong++;
+		}
+		if (wrong != 0)
+		{
+			std::cout << "computePalettes(): " << wrong << " wrong matrices."
+				<< std::endl;
+			errors++;
+		}
+	}
+	{
+		// Multithreaded computation has to produce the same results
+		const unsigned int poseCount = 37;
+		std::vector<LocalPose> poses;
+		for (unsigned int i = 0; i < poseCount; i++)
+			poses.push_back(LocalPose(boneCount));
+		std::vector<Mat4f> world(poseCount * boneCount);
+		std::vector<Mat4f> skinning(poseCount * boneCount);
+		std::vector<Skeleton::Pose> jobs(poseCount);
+		for (unsigned int i = 0; i < poseCount; i++)
+		{
+			jobs[i].rotations = &poses[i].rotations[0];
+			jobs[i].translations = &poses[i].translations[0];
+			jobs[i].scales = &poses[i].scales[0];
+			jobs[i].root = i % 2 == 0 ? &root : 0;
+			jobs[i].world = &world[i * boneCount];
+			jobs[i].skinning = &skinning[i * boneCount];
+		}
+		ThreadPool pool(4);
+		skeleton.computePalettes(pool, &jobs[0], poseCount);
+		unsigned int wrong = 0;
+		for (unsigned int i = 0; i < poseCount; i++)
+		{
+			std::vector<Mat4f> expectedWorld(boneCount);
+			std::vector<Mat4f> expectedSkinning(boneCount);
+			skeleton.computePalettes(jobs[i].rotations, jobs[i].translations,
+			                         jobs[i].scales, &expectedWorld[0],
+			                         &expectedSkinning[0], jobs[i].root);
+			for (unsigned int j = 0; j < boneCount; j++)
+			{
+				if (world[i * boneCount + j] != expectedWorld[j]
+				 || skinning[i * boneCount + j] != expectedSkinning[j])
+					wrong++;
+			}
+		}
+		if (wrong != 0)
+		{
+			std::cout << "computePalettes(ThreadPool): " << wrong
+				<< " wrong matrices." << std::endl;
+			errors++;
+		}
+	}
+	std::cout << errors << " errors." << std::endl;
+	return errors;
+}
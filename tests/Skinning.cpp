@@ -0,0 +1,158 @@
+/*
+Copyright (C) 2011, Mathias Gottschlag
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "GameMath.hpp"
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+using namespace math;
+
+static float randomFloat(float min, float max)
+{
+	return min + (max - min) * (float)rand() / (float)RAND_MAX;
+}
+
+static Vec3f randomVec3(float min, float max)
+{
+	return Vec3f(randomFloat(min, max), randomFloat(min, max),
+	             randomFloat(min, max));
+}
+
+static bool isEqual(const Vec3f &a, const Vec3f &b, float epsilon)
+{
+	return std::fabs(a.x - b.x) <= epsilon && std::fabs(a.y - b.y) <= epsilon
+	    && std::fabs(a.z - b.z) <= epsilon;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int errors = 0;
+	srand(6);
+	const unsigned int boneCount = 16;
+	std::vector<Mat4f> matrices(boneCount);
+	std::vector<DualQuaternion> dualQuaternions(boneCount);
+	for (unsigned int i = 0; i < boneCount; i++)
+	{
+		Quaternion rotation(randomVec3(0, 360));
+		// Some rotations in the other hemisphere
+		if (i % 3 == 0)
+			rotation = rotation * -1.0f;
+		Vec3f translation = randomVec3(-5, 5);
+		matrices[i] = Mat4f::TransMat(translation) * rotation.toMatrix();
+		dualQuaternions[i] = DualQuaternion(rotation, translation);
+	}
+	// Odd vertex count to test the scalar tail
+	const unsigned int count = 43;
+	std::vector<Vec3f> positions(count);
+	std::vector<Vec3f> normals(count);
+	std::vector<uint16> boneIndices(4 * count);
+	std::vector<float> boneWeights(4 * count);
+	for (unsigned int i = 0; i < count; i++)
+	{
+		positions[i] = randomVec3(-10, 10);
+		normals[i] = randomVec3(-1, 1);
+		normals[i].normalize();
+		float sum = 0.0f;
+		for (unsigned int j = 0; j < 4; j++)
+		{
+			boneIndices[4 * i + j] = (uint16)(rand() % boneCount);
+			boneWeights[4 * i + j] = j == 3 && i % 2 == 0 ? 0.0f : randomFloat(0.1f, 1.0f);
+			sum += boneWeights[4 * i + j];
+		}
+		for (unsigned int j = 0; j < 4; j++)
+			boneWeights[4 * i + j] /= sum;
+	}
+	// Rigid vertices with all influences on the same bone
+	for (unsigned int j = 0; j < 4; j++)
+	{
+		boneIndices[4 * 5 + j] = 3;
+		boneWeights[4 * 5 + j] = 0.25f;
+	}
+	{
+		// Linear blend skinning
+		std::vector<Vec3f> skinned(count);
+		std::vector<Vec3f> skinnedNormals(normals);
+		skinLinear(&matrices[0], &boneIndices[0], &boneWeights[0],
+		           &positions[0], &skinned[0], count,
+		           &skinnedNormals[0], &skinnedNormals[0]);
+		unsigned int wrong = 0;
+		for (unsigned int i = 0; i < count; i++)
+		{
+			Vec3f expected(0, 0, 0);
+			Vec3f expectedNormal(0, 0, 0);
+			for (unsigned int j = 0; j < 4; j++)
+			{
+				const Mat4f &m = matrices[boneIndices[4 * i + j]];
+				float weight = boneWeights[4 * i + j];
+				expected += m.transformPoint(positions[i]) * weight;
+				Mat4f rotation = m;
+				rotation(0, 3) = rotation(1, 3) = rotation(2, 3) = 0.0f;
+				expectedNormal += rotation.transformPoint(normals[i]) * weight;
+			}
+			if (!isEqual(skinned[i], expected, 1e-4f)
+			 || !isEqual(skinnedNormals[i], expectedNormal, 1e-5f))
+				wrong++;
+		}
+		if (!isEqual(skinned[5], matrices[3].transformPoint(positions[5]), 1e-4f))
+			wrong++;
+		if (wrong != 0)
+		{
+			std::cout << "skinLinear(): " << wrong << " wrong vertices."
+				<< std::endl;
+			errors++;
+		}
+	}
+	{
+		// Dual quaternion skinning, in place
+		std::vector<Vec3f> skinned(positions);
+		std::vector<Vec3f> skinnedNormals(count);
+		skinDualQuaternion(&dualQuaternions[0], &boneIndices[0],
+		                   &boneWeights[0], &skinned[0], &skinned[0], count,
+		                   &normals[0], &skinnedNormals[0]);
+		unsigned int wrong = 0;
+		for (unsigned int i = 0; i < count; i++)
+		{
+			DualQuaternion influences[4];
+			for (unsigned int j = 0; j < 4; j++)
+				influences[j] = dualQuaternions[boneIndices[4 * i + j]];
+			DualQuaternion blended = DualQuaternion::blend(influences,
+			                                               &boneWeights[4 * i],
+			                                               4);
+			if (!isEqual(skinned[i], blended.transformPoint(positions[i]), 1e-4f)
+			 || !isEqual(skinnedNormals[i], blended.real.rotate(normals[i]), 1e-5f)
+			 || std::fabs(skinnedNormals[i].getLength() - 1.0f) > 1e-5f)
+				wrong++;
+		}
+		if (!isEqual(skinned[5], matrices[3].transformPoint(positions[5]), 1e-4f))
+			wrong++;
+		if (wrong != 0)
+		{
+			std::cout << "skinDualQuaternion(): " << wrong << " wrong vertices."
+				<< std::endl;
+			errors++;
+		}
+	}
+	std::cout << errors << " errors." << std::endl;
+	return errors;
+}
@@ -0,0 +1,186 @@
+/*
+Copyright (C) 2011, Mathias Gottschlag
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "GameMath.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+using namespace math;
+
+typedef SpatialHashGrid::Pair Pair;
+
+static float randomFloat(float min, float max)
+{
+	return min + (max - min) * (float)rand() / (float)RAND_MAX;
+}
+
+static Vec3f randomVec3(float min, float max)
+{
+	return Vec3f(randomFloat(min, max), randomFloat(min, max),
+	             randomFloat(min, max));
+}
+
+/**
+ * Creates random boxes, some of which are much larger than the cells.
+ */
+static void randomBoxes(std::vector<BoundingBox> &boxes)
+{
+	for (unsigned int i = 0; i < boxes.size(); i++)
+	{
+		Vec3f center = randomVec3(-100, 100);
+		Vec3f size = randomVec3(0, 2);
+		if (i % 50 == 0)
+			size = randomVec3(0, 15);
+		boxes[i] = BoundingBox(center - size, center + size);
+	}
+}
+
+static std::vector<Pair> bruteForcePairs(const std::vector<BoundingBox> &boxes)
+{
+	std::vector<Pair> pairs;
+	for (uint32 i = 0; i < boxes.size(); i++)
+	{
+		for (uint32 j = i + 1; j < boxes.size(); j++)
+		{
+			if (boxes[i].overlap(boxes[j]))
+			{
+				Pair pair = {i, j};
+				pairs.push_back(pair);
+			}
+		}
+	}
+	return pairs;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int errors = 0;
+	std::vector<BoundingBox> boxes(3000);
+	randomBoxes(boxes);
+	std::vector<Pair> expected = bruteForcePairs(boxes);
+	SpatialHashGrid grid(4.0f);
+	{
+		// Cell coordinates
+		if (!(grid.getCell(Vec3f(0, 3.9f, -0.1f)) == Vec3i(0, 0, -1))
+		 || !(grid.getCell(Vec3f(-4, 4, -4.1f)) == Vec3i(-1, 1, -2)))
+		{
+			std::cout << "getCell() wrong." << std::endl;
+			errors++;
+		}
+	}
+	{
+		// Empty grid
+		std::vector<Pair> pairs;
+		std::vector<uint32> result;
+		if (grid.findPairs(pairs) != 0 || grid.query(boxes[0], result) != 0)
+		{
+			std::cout << "Empty grid wrong." << std::endl;
+			errors++;
+		}
+	}
+	{
+		// Pairs are unique and sorted within each pair
+		for (unsigned int i = 0; i < boxes.size(); i++)
+		{
+			if (grid.insert(boxes[i]) != i)
+			{
+				std::cout << "Wrong object index." << std::endl;
+				errors++;
+				break;
+			}
+		}
+		std::vector<Pair> pairs;
+		size_t count = grid.findPairs(pairs);
+		std::sort(pairs.begin(), pairs.end());
+		if (count != pairs.size() || pairs != expected)
+		{
+			std::cout << "findPairs(): " << pairs.size() << " pairs instead of "
+				<< expected.size() << "." << std::endl;
+			errors++;
+		}
+	}
+	{
+		// Batch insertion after clear() results in the same pairs
+		grid.clear();
+		grid.insert(&boxes[0], boxes.size());
+		if (grid.getObjectCount() != boxes.size())
+		{
+			std::cout << "Wrong object count." << std::endl;
+			errors++;
+		}
+		std::vector<Pair> pairs;
+		grid.findPairs(pairs);
+		std::sort(pairs.begin(), pairs.end());
+		if (pairs != expected)
+		{
+			std::cout << "findPairs() after batch insertion wrong." << std::endl;
+			errors++;
+		}
+	}
+	{
+		// Multithreaded pair generation
+		std::vector<Pair> reference;
+		grid.findPairs(reference);
+		const unsigned int threadCounts[] = {1, 2, 5};
+		for (unsigned int i = 0; i < 3; i++)
+		{
+			ThreadPool pool(threadCounts[i]);
+			std::vector<Pair> pairs;
+			if (grid.findPairs(pool, pairs) != reference.size() || pairs != reference)
+			{
+				std::cout << "Multithreaded findPairs() with " << threadCounts[i]
+					<< " threads wrong." << std::endl;
+				errors++;
+			}
+		}
+	}
+	{
+		// Box queries
+		unsigned int wrong = 0;
+		for (unsigned int i = 0; i < 100; i++)
+		{
+			Vec3f center = randomVec3(-110, 110);
+			Vec3f size = randomVec3(0, 20);
+			BoundingBox query(center - size, center + size);
+			std::vector<uint32> expectedObjects;
+			for (uint32 j = 0; j < boxes.size(); j++)
+			{
+				if (boxes[j].overlap(query))
+					expectedObjects.push_back(j);
+			}
+			std::vector<uint32> result;
+			size_t count = grid.query(query, result);
+			std::sort(result.begin(), result.end());
+			if (count != result.size() || result != expectedObjects)
+				wrong++;
+		}
+		if (wrong != 0)
+		{
+			std::cout << wrong << " queries wrong." << std::endl;
+			errors++;
+		}
+	}
+	std::cout << errors << " errors." << std::endl;
+	return errors;
+}
@@ -22,6 +22,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "GameMath.hpp"
 using namespace math;
 
+#include <cstddef>
 #include <limits>
 using namespace std;
 
@@ -58,6 +59,11 @@ ctassert<!numeric_limits<uint64>::is_signed> signtest8;
 ctassert<sizeof(float32) == 4> floattest1;
 ctassert<sizeof(float64) == 8> floattest2;
 
+// Affine3<float>::operator* loads and stores across linear.m into translation
+
+ctassert<offsetof(Affine3f, translation) == 9 * sizeof(float)> affinetest1;
+ctassert<sizeof(Affine3f) == 12 * sizeof(float)> affinetest2;
+
 int main(int argc, char **argv)
 {
 	return 0;
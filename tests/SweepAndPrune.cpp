@@ -0,0 +1,190 @@
+/*
+Copyright (C) 2011, Mathias Gottschlag
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "GameMath.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <iterator>
+#include <vector>
+
+using namespace math;
+
+typedef SweepAndPrune::Pair Pair;
+
+static float randomFloat(float min, float max)
+{
+	return min + (max - min) * (float)rand() / (float)RAND_MAX;
+}
+
+static Vec3f randomVec3(float min, float max)
+{
+	return Vec3f(randomFloat(min, max), randomFloat(min, max),
+	             randomFloat(min, max));
+}
+
+static BoundingBox randomBox()
+{
+	// The objects are spread mostly along the z axis
+	Vec3f center(randomFloat(-20, 20), randomFloat(-20, 20), randomFloat(-100, 100));
+	Vec3f size = randomVec3(0.5f, 3);
+	return BoundingBox(center - size, center + size);
+}
+
+static std::vector<Pair> bruteForcePairs(const std::vector<BoundingBox> &boxes,
+                                         const std::vector<bool> &alive)
+{
+	std::vector<Pair> pairs;
+	for (uint32 i = 0; i < boxes.size(); i++)
+	{
+		for (uint32 j = i + 1; j < boxes.size(); j++)
+		{
+			if (alive[i] && alive[j] && boxes[i].overlap(boxes[j]))
+			{
+				Pair pair = {i, j};
+				pairs.push_back(pair);
+			}
+		}
+	}
+	return pairs;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int errors = 0;
+	SweepAndPrune sap;
+	std::vector<BoundingBox> boxes;
+	std::vector<Vec3f> velocities;
+	std::vector<bool> alive;
+	{
+		// Empty
+		sap.update();
+		if (!sap.getPairs().empty() || !sap.getAddedPairs().empty())
+		{
+			std::cout << "Empty broad-phase wrong." << std::endl;
+			errors++;
+		}
+	}
+	for (unsigned int i = 0; i < 1000; i++)
+	{
+		boxes.push_back(randomBox());
+		velocities.push_back(randomVec3(-0.3f, 0.3f));
+		alive.push_back(true);
+		sap.insert(boxes.back());
+	}
+	// Touching boxes overlap
+	boxes.push_back(BoundingBox(Vec3f(0, 0, 200), Vec3f(1, 1, 201)));
+	boxes.push_back(BoundingBox(Vec3f(1, 0, 201), Vec3f(2, 1, 202)));
+	for (unsigned int i = 0; i < 2; i++)
+	{
+		velocities.push_back(Vec3f(0, 0, 0));
+		alive.push_back(true);
+		sap.insert(boxes[boxes.size() - 2 + i]);
+	}
+	std::vector<Pair> previous;
+	unsigned int wrongFrames = 0;
+	for (unsigned int frame = 0; frame < 30; frame++)
+	{
+		if (frame != 0)
+		{
+			for (uint32 i = 0; i < boxes.size(); i++)
+			{
+				if (!alive[i])
+					continue;
+				boxes[i] = BoundingBox(boxes[i].minCorner + velocities[i],
+				                       boxes[i].maxCorner + velocities[i]);
+				sap.setBounds(i, boxes[i]);
+			}
+			// Remove and add some objects, freed handles are reused after
+			// update()
+			for (unsigned int i = 0; i < 10; i++)
+			{
+				uint32 object = rand() % boxes.size();
+				if (alive[object])
+				{
+					sap.remove(object);
+					alive[object] = false;
+				}
+				BoundingBox box = randomBox();
+				uint32 handle = sap.insert(box);
+				if (handle < boxes.size() && alive[handle])
+				{
+					std::cout << "Handle of a live object reused." << std::endl;
+					errors++;
+				}
+				if (handle >= boxes.size())
+				{
+					boxes.resize(handle + 1);
+					velocities.resize(handle + 1);
+					alive.resize(handle + 1);
+				}
+				boxes[handle] = box;
+				velocities[handle] = randomVec3(-0.3f, 0.3f);
+				alive[handle] = true;
+			}
+		}
+		sap.update();
+		std::vector<Pair> expected = bruteForcePairs(boxes, alive);
+		std::vector<Pair> added;
+		std::vector<Pair> removed;
+		std::set_difference(expected.begin(), expected.end(),
+		                    previous.begin(), previous.end(),
+		                    std::back_inserter(added));
+		std::set_difference(previous.begin(), previous.end(),
+		                    expected.begin(), expected.end(),
+		                    std::back_inserter(removed));
+		if (sap.getPairs() != expected || sap.getAddedPairs() != added
+		 || sap.getRemovedPairs() != removed)
+			wrongFrames++;
+		previous = expected;
+	}
+	if (wrongFrames != 0)
+	{
+		std::cout << wrongFrames << " frames with wrong pairs." << std::endl;
+		errors++;
+	}
+	if (sap.getSweepAxis() != 2)
+	{
+		std::cout << "Wrong sweep axis: " << sap.getSweepAxis() << std::endl;
+		errors++;
+	}
+	{
+		// Changing the distribution changes the sweep axis
+		for (uint32 i = 0; i < boxes.size(); i++)
+		{
+			if (!alive[i])
+				continue;
+			Vec3f offset((float)(i % 100) * 10.0f, 0, -boxes[i].getCenter().z);
+			boxes[i] = BoundingBox(boxes[i].minCorner + offset,
+			                       boxes[i].maxCorner + offset);
+			sap.setBounds(i, boxes[i]);
+		}
+		sap.update();
+		if (sap.getSweepAxis() != 0 || sap.getPairs() != bruteForcePairs(boxes, alive))
+		{
+			std::cout << "Axis change wrong." << std::endl;
+			errors++;
+		}
+	}
+	std::cout << errors << " errors." << std::endl;
+	return errors;
+}
@@ -0,0 +1,105 @@
+/*
+Copyright (C) 2011, Mathias Gottschlag
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "GameMath.hpp"
+
+#include <iostream>
+
+using namespace math;
+
+/**
+ * Computes the sum of [first, last) by recursively splitting the range into
+ * tasks.
+ */
+class SumTask : public ThreadPool::Task
+{
+	public:
+		SumTask(unsigned int first, unsigned int last, AtomicCounter &sum,
+		        ThreadPool::TaskGroup &group)
+			: first(first), last(last), sum(sum), group(group)
+		{
+		}
+		virtual void run(ThreadPool &pool, unsigned int thread)
+		{
+			while (last - first > 16)
+			{
+				unsigned int middle = (first + last) / 2;
+				pool.spawn(new SumTask(middle, last, sum, group), group, thread);
+				last = middle;
+			}
+			int partial = 0;
+			for (unsigned int i = first; i < last; i++)
+				partial += i;
+			sum.add(partial);
+		}
+	private:
+		unsigned int first;
+		unsigned int last;
+		AtomicCounter &sum;
+		ThreadPool::TaskGroup &group;
+};
+
+int main(int argc, char **argv)
+{
+	unsigned int errors = 0;
+	{
+		AtomicCounter counter(5);
+		if (counter.add(3) != 8 || counter.add(-10) != -2 || counter.get() != -2)
+		{
+			std::cout << "AtomicCounter wrong." << std::endl;
+			errors++;
+		}
+	}
+	const unsigned int threadCounts[] = {1, 2, 4, 7};
+	for (unsigned int i = 0; i < 4; i++)
+	{
+		ThreadPool pool(threadCounts[i]);
+		if (pool.getThreadCount() != threadCounts[i])
+		{
+			std::cout << "Wrong thread count." << std::endl;
+			errors++;
+		}
+		// The pool can be used multiple times
+		for (unsigned int j = 0; j < 10; j++)
+		{
+			AtomicCounter sum;
+			ThreadPool::TaskGroup group;
+			pool.spawn(new SumTask(0, 10000, sum, group), group, 0);
+			pool.wait(group, 0);
+			if (sum.get() != 49995000)
+			{
+				std::cout << "Wrong sum with " << threadCounts[i]
+					<< " threads: " << sum.get() << std::endl;
+				errors++;
+			}
+		}
+	}
+	{
+		ThreadPool pool;
+		if (pool.getThreadCount() != ThreadPool::getProcessorCount())
+		{
+			std::cout << "Default thread count wrong." << std::endl;
+			errors++;
+		}
+	}
+	std::cout << errors << " errors." << std::endl;
+	return errors;
+}
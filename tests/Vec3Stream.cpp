@@ -0,0 +1,134 @@
+/*
+Copyright (C) 2011, Mathias Gottschlag
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "GameMath.hpp"
+
+#include <iostream>
+#include <cmath>
+
+using namespace math;
+
+static bool equal(float a, float b)
+{
+	return std::fabs(a - b) < 1e-5f;
+}
+static bool equal(const Vec3f &a, const Vec3f &b)
+{
+	return equal(a.x, b.x) && equal(a.y, b.y) && equal(a.z, b.z);
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int errors = 0;
+	// 13 elements, so that the last SIMD block is incomplete
+	std::vector<Vec3f> va;
+	std::vector<Vec3f> vb;
+	for (unsigned int i = 0; i < 13; i++)
+	{
+		va.push_back(Vec3f((float)i, 1.0f - (float)i, 0.5f * (float)i + 2));
+		vb.push_back(Vec3f(3.0f, (float)i * (float)i, -(float)i));
+	}
+	Vec3Streamf a(va);
+	Vec3Streamf b(vb);
+	{
+		// Conversion
+		std::vector<Vec3f> converted = a.toVector();
+		if (converted.size() != va.size())
+		{
+			std::cout << "toVector(): Wrong size." << std::endl;
+			errors++;
+		}
+		for (unsigned int i = 0; i < converted.size(); i++)
+		{
+			if (converted[i] != va[i] || a.get(i) != va[i])
+			{
+				std::cout << "toVector(): " << i << std::endl;
+				errors++;
+			}
+		}
+	}
+	{
+		// Dot product and squared length
+		float dot[13];
+		float length[13];
+		a.dot(b, dot);
+		a.getSquaredLength(length);
+		for (unsigned int i = 0; i < 13; i++)
+		{
+			if (!equal(dot[i], va[i].dot(vb[i])))
+			{
+				std::cout << "dot(): " << i << ": " << dot[i] << " (correct: "
+					<< va[i].dot(vb[i]) << ")" << std::endl;
+				errors++;
+			}
+			if (!equal(length[i], va[i].getSquaredLength()))
+			{
+				std::cout << "getSquaredLength(): " << i << std::endl;
+				errors++;
+			}
+		}
+	}
+	{
+		// Cross product (in-place)
+		Vec3Streamf c(a);
+		c.cross(b, c);
+		for (unsigned int i = 0; i < 13; i++)
+		{
+			if (!equal(c.get(i), va[i].cross(vb[i])))
+			{
+				std::cout << "cross(): " << i << std::endl;
+				errors++;
+			}
+		}
+	}
+	{
+		// Normalization
+		Vec3Streamf c(b);
+		c.normalize();
+		for (unsigned int i = 0; i < 13; i++)
+		{
+			Vec3f expected = vb[i];
+			expected.normalize();
+			if (!equal(c.get(i), expected))
+			{
+				std::cout << "normalize(): " << i << std::endl;
+				errors++;
+			}
+		}
+	}
+	{
+		// Interpolation
+		Vec3Streamf c;
+		c.interpolate(a, b, 0.25f);
+		for (unsigned int i = 0; i < 13; i++)
+		{
+			Vec3f expected;
+			expected.interpolate(va[i], vb[i], 0.25f);
+			if (!equal(c.get(i), expected))
+			{
+				std::cout << "interpolate(): " << i << std::endl;
+				errors++;
+			}
+		}
+	}
+	std::cout << errors << " errors." << std::endl;
+	return errors;
+}